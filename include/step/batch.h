@@ -0,0 +1,257 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_BATCH_H__
+#define STEP_BATCH_H__
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup BATCH Batched Measurements
+ * @ingroup step_api
+ * @brief API header file for multi-sample measurements.
+ *
+ * Publishing one sample per measurement pays for a header, a sample pool
+ * allocation and a pass through the processor node registry for every
+ * sample. At high sensor rates, packing several consecutive samples from
+ * a source into a single measurement divides that overhead by the number of
+ * samples in it.
+ *
+ * A batcher accumulates samples from a single source directly into a sample
+ * pool measurement, and publishes it once 'max_samples' samples have been
+ * added, or once 'timeout_ms' has elapsed since the first sample was added.
+ * Batches of 2^n samples use the header's sample count field. Other sample
+ * counts set it to 15 and place a 32-bit little-endian count word after the
+ * timestamp, as described in @ref step_mes_header.
+ *
+ * Consumers walk the samples in a batched measurement with an iterator,
+ * which also accepts unbatched (single sample) measurements.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @typedef step_batch_flush_t
+ * @brief Callback receiving completed batches.
+ *
+ * @param mes       The batched measurement, allocated from the sample pool.
+ *                  The callback becomes responsible for freeing it.
+ * @param user_data User data from the batcher.
+ *
+ * @return 0 on success, negative error code on failure.
+ */
+typedef int (*step_batch_flush_t)(struct step_measurement *mes,
+				  void *user_data);
+
+/**
+ * @brief Batcher config and state. The config fields must be set before
+ *        calling @ref step_batch_init, and the rest should be left alone.
+ */
+struct step_batch {
+	/**
+	 * @brief Header used for every batch, including the filter, unit,
+	 *        vector size, timestamp format and source ID. The payload
+	 *        length, fragment and sample count fields are set by the batcher.
+	 */
+	struct step_mes_header header;
+
+	/** Number of samples after which a batch is published. */
+	uint16_t max_samples;
+
+	/**
+	 * @brief Time in ms after the first sample was added at which a partial
+	 *        batch is published. 0 to only publish full batches.
+	 */
+	uint32_t timeout_ms;
+
+	/** Callback receiving batches, or NULL to use @ref step_pm_put. */
+	step_batch_flush_t flush;
+
+	/** User data passed to 'flush'. */
+	void *user_data;
+
+	/** The batch being filled, if any. */
+	struct step_measurement *mes;
+
+	/** Number of samples in 'mes'. */
+	uint16_t count;
+
+	/** Size of a single sample in bytes. */
+	uint16_t sample_sz;
+
+	/** Offset of the first sample in the payload. */
+	uint16_t offset;
+
+	/** Serialises access between producers and the flush timeout. */
+	struct k_mutex mtx;
+
+	/** Publishes partial batches once the timeout expires. */
+	struct k_work_delayable work;
+};
+
+/**
+ * @brief Sample iterator over a measurement's payload.
+ */
+struct step_batch_iter {
+	/** The next sample. */
+	const uint8_t *pos;
+	/** Number of samples left. */
+	uint32_t remaining;
+	/** Size of a single sample in bytes. */
+	uint16_t sample_sz;
+	/** The measurement's ctype. */
+	uint8_t ctype;
+};
+
+/**
+ * @brief Initialises a batcher, whose config fields have been set.
+ *
+ * @param b     The batcher to initialise.
+ *
+ * @return int  0 on success, -EINVAL if the ctype has no fixed size, if
+ *              'max_samples' is less than 2, or if a full batch wouldn't fit
+ *              in a measurement.
+ */
+int step_batch_init(struct step_batch *b);
+
+/**
+ * @brief Adds a sample to the current batch, publishing the batch if it's
+ *        full.
+ *
+ * @param b         The batcher.
+ * @param sample    The sample, of 'sample_sz' bytes.
+ * @param timestamp The sample's timestamp, in the batcher's timestamp format.
+ *                  Only the first sample's timestamp is kept.
+ *
+ * @return int      0 on success, -ENOMEM if the sample pool is exhausted, or
+ *                  the error returned when publishing the batch.
+ */
+int step_batch_add(struct step_batch *b, const void *sample,
+		   uint64_t timestamp);
+
+/**
+ * @brief Publishes the current batch, even if it isn't full.
+ *
+ * @param b     The batcher.
+ *
+ * @return int  0 on success or if the batch is empty, otherwise the error
+ *              returned when publishing the batch.
+ */
+int step_batch_flush(struct step_batch *b);
+
+/**
+ * @brief Node exec callback adding single-sample measurements to the
+ *        @ref step_batch assigned to the node's 'config' field.
+ *
+ * Measurements whose unit, vector size and timestamp format match the
+ * batcher's header are added to it, and the remaining nodes in the chain are
+ * skipped. Anything else, including the batches themselves when they are
+ * published back to the processor manager, passes through untouched.
+ *
+ * @param mes       The measurement to process.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 or a STEP_NODE_RC_* code on success, negative error code
+ *                  on failure.
+ */
+int step_batch_exec(struct step_measurement *mes, uint32_t handle,
+		    uint32_t inst);
+
+/**
+ * @brief Initialises an iterator over the samples in a measurement.
+ *
+ * @param it    The iterator to initialise.
+ * @param mes   The measurement to iterate over, which must contain
+ *              unformatted, unencoded and uncompressed samples.
+ *
+ * @return int  0 on success, -EINVAL if the measurement can't be iterated
+ *              over or its payload is too short for the sample count.
+ */
+int step_batch_iter_init(struct step_batch_iter *it,
+			 const struct step_measurement *mes);
+
+/**
+ * @brief Returns the next sample. Samples may not be aligned in memory.
+ *
+ * @param it    The iterator.
+ *
+ * @return const void*  The next sample, or NULL once every sample was read.
+ */
+static inline const void *step_batch_iter_next(struct step_batch_iter *it)
+{
+	const void *sample;
+
+	if (it->remaining == 0) {
+		return NULL;
+	}
+
+	sample = it->pos;
+	it->pos += it->sample_sz;
+	it->remaining--;
+
+	return sample;
+}
+
+/**
+ * @brief Defines a typed accessor, copying the next sample into 'val', which
+ *        must have room for every vector component.
+ */
+#define STEP_BATCH_ITER_DEFINE(name, type, ctype_id)                            \
+	static inline int step_batch_iter_next_##name(                          \
+		struct step_batch_iter *it, type *val)                          \
+	{                                                                       \
+		const void *sample;                                             \
+		if (it->ctype != (ctype_id)) {                                  \
+			return -EBADMSG;                                        \
+		}                                                               \
+		sample = step_batch_iter_next(it);                              \
+		if (sample == NULL) {                                           \
+			return -ENODATA;                                        \
+		}                                                               \
+		memcpy(val, sample, it->sample_sz);                             \
+		return 0;                                                       \
+	}
+
+/**
+ * @brief Typed sample accessors, such as step_batch_iter_next_f32().
+ *
+ * Each returns 0 on success, -EBADMSG if the measurement's ctype doesn't
+ * match, or -ENODATA once every sample was read.
+ */
+STEP_BATCH_ITER_DEFINE(f32, float, STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32)
+STEP_BATCH_ITER_DEFINE(f64, double, STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64)
+STEP_BATCH_ITER_DEFINE(s8, int8_t, STEP_MES_UNIT_CTYPE_S8)
+STEP_BATCH_ITER_DEFINE(s16, int16_t, STEP_MES_UNIT_CTYPE_S16)
+STEP_BATCH_ITER_DEFINE(s32, int32_t, STEP_MES_UNIT_CTYPE_S32)
+STEP_BATCH_ITER_DEFINE(s64, int64_t, STEP_MES_UNIT_CTYPE_S64)
+STEP_BATCH_ITER_DEFINE(u8, uint8_t, STEP_MES_UNIT_CTYPE_U8)
+STEP_BATCH_ITER_DEFINE(u16, uint16_t, STEP_MES_UNIT_CTYPE_U16)
+STEP_BATCH_ITER_DEFINE(u32, uint32_t, STEP_MES_UNIT_CTYPE_U32)
+STEP_BATCH_ITER_DEFINE(u64, uint64_t, STEP_MES_UNIT_CTYPE_U64)
+STEP_BATCH_ITER_DEFINE(q15, int16_t, STEP_MES_UNIT_CTYPE_Q15)
+STEP_BATCH_ITER_DEFINE(q31, int32_t, STEP_MES_UNIT_CTYPE_Q31)
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_BATCH_H_ */
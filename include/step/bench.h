@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_BENCH_H__
+#define STEP_BENCH_H__
+
+#include <zephyr/kernel.h>
+
+/**
+ * @file
+ *
+ * Wall-clock timing helpers shared by the benchmark applications.
+ *
+ * Simulated time doesn't advance while code runs on native_sim, so the
+ * host's monotonic clock is used there, and timestamps are in ns.
+ * Elsewhere they're hardware cycles, see @ref step_bench_to_ns.
+ */
+
+#if defined(CONFIG_ARCH_POSIX) && defined(CONFIG_EXTERNAL_LIBC)
+#include <time.h>
+/** @brief Set when timestamps come from the host's clock, in ns. */
+#define STEP_BENCH_HOST_CLOCK 1
+#else
+#define STEP_BENCH_HOST_CLOCK 0
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Returns a wall-clock timestamp, in ns on native_sim and in
+ *        hardware cycles elsewhere.
+ */
+static inline uint64_t step_bench_now(void)
+{
+#if STEP_BENCH_HOST_CLOCK
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return ((uint64_t)ts.tv_sec * NSEC_PER_SEC) + ts.tv_nsec;
+#else
+	return k_cycle_get_32();
+#endif
+}
+
+/**
+ * @brief Returns the time elapsed between two @ref step_bench_now
+ *        timestamps, in the same unit.
+ */
+static inline uint64_t step_bench_elapsed(uint64_t t0, uint64_t t1)
+{
+#if STEP_BENCH_HOST_CLOCK
+	return t1 - t0;
+#else
+	/* The cycle counter can wrap between the two timestamps. */
+	return (uint32_t)((uint32_t)t1 - (uint32_t)t0);
+#endif
+}
+
+/**
+ * @brief Converts a @ref step_bench_elapsed value, or a sum of them, to ns.
+ */
+static inline uint64_t step_bench_to_ns(uint64_t t)
+{
+#if STEP_BENCH_HOST_CLOCK
+	return t;
+#else
+	return k_cyc_to_ns_floor64(t);
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* STEP_BENCH_H__ */
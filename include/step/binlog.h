@@ -0,0 +1,329 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_BINLOG_H__
+#define STEP_BINLOG_H__
+
+#include <stdbool.h>
+#include <zephyr/kernel.h>
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup BINLOG Binary Measurement Logs
+ * @ingroup step_api
+ * @brief API header file for writing and reading framed binary logs of
+ *        measurements.
+ *
+ * A log starts with an 8-byte file header, followed by a series of frames:
+ *
+ * @code
+ * File header:  'S' 'T' 'P' 'L' | version (u8) | 0 (u8) | index interval (u16)
+ * Frame:        0xA5 (u8) | type (u8) | count (u16) | body | CRC-32 (u32)
+ *
+ * Record body:  step_mes_header (12 bytes) | payload (srclen.len bytes)
+ * Index body:   previous index offset (u32) | first record (u32) |
+ *               'count' record offsets (u32 each)
+ * End body:     last index offset (u32) | number of records (u32)
+ * @endcode
+ *
+ * Integers are little-endian, except for the measurement header and payload,
+ * which are stored exactly as they are in memory (timestamps in native byte
+ * order). The CRC-32 (IEEE) covers the whole frame up to the CRC itself.
+ * Offsets are in bytes from the start of the log, and 0xFFFFFFFF when unset.
+ *
+ * An index frame listing the offsets of the preceding records is written
+ * every CONFIG_STEP_BINLOG_INDEX_INTERVAL records. Finishing a log writes any
+ * partial index and an end frame, which lets readers seek to any record by
+ * following the chain of index frames backwards. Logs that were never
+ * finished, such as a capture cut short by a reset, can still be read
+ * sequentially, and readers resynchronise on the next valid frame after any
+ * corruption.
+ *
+ * Records are written through a sink callback, with the payload passed
+ * straight from the measurement without being copied. The reader works on a
+ * buffer holding the log, and returns payloads as pointers into that buffer,
+ * so a log mapped into memory with @ref step_binlog_map can be iterated and
+ * replayed without copying.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the file header in bytes. */
+#define STEP_BINLOG_FILE_HDR_SZ         (8)
+
+/** Current log format version. */
+#define STEP_BINLOG_VERSION             (1)
+
+/** Size of a frame's prefix (sync, type and count) in bytes. */
+#define STEP_BINLOG_FRAME_HDR_SZ        (4)
+
+/** Size of the CRC at the end of every frame in bytes. */
+#define STEP_BINLOG_CRC_SZ              (4)
+
+/** Offset value indicating that no frame is referenced. */
+#define STEP_BINLOG_OFFSET_NONE         (0xFFFFFFFFU)
+
+/** Frame types. */
+enum step_binlog_frame_type {
+	/** A single measurement. */
+	STEP_BINLOG_FRAME_RECORD        = 1,
+	/** Offsets of the preceding records. */
+	STEP_BINLOG_FRAME_INDEX         = 2,
+	/** End of a finished log. */
+	STEP_BINLOG_FRAME_END           = 3,
+};
+
+/**
+ * @typedef step_binlog_sink_t
+ * @brief Callback receiving the bytes of a log, in order.
+ *
+ * @param data      The bytes to write.
+ * @param len       Number of bytes to write.
+ * @param user_data User data from the writer.
+ *
+ * @return 0 if all 'len' bytes were written, negative error code otherwise.
+ */
+typedef int (*step_binlog_sink_t)(const void *data, uint32_t len,
+				  void *user_data);
+
+/**
+ * @brief Log writer config and state. The config fields must be set before
+ *        calling @ref step_binlog_writer_init, and the rest should be left
+ *        alone.
+ *
+ * A writer can be used as the config of a @ref step_binlog_exec node.
+ */
+struct step_binlog_writer {
+	/** Callback receiving the log's bytes. */
+	step_binlog_sink_t sink;
+
+	/** User data passed to 'sink'. */
+	void *user_data;
+
+	/** Number of bytes written so far. */
+	uint32_t offset;
+
+	/** Number of records written so far. */
+	uint32_t records;
+
+	/** Offset of the last index frame. */
+	uint32_t last_index;
+
+	/** Number of records since the last index frame. */
+	uint16_t pending;
+
+	/** Offsets of the records since the last index frame (little-endian). */
+	uint32_t index[CONFIG_STEP_BINLOG_INDEX_INTERVAL];
+
+	/** Serialises writes from multiple threads. */
+	struct k_mutex mtx;
+};
+
+/**
+ * @brief Sink state for @ref step_binlog_buf_sink, writing into a memory
+ *        buffer.
+ */
+struct step_binlog_buf {
+	/** The output buffer. */
+	uint8_t *buf;
+	/** Size of 'buf' in bytes. */
+	uint32_t len;
+	/** Number of bytes written to 'buf'. */
+	uint32_t pos;
+};
+
+/**
+ * @brief A record returned by the reader.
+ */
+struct step_binlog_rec {
+	/** The measurement's header. */
+	struct step_mes_header header;
+	/** The payload, pointing into the reader's buffer. May be unaligned. */
+	const void *payload;
+	/** Offset of the record's frame in the log. */
+	uint32_t offset;
+	/** The record's position in the log, starting at 0. */
+	uint32_t index;
+};
+
+/**
+ * @brief Log reader state.
+ */
+struct step_binlog_reader {
+	/** The log. */
+	const uint8_t *buf;
+	/** Size of the log in bytes. */
+	uint32_t len;
+	/** Offset of the next frame to read. */
+	uint32_t pos;
+	/** Position of the next record in the log. */
+	uint32_t next;
+	/** Whether the log ends with an end frame. */
+	bool finished;
+	/** Offset of the last index frame, if the log was finished. */
+	uint32_t last_index;
+	/** Number of records, if the log was finished. */
+	uint32_t records;
+	/** Mapping returned by @ref step_binlog_map, if any. */
+	void *map;
+};
+
+/**
+ * @brief Initialises a writer, whose config fields have been set, and
+ *        writes the file header.
+ *
+ * @param w     The writer to initialise.
+ *
+ * @return int  0 on success, -EINVAL if no sink was set, otherwise the
+ *              sink's error code.
+ */
+int step_binlog_writer_init(struct step_binlog_writer *w);
+
+/**
+ * @brief Appends a measurement to the log, followed by an index frame once
+ *        CONFIG_STEP_BINLOG_INDEX_INTERVAL records have been written since
+ *        the last one.
+ *
+ * If the sink fails part way through a frame, the bytes it did accept are
+ * still accounted for, and readers will skip the partial frame.
+ *
+ * @param w     The writer.
+ * @param mes   The measurement to append.
+ *
+ * @return int  0 on success, -EINVAL if the log would exceed 4 GiB,
+ *              otherwise the sink's error code.
+ */
+int step_binlog_write(struct step_binlog_writer *w,
+		      const struct step_measurement *mes);
+
+/**
+ * @brief Writes any partial index and an end frame, allowing readers to seek
+ *        directly to any record.
+ *
+ * Records can still be appended afterwards, but the log will then need to be
+ * finished again to be seekable.
+ *
+ * @param w     The writer.
+ *
+ * @return int  0 on success, otherwise the sink's error code.
+ */
+int step_binlog_writer_finish(struct step_binlog_writer *w);
+
+/**
+ * @brief Sink writing into the @ref step_binlog_buf passed as 'user_data'.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full, in which case
+ *              nothing is written.
+ */
+int step_binlog_buf_sink(const void *data, uint32_t len, void *user_data);
+
+/**
+ * @brief Node exec callback appending measurements to the
+ *        @ref step_binlog_writer assigned to the node's 'config' field.
+ *
+ * @param mes       The measurement to log.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_binlog_exec(struct step_measurement *mes, uint32_t handle,
+		     uint32_t inst);
+
+/**
+ * @brief Initialises a reader over a log held in memory.
+ *
+ * @param r     The reader to initialise.
+ * @param buf   The log, which must remain valid while the reader is used.
+ * @param len   Size of the log in bytes.
+ *
+ * @return int  0 on success, -EINVAL if the file header is invalid, or
+ *              -ENOTSUP if the log's version isn't supported.
+ */
+int step_binlog_reader_init(struct step_binlog_reader *r, const void *buf,
+			    uint32_t len);
+
+/**
+ * @brief Reads the next record, skipping index and end frames.
+ *
+ * @param r     The reader.
+ * @param rec   The record, whose payload points into the log.
+ *
+ * @return int  0 on success, -ENODATA at the end of the log or if the last
+ *              frame is incomplete (in which case it is retried on the next
+ *              call), or -EBADMSG if a corrupt frame was skipped, in which
+ *              case the next call resumes at the next valid frame.
+ */
+int step_binlog_next(struct step_binlog_reader *r, struct step_binlog_rec *rec);
+
+/**
+ * @brief Positions the reader so that the next call to
+ *        @ref step_binlog_next returns the record at position 'index'.
+ *
+ * Finished logs are seeked via their index frames, other logs by skipping
+ * records from the start without checking their CRCs, resynchronising on
+ * invalid frames.
+ *
+ * @param r     The reader.
+ * @param index The record's position in the log, starting at 0.
+ *
+ * @return int  0 on success, -ENOENT if the log has fewer records.
+ */
+int step_binlog_seek(struct step_binlog_reader *r, uint32_t index);
+
+/**
+ * @brief Fills in a measurement pointing to a record's payload, so that it
+ *        can be passed to node callbacks without copying the payload.
+ *
+ * The measurement isn't allocated from the sample pool, so it must not be
+ * freed or passed to @ref step_pm_put, and its payload must not be modified.
+ * To replay records through the processor manager, copy them into a
+ * measurement from @ref step_sp_alloc instead.
+ *
+ * @param rec   The record.
+ * @param mes   The measurement to fill in.
+ */
+void step_binlog_rec_mes(const struct step_binlog_rec *rec,
+			 struct step_measurement *mes);
+
+#if CONFIG_STEP_BINLOG_MMAP
+/**
+ * @brief Maps a log file into memory and initialises a reader over it.
+ *
+ * @param path  Path to the log on the host filesystem.
+ * @param r     The reader to initialise.
+ *
+ * @return int  0 on success, negative error code on failure, as per
+ *              @ref step_binlog_reader_init or the failing system call.
+ */
+int step_binlog_map(const char *path, struct step_binlog_reader *r);
+
+/**
+ * @brief Unmaps a log mapped by @ref step_binlog_map.
+ *
+ * @param r     The reader.
+ */
+void step_binlog_unmap(struct step_binlog_reader *r);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_BINLOG_H_ */
@@ -18,6 +18,11 @@
  * filter values against processor nodes or node chains. As the cache fills up
  * the least recently used cache record will be removed to make room for a new
  * entry.
+ *
+ * The cache is shared by the processor manager's work queue and the
+ * application. Functions that read or modify more than a single value take
+ * an internal lock, so they can be called from any thread, but not from an
+ * ISR.
  * @{
  */
 
@@ -56,6 +61,48 @@ struct step_cache_rec {
 	int64_t last_used;
 };
 
+/**
+ * @brief Cache statistics.
+ */
+struct step_cache_stats {
+	/**
+	 * @brief The number of times 'step_cache_clear' has been called.
+	 */
+	uint32_t clear_calls;
+
+	/**
+	 * @brief The number of times 'step_cache_check' has been called.
+	 */
+	uint32_t check_calls;
+
+	/**
+	 * @brief The number of times 'step_cache_add' has been called.
+	 */
+	uint32_t add_calls;
+
+	/**
+	 * @brief The number of matches.
+	 */
+	uint32_t matches;
+
+	/**
+	 * @brief The number of records removed due to an overflow.
+	 */
+	uint32_t removals;
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	/**
+	 * @brief The number of evaluation windows where the cache was bypassed.
+	 */
+	uint32_t bypassed_windows;
+
+	/**
+	 * @brief The number of times the working set was resized.
+	 */
+	uint32_t resizes;
+#endif
+};
+
 /**
  * @brief Prints the current cache contents using printk.
  */
@@ -66,6 +113,18 @@ void step_cache_print(void);
  */
 void step_cache_print_stats(void);
 
+/**
+ * @brief Returns a snapshot of the cache statistics.
+ *
+ * @param stats The struct to fill in.
+ */
+void step_cache_stats_get(struct step_cache_stats *stats);
+
+/**
+ * @brief Clears the cache statistics.
+ */
+void step_cache_stats_reset(void);
+
 /**
  * @brief Clears all existing records from cache memory.
  */
@@ -107,6 +166,50 @@ int step_cache_check(uint32_t filter, uint32_t handle, int *result);
  */
 int step_cache_add(uint32_t filter, uint32_t handle, int result);
 
+/**
+ * @brief Sets the number of records in the cache's working set.
+ *
+ * Every lookup scans the whole working set, so a smaller working set is
+ * cheaper to search, at the risk of more evictions. When the working set is
+ * reduced, the most recently used records are kept.
+ *
+ * @param depth     The new working set size, between 1 and
+ *                  CONFIG_STEP_FILTER_CACHE_DEPTH.
+ *
+ * @return int      Zero on normal execution, otherwise a negative error code.
+ */
+int step_cache_depth_set(uint32_t depth);
+
+/**
+ * @brief Gets the number of records in the cache's working set.
+ *
+ * @return uint32_t The current working set size.
+ */
+uint32_t step_cache_depth_get(void);
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+/**
+ * @brief Indicates whether the cache should be consulted for the next filter
+ *        evaluation.
+ *
+ * The adaptive cache compares its own cost against the cost of raw filter
+ * evaluation over windows of CONFIG_STEP_FILTER_CACHE_ADAPTIVE_WINDOW
+ * lookups. When the cache is found to be slower it is bypassed, and probed
+ * again after CONFIG_STEP_FILTER_CACHE_ADAPTIVE_PROBE windows.
+ *
+ * @return bool     true if the cache is active, false if it is bypassed.
+ */
+bool step_cache_active(void);
+
+/**
+ * @brief Reports the cost of an uncached filter evaluation to the adaptive
+ *        cache.
+ *
+ * @param cycles    The number of cycles the evaluation took.
+ */
+void step_cache_report_eval(uint32_t cycles);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
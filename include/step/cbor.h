@@ -0,0 +1,376 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_CBOR_H__
+#define STEP_CBOR_H__
+
+#include <stdbool.h>
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup CBOR CBOR Payloads
+ * @ingroup step_api
+ * @brief API header file for reading and writing CBOR payloads.
+ *
+ * Provides an allocation-free CBOR (rfc8949) writer that encodes directly
+ * into a payload buffer, and a cursor-style reader that walks a payload one
+ * data item at a time, returning byte and text strings as pointers into the
+ * payload rather than copies.
+ *
+ * The writer has a sizing mode, enabled by passing a NULL buffer, which only
+ * counts the bytes that would have been written. Running the same encoding
+ * code twice, first in sizing mode and then into the payload, allows the
+ * measurement to be allocated with the exact length required:
+ *
+ * @code
+ * static void encode(struct step_cbor_writer *w, struct accel *a)
+ * {
+ *         step_cbor_put_map(w, 3);
+ *         step_cbor_put_text(w, "x", 1);
+ *         step_cbor_put_float(w, a->x);
+ *         ...
+ * }
+ *
+ * step_cbor_writer_init(&w, NULL, 0);
+ * encode(&w, &accel);
+ * mes = step_sp_alloc(step_cbor_writer_finish(&w));
+ * step_cbor_writer_init_mes(&w, mes);
+ * encode(&w, &accel);
+ * rc = step_cbor_writer_finish_mes(&w, mes);
+ * @endcode
+ *
+ * Only definite-length items are supported, which is all the writer emits.
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief CBOR writer state.
+ */
+struct step_cbor_writer {
+	/** Output buffer, or NULL in sizing mode. */
+	uint8_t *buf;
+	/** Size of 'buf' in bytes. */
+	uint32_t len;
+	/** Number of bytes written (or that would have been written). */
+	uint32_t pos;
+	/** First error encountered, if any. Further writes are ignored. */
+	int err;
+};
+
+/**
+ * @brief Type of a data item returned by the reader.
+ */
+enum step_cbor_type {
+	/** Unsigned integer, in 'u'. */
+	STEP_CBOR_TYPE_UINT     = 0,
+	/** Negative integer, in 'i'. Values below INT64_MIN are rejected. */
+	STEP_CBOR_TYPE_NINT     = 1,
+	/** Byte string, in 'str'. */
+	STEP_CBOR_TYPE_BYTES    = 2,
+	/** UTF-8 text string, in 'str'. Not NULL-terminated. */
+	STEP_CBOR_TYPE_TEXT     = 3,
+	/** Array header, with 'count' items following. */
+	STEP_CBOR_TYPE_ARRAY    = 4,
+	/** Map header, with 'count' key/value pairs following. */
+	STEP_CBOR_TYPE_MAP      = 5,
+	/** Tag, in 'u', applying to the next item. */
+	STEP_CBOR_TYPE_TAG      = 6,
+	/** Boolean, in 'b'. */
+	STEP_CBOR_TYPE_BOOL     = 7,
+	/** Null. */
+	STEP_CBOR_TYPE_NULL     = 8,
+	/** Undefined. */
+	STEP_CBOR_TYPE_UNDEF    = 9,
+	/** Half, single or double precision float, in 'f'. */
+	STEP_CBOR_TYPE_FLOAT    = 10,
+};
+
+/**
+ * @brief A data item returned by the reader.
+ */
+struct step_cbor_item {
+	/** The item's type, which determines the valid union member. */
+	enum step_cbor_type type;
+	union {
+		/** Unsigned integer or tag value. */
+		uint64_t u;
+		/** Signed integer value. */
+		int64_t i;
+		/** Boolean value. */
+		bool b;
+		/** Floating point value. */
+		double f;
+		/** Number of items (array) or pairs (map). */
+		uint32_t count;
+		/** String contents, pointing into the payload. */
+		struct {
+			const uint8_t *ptr;
+			uint32_t len;
+		} str;
+	};
+};
+
+/**
+ * @brief CBOR reader state.
+ */
+struct step_cbor_reader {
+	/** Input buffer. */
+	const uint8_t *buf;
+	/** Size of 'buf' in bytes. */
+	uint32_t len;
+	/** Offset of the next item in 'buf'. */
+	uint32_t pos;
+};
+
+/**
+ * @brief Initialises a writer.
+ *
+ * @param w     The writer to initialise.
+ * @param buf   The output buffer, or NULL to only compute the encoded size.
+ * @param len   Size of 'buf' in bytes, ignored in sizing mode.
+ */
+void step_cbor_writer_init(struct step_cbor_writer *w, uint8_t *buf,
+			   uint32_t len);
+
+/**
+ * @brief Initialises a writer to encode into a measurement's payload, after
+ *        the timestamp if one is present.
+ *
+ * @param w     The writer to initialise.
+ * @param mes   The measurement whose payload buffer should be used.
+ */
+void step_cbor_writer_init_mes(struct step_cbor_writer *w,
+			       struct step_measurement *mes);
+
+/**
+ * @brief Completes encoding.
+ *
+ * @param w     The writer.
+ *
+ * @return int  The number of bytes written (or required in sizing mode), or
+ *              the first error encountered while writing.
+ */
+int step_cbor_writer_finish(struct step_cbor_writer *w);
+
+/**
+ * @brief Completes encoding into a measurement's payload, updating the
+ *        payload length and setting the data format to CBOR.
+ *
+ * @param w     A writer set up with @ref step_cbor_writer_init_mes.
+ * @param mes   The measurement that was written to.
+ *
+ * @return int  0 on success, otherwise the first error encountered while
+ *              writing.
+ */
+int step_cbor_writer_finish_mes(struct step_cbor_writer *w,
+				struct step_measurement *mes);
+
+/**
+ * @brief Writes an unsigned integer.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_uint(struct step_cbor_writer *w, uint64_t val);
+
+/**
+ * @brief Writes a signed integer.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_int(struct step_cbor_writer *w, int64_t val);
+
+/**
+ * @brief Writes a byte string.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_bytes(struct step_cbor_writer *w, const void *data,
+			uint32_t len);
+
+/**
+ * @brief Writes a UTF-8 text string of 'len' bytes.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_text(struct step_cbor_writer *w, const char *str,
+		       uint32_t len);
+
+/**
+ * @brief Writes an array header. 'count' items must follow.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_array(struct step_cbor_writer *w, uint32_t count);
+
+/**
+ * @brief Writes a map header. 'count' key/value pairs must follow.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_map(struct step_cbor_writer *w, uint32_t count);
+
+/**
+ * @brief Writes a tag, applying to the next item.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_tag(struct step_cbor_writer *w, uint64_t tag);
+
+/**
+ * @brief Writes a boolean.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_bool(struct step_cbor_writer *w, bool val);
+
+/**
+ * @brief Writes a null value.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_null(struct step_cbor_writer *w);
+
+/**
+ * @brief Writes a single precision float.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_float(struct step_cbor_writer *w, float val);
+
+/**
+ * @brief Writes a double precision float.
+ *
+ * @return int  0 on success, -ENOSPC if the buffer is full.
+ */
+int step_cbor_put_double(struct step_cbor_writer *w, double val);
+
+/**
+ * @brief Initialises a reader.
+ *
+ * @param r     The reader to initialise.
+ * @param buf   The CBOR data to read.
+ * @param len   Length of 'buf' in bytes.
+ */
+void step_cbor_reader_init(struct step_cbor_reader *r, const uint8_t *buf,
+			   uint32_t len);
+
+/**
+ * @brief Initialises a reader on a measurement's CBOR payload, after the
+ *        timestamp if one is present.
+ *
+ * @param r     The reader to initialise.
+ * @param mes   The measurement to read.
+ *
+ * @return int  0 on success, -EINVAL if the payload isn't CBOR formatted or
+ *              is encoded or compressed.
+ */
+int step_cbor_reader_init_mes(struct step_cbor_reader *r,
+			      struct step_measurement *mes);
+
+/**
+ * @brief Reads the next data item. Arrays, maps and tags only return their
+ *        header, and the reader then continues with their contents.
+ *
+ * @param r     The reader.
+ * @param item  The item read.
+ *
+ * @return int  0 on success, -ENODATA at the end of the data, -EINVAL if the
+ *              data is malformed, or -ENOTSUP for indefinite-length items.
+ *              The reader doesn't advance on errors.
+ */
+int step_cbor_next(struct step_cbor_reader *r, struct step_cbor_item *item);
+
+/**
+ * @brief Skips the next data item, including the contents of arrays, maps
+ *        and tags.
+ *
+ * @param r     The reader.
+ *
+ * @return int  0 on success, otherwise a negative error code as per
+ *              @ref step_cbor_next.
+ */
+int step_cbor_skip(struct step_cbor_reader *r);
+
+/**
+ * @brief Reads the next item, which must be an integer that fits in 'val'.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch or overflow,
+ *              otherwise as per @ref step_cbor_next. The reader doesn't
+ *              advance on errors.
+ */
+int step_cbor_get_uint(struct step_cbor_reader *r, uint64_t *val);
+
+/**
+ * @brief Reads the next item, which must be an integer that fits in 'val'.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch or overflow,
+ *              otherwise as per @ref step_cbor_next. The reader doesn't
+ *              advance on errors.
+ */
+int step_cbor_get_int(struct step_cbor_reader *r, int64_t *val);
+
+/**
+ * @brief Reads the next item, which must be a float or an integer.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch, otherwise as per
+ *              @ref step_cbor_next. The reader doesn't advance on errors.
+ */
+int step_cbor_get_float(struct step_cbor_reader *r, float *val);
+
+/**
+ * @brief Reads the next item, which must be a text string. 'str' points into
+ *        the CBOR data, and isn't NULL-terminated.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch, otherwise as per
+ *              @ref step_cbor_next. The reader doesn't advance on errors.
+ */
+int step_cbor_get_text(struct step_cbor_reader *r, const char **str,
+		       uint32_t *len);
+
+/**
+ * @brief Reads the next item, which must be a byte string. 'data' points into
+ *        the CBOR data.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch, otherwise as per
+ *              @ref step_cbor_next. The reader doesn't advance on errors.
+ */
+int step_cbor_get_bytes(struct step_cbor_reader *r, const uint8_t **data,
+			uint32_t *len);
+
+/**
+ * @brief Reads the next item, which must be an array header.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch, otherwise as per
+ *              @ref step_cbor_next. The reader doesn't advance on errors.
+ */
+int step_cbor_get_array(struct step_cbor_reader *r, uint32_t *count);
+
+/**
+ * @brief Reads the next item, which must be a map header.
+ *
+ * @return int  0 on success, -EBADMSG on a type mismatch, otherwise as per
+ *              @ref step_cbor_next. The reader doesn't advance on errors.
+ */
+int step_cbor_get_map(struct step_cbor_reader *r, uint32_t *count);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_CBOR_H_ */
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_CONVERT_H__
+#define STEP_CONVERT_H__
+
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup CONVERT Unit and Scale Conversion
+ * @ingroup step_api
+ * @brief API header file for converting payload values between units,
+ *        scales and C types.
+ *
+ * Values are converted as 'out = in * scale + offset', where the scale and
+ * offset account for the source and destination scale factors (10^n) and
+ * any conversion between related SI units, such as Celsius to Kelvin or
+ * hPa to Pa.
+ *
+ * Payloads are processed in fixed-size blocks of every sample and vector
+ * component at once, in three tight loops: widening the source values to
+ * float, applying the scale and offset, and narrowing to the destination
+ * type with rounding and saturation. This keeps each loop simple enough for
+ * the compiler to vectorise on cores with SIMD extensions.
+ *
+ * Conversions go through single-precision floats, so 32 and 64-bit values
+ * beyond +/-2^24 lose precision.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The representation to convert to. Also used as the config for
+ *        @ref step_conv_exec, assigned to the node's 'config' field.
+ */
+struct step_conv_target {
+	/**
+	 * @brief The SI unit to convert to, or STEP_MES_UNIT_SI_UNDEFINED to
+	 *        keep the source unit.
+	 */
+	uint16_t si_unit;
+	/** The scale factor (10^n) to convert to. */
+	int8_t scale_factor;
+	/**
+	 * @brief The ctype to convert to, or STEP_MES_UNIT_CTYPE_UNDEFINED to
+	 *        keep the source ctype.
+	 */
+	uint8_t ctype;
+};
+
+/**
+ * @brief Returns the scale and offset converting values from one unit and
+ *        scale factor to another.
+ *
+ * @param src_unit      The source SI unit.
+ * @param src_scale     The source scale factor (10^n).
+ * @param dst_unit      The destination SI unit.
+ * @param dst_scale     The destination scale factor (10^n).
+ * @param scale         The scale to apply.
+ * @param offset        The offset to apply after scaling.
+ *
+ * @return int  0 on success, -ENOTSUP if there is no known conversion
+ *              between the units, -ERANGE if the scale overflows.
+ */
+int step_conv_coeffs(uint16_t src_unit, int8_t src_scale, uint16_t dst_unit,
+		     int8_t dst_scale, float *scale, float *offset);
+
+/**
+ * @brief Converts an array of values between C types, applying a scale and
+ *        offset. 'src' and 'dst' may point to the same buffer.
+ *
+ * @param src       The source values.
+ * @param src_ctype The source ctype.
+ * @param dst       The destination buffer, with room for 'count' values of
+ *                  'dst_ctype'.
+ * @param dst_ctype The destination ctype.
+ * @param count     Number of values to convert.
+ * @param scale     Scale to apply to every value.
+ * @param offset    Offset to apply to every value after scaling.
+ *
+ * @return int  0 on success, -ENOTSUP if a ctype isn't supported. Signed and
+ *              unsigned 8, 16 and 32-bit integers, Q15, Q31, float32 and
+ *              float64 are supported. Q15 and Q31 values are read and
+ *              written as fractions in [-1.0, 1.0).
+ */
+int step_conv_values(const void *src, uint8_t src_ctype, void *dst,
+		     uint8_t dst_ctype, uint32_t count, float scale,
+		     float offset);
+
+/**
+ * @brief Converts a measurement's payload and unit header in place.
+ *
+ * Every sample and vector component is converted, and the timestamp and any
+ * sample count word are preserved.
+ *
+ * @param mes       The measurement, which must be unformatted, unencoded
+ *                  and uncompressed. When converting to a larger ctype, its
+ *                  payload buffer must have room for the result, see
+ *                  step_measurement.capacity.
+ * @param target    The representation to convert to.
+ *
+ * @return int  0 on success, -ENOSPC if the payload buffer is too small,
+ *              -EINVAL if the payload can't be converted, otherwise as per
+ *              @ref step_conv_coeffs and @ref step_conv_values.
+ */
+int step_conv_mes(struct step_measurement *mes,
+		  const struct step_conv_target *target);
+
+/**
+ * @brief Node exec callback converting measurements to the
+ *        @ref step_conv_target assigned to the node's 'config' field.
+ *
+ * @param mes       The measurement to process.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_conv_exec(struct step_measurement *mes, uint32_t handle,
+		   uint32_t inst);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_CONVERT_H_ */
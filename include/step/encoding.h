@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_ENCODING_H__
+#define STEP_ENCODING_H__
+
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup ENCODING Payload Encoding
+ * @ingroup step_api
+ * @brief API header file for BASE64 and BASE45 payload encoding.
+ *
+ * Provides table-driven BASE64 (rfc4648) and BASE45 (rfc9285) encoders and
+ * decoders, along with processor node callbacks that encode or decode the
+ * entire measurement payload, including the timestamp, so that measurements
+ * can be sent over text-only transports.
+ *
+ * All functions support in-place operation, where 'src' and 'dst' point to
+ * the same buffer, as long as the buffer is large enough for the encoded
+ * data. Encoders then process the input from the end towards the start.
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of characters required to BASE64 encode 'n' bytes. */
+#define STEP_ENC_BASE64_LEN(n) ((((n) + 2) / 3) * 4)
+
+/** Number of characters required to BASE45 encode 'n' bytes. */
+#define STEP_ENC_BASE45_LEN(n) ((((n) / 2) * 3) + (((n) % 2) * 2))
+
+/**
+ * @brief BASE64 encodes a buffer, with padding.
+ *
+ * @param src       The data to encode.
+ * @param len       Length of 'src' in bytes.
+ * @param dst       Output buffer, which can be the same as 'src'.
+ * @param dst_len   Size of 'dst' in bytes.
+ *
+ * @return int      The number of characters written, or -ENOSPC if they don't
+ *                  fit in 'dst'.
+ */
+int step_enc_base64_encode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len);
+
+/**
+ * @brief Decodes a padded BASE64 string.
+ *
+ * @param src       The characters to decode.
+ * @param len       Number of characters in 'src', a multiple of 4.
+ * @param dst       Output buffer, which can be the same as 'src'.
+ * @param dst_len   Size of 'dst' in bytes.
+ *
+ * @return int      The number of bytes written, -ENOSPC if they don't fit in
+ *                  'dst', or -EINVAL if 'src' isn't valid BASE64.
+ */
+int step_enc_base64_decode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len);
+
+/**
+ * @brief BASE45 encodes a buffer.
+ *
+ * @param src       The data to encode.
+ * @param len       Length of 'src' in bytes.
+ * @param dst       Output buffer, which can be the same as 'src'.
+ * @param dst_len   Size of 'dst' in bytes.
+ *
+ * @return int      The number of characters written, or -ENOSPC if they don't
+ *                  fit in 'dst'.
+ */
+int step_enc_base45_encode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len);
+
+/**
+ * @brief Decodes a BASE45 string.
+ *
+ * @param src       The characters to decode.
+ * @param len       Number of characters in 'src'.
+ * @param dst       Output buffer, which can be the same as 'src'.
+ * @param dst_len   Size of 'dst' in bytes.
+ *
+ * @return int      The number of bytes written, -ENOSPC if they don't fit in
+ *                  'dst', or -EINVAL if 'src' isn't valid BASE45.
+ */
+int step_enc_base45_decode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len);
+
+/**
+ * @brief Node exec callback BASE64 encoding the measurement's payload in
+ *        place.
+ *
+ * Measurements that are already encoded are left untouched. The payload
+ * buffer must be large enough for the encoded data, see
+ * @ref step_measurement.capacity.
+ *
+ * @param mes       The measurement to encode.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_enc_base64_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst);
+
+/**
+ * @brief Node exec callback BASE45 encoding the measurement's payload in
+ *        place.
+ *
+ * Measurements that are already encoded are left untouched. The payload
+ * buffer must be large enough for the encoded data, see
+ * @ref step_measurement.capacity.
+ *
+ * @param mes       The measurement to encode.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_enc_base45_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst);
+
+/**
+ * @brief Node exec callback decoding a BASE64 or BASE45 encoded payload in
+ *        place, based on the measurement's encoding flag.
+ *
+ * Measurements that aren't encoded are left untouched.
+ *
+ * @param mes       The measurement to decode.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_enc_decode_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_ENCODING_H_ */
@@ -173,6 +173,47 @@ void step_filt_print(struct step_filter_chain *fc);
 int step_filt_evaluate(struct step_filter_chain *fc,
 		       struct step_measurement *mes, int *match);
 
+/**
+ * @brief Evaluates a measurement's filter word against an array of compiled
+ *        (mask, match) pairs in a single pass.
+ *
+ * Bit 'n' of @ref bitmap is set when '(filter_bits & mask[n]) == match[n]'.
+ * Pairs are compared several at a time using SIMD instructions where the
+ * target supports them (SSE2/AVX2 on x86 hosts such as native_sim, MVE on
+ * Helium cores), with a portable scalar fallback.
+ *
+ * A @ref step_filter entry is compiled into a pair by setting 'mask' to
+ * '~ignore_mask' and 'match' to 'match & ~ignore_mask'.
+ *
+ * @param filter_bits	The measurement's filter word.
+ * @param mask		Array of 'count' masks.
+ * @param match		Array of 'count' pre-masked match values.
+ * @param count		The number of (mask, match) pairs to evaluate.
+ * @param bitmap	Result bitmap, which must be at least
+ *			'(count + 31) / 32' words long.
+ */
+void step_filt_batch_evaluate(uint32_t filter_bits, const uint32_t *mask,
+			      const uint32_t *match, uint32_t count,
+			      uint32_t *bitmap);
+
+/**
+ * @brief Resolves a filter chain against the per-entry results produced by
+ *        @ref step_filt_batch_evaluate, applying each entry's operand.
+ *
+ * @param fc		The step_filter_chain that was compiled into the table.
+ * @param bitmap	Result bitmap from @ref step_filt_batch_evaluate.
+ * @param first		Index of the chain's first entry in the table.
+ * @param count		Number of entries compiled into the table, which
+ *			must still match 'fc->count'.
+ * @param match		1 if the filter chain matches, otherwise 0.
+ *
+ * @return int		Zero on normal execution, -EINVAL if the chain is
+ *			invalid or changed since it was compiled.
+ */
+int step_filt_batch_resolve(struct step_filter_chain *fc,
+			    const uint32_t *bitmap, uint32_t first,
+			    uint32_t count, int *match);
+
 #ifdef __cplusplus
 }
 #endif
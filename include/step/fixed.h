@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_FIXED_H__
+#define STEP_FIXED_H__
+
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+#if CONFIG_SENSOR
+#include <zephyr/drivers/sensor.h>
+#endif
+
+/**
+ * @defgroup FIXED Fixed-Point Payloads
+ * @ingroup step_api
+ * @brief API header file for Q15 and Q31 fixed-point payloads.
+ *
+ * On cores without an FPU, such as the Cortex-M0 and M3, every float
+ * operation is a library call. Measurements using the
+ * @ref STEP_MES_UNIT_CTYPE_Q15 and @ref STEP_MES_UNIT_CTYPE_Q31 ctypes keep
+ * the whole pipeline in integer arithmetic instead.
+ *
+ * Fixed-point values represent a fraction of the full scale given by the
+ * measurement's scale factor, i.e. 'value = q * 2^-15 * 10^scale_factor'
+ * for Q15 and 'value = q * 2^-31 * 10^scale_factor' for Q31. An
+ * accelerometer with a +/-16 m/s^2 range would, for example, use a scale
+ * factor of 2 (+/-100 m/s^2) or 1 (+/-10 m/s^2, saturating above that).
+ *
+ * The layout and rounding behaviour of the helpers below match the
+ * equivalent CMSIS-DSP functions, and any CMSIS-DSP function taking a
+ * source buffer, destination buffer and block size, such as arm_abs_q31()
+ * or arm_negate_q15(), can be run over a measurement's samples by
+ * @ref step_fixed_block_exec.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @typedef step_q31_block_t
+ * @brief Q31 block function, processing 'block_size' values from 'src' into
+ *        'dst'. 'src' and 'dst' point to the same buffer.
+ */
+typedef void (*step_q31_block_t)(const int32_t *src, int32_t *dst,
+				 uint32_t block_size);
+
+/**
+ * @typedef step_q15_block_t
+ * @brief Q15 block function, processing 'block_size' values from 'src' into
+ *        'dst'. 'src' and 'dst' point to the same buffer.
+ */
+typedef void (*step_q15_block_t)(const int16_t *src, int16_t *dst,
+				 uint32_t block_size);
+
+/**
+ * @brief Config settings for @ref step_fixed_block_exec, assigned to the
+ *        node's 'config' field.
+ */
+struct step_fixed_cfg {
+	/** Function applied to Q31 payloads, or NULL to leave them as-is. */
+	step_q31_block_t q31;
+	/** Function applied to Q15 payloads, or NULL to leave them as-is. */
+	step_q15_block_t q15;
+};
+
+/**
+ * @brief Converts Q15 values to Q31. 'src' and 'dst' may point to the same
+ *        buffer. Equivalent to arm_q15_to_q31().
+ */
+void step_q15_to_q31(const int16_t *src, int32_t *dst, uint32_t n);
+
+/**
+ * @brief Converts Q31 values to Q15, truncating the lower 16 bits. 'src' and
+ *        'dst' may point to the same buffer. Equivalent to arm_q31_to_q15().
+ */
+void step_q31_to_q15(const int32_t *src, int16_t *dst, uint32_t n);
+
+/**
+ * @brief Multiplies Q31 values by 'scale_fract * 2^shift', with saturation.
+ *        'src' and 'dst' may point to the same buffer. Equivalent to
+ *        arm_scale_q31().
+ *
+ * @param src           The source values.
+ * @param scale_fract   Fractional part of the scale, in Q31.
+ * @param shift         Number of bits to shift the result by.
+ * @param dst           The destination buffer.
+ * @param n             Number of values.
+ */
+void step_q31_scale(const int32_t *src, int32_t scale_fract, int8_t shift,
+		    int32_t *dst, uint32_t n);
+
+/**
+ * @brief Converts a value in micro-units to Q31, with a full scale of
+ *        10^scale, without using floating point or 64-bit division.
+ *
+ * @param micro     The value in micro-units, such as from a sensor_value.
+ * @param scale     The full scale (10^n) of the result, from -6 to 3.
+ * @param q         The Q31 value, saturated to the full scale.
+ *
+ * @return int      0 on success, -ERANGE if 'scale' isn't supported.
+ */
+int step_q31_from_micro(int64_t micro, int8_t scale, int32_t *q);
+
+#if CONFIG_SENSOR
+/**
+ * @brief Converts a sensor_value to Q31, with a full scale of 10^scale.
+ *        See @ref step_q31_from_micro.
+ */
+static inline int step_q31_from_sensor_value(const struct sensor_value *val,
+					     int8_t scale, int32_t *q)
+{
+	return step_q31_from_micro((int64_t)val->val1 * 1000000 + val->val2,
+				   scale, q);
+}
+#endif
+
+/**
+ * @brief Node exec callback applying the block functions in the
+ *        @ref step_fixed_cfg assigned to the node's 'config' field to every
+ *        sample and vector component of Q15 or Q31 measurements, in place.
+ *
+ * Measurements with other ctypes pass through untouched.
+ *
+ * @param mes       The measurement to process. Samples must be aligned to
+ *                  their size in memory, as CMSIS-DSP expects.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, -EINVAL if the payload is malformed or
+ *                  misaligned.
+ */
+int step_fixed_block_exec(struct step_measurement *mes, uint32_t handle,
+			  uint32_t inst);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_FIXED_H_ */
@@ -0,0 +1,178 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_FRAG_H__
+#define STEP_FRAG_H__
+
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup FRAG Fragmentation and Reassembly
+ * @ingroup step_api
+ * @brief API header file for measurement fragmentation and reassembly.
+ *
+ * Large payloads can be sent as a series of fragments from the same source
+ * ID, each flagged as @ref STEP_MES_FRAGMENT_PARTIAL except the last one,
+ * which is flagged as @ref STEP_MES_FRAGMENT_FINAL. Only the first fragment
+ * carries the timestamp.
+ *
+ * The reassembly node holds on to partial fragments instead of copying them
+ * into a larger buffer, and aborts the rest of its node chain for them. When
+ * the final fragment arrives, the configured callback receives a
+ * scatter-gather view over every fragment's payload, after which the held
+ * fragments are released. The final fragment then continues down the node
+ * chain as normal, so subscribers are notified once per reassembled
+ * measurement.
+ *
+ * Since no single block has to hold the whole payload, the largest single
+ * sample pool allocation is bounded by the fragment size rather than the
+ * payload size, which helps when the pool is fragmented. Every partial
+ * fragment stays allocated until the final one arrives, though, so peak
+ * pool usage is still the whole payload plus the overhead of each
+ * fragment's measurement header, for every source being reassembled.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A contiguous segment of a reassembled payload.
+ */
+struct step_frag_seg {
+	/** Start of the segment, inside a fragment's payload. */
+	const uint8_t *ptr;
+	/** Length of the segment in bytes. */
+	uint16_t len;
+};
+
+/**
+ * @brief Scatter-gather view of a reassembled payload.
+ */
+struct step_frag_view {
+	/**
+	 * @brief Header of the first fragment, with the fragment field cleared.
+	 *        'srclen.len' is saturated at 65535, use 'len' instead.
+	 */
+	struct step_mes_header header;
+	/** The first fragment's timestamp, or NULL if there is none. */
+	const void *timestamp;
+	/** Total payload length in bytes, excluding the timestamp. */
+	uint32_t len;
+	/** Number of valid entries in 'seg'. */
+	uint32_t count;
+	/** Payload segments, in order. */
+	struct step_frag_seg seg[CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS];
+};
+
+/**
+ * @typedef step_frag_cb_t
+ * @brief Callback receiving reassembled payloads. The view, and the memory
+ *        it points to, are only valid until the callback returns.
+ *
+ * @param view      The reassembled payload.
+ * @param user_data User data from the node's @ref step_frag_cfg.
+ */
+typedef void (*step_frag_cb_t)(const struct step_frag_view *view,
+			       void *user_data);
+
+/**
+ * @typedef step_frag_emit_t
+ * @brief Callback receiving the fragments produced by @ref step_frag_split.
+ *
+ * @param frag      The fragment, which is only valid until the callback
+ *                  returns. Its payload points into the original measurement.
+ * @param user_data User data supplied to @ref step_frag_split.
+ *
+ * @return 0 to continue, or a negative error code to stop splitting.
+ */
+typedef int (*step_frag_emit_t)(struct step_measurement *frag,
+				void *user_data);
+
+/**
+ * @brief Config settings for the reassembly node, assigned to the node's
+ *        'config' field.
+ */
+struct step_frag_cfg {
+	/** Callback receiving reassembled payloads. */
+	step_frag_cb_t cb;
+	/** User data passed to 'cb'. */
+	void *user_data;
+};
+
+/**
+ * @brief Node exec callback reassembling fragmented measurements.
+ *
+ * Unfragmented measurements pass through untouched. Partial fragments are
+ * held, taking ownership of them if they came from the sample pool, and the
+ * remaining nodes in the chain are skipped. Fragments that don't fit in the
+ * reassembly buffers cause the whole set from that source to be dropped.
+ *
+ * @note Fragments that aren't allocated from the sample pool must remain
+ *       valid until their set is reassembled or dropped.
+ *
+ * @param mes       The measurement to process.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 or a STEP_NODE_RC_* code on success, negative error code
+ *                  on failure.
+ */
+int step_frag_reassemble_exec(struct step_measurement *mes, uint32_t handle,
+			      uint32_t inst);
+
+/**
+ * @brief Drops every partially reassembled set, freeing the held fragments.
+ */
+void step_frag_flush(void);
+
+/**
+ * @brief Copies part of a reassembled payload into a contiguous buffer.
+ *
+ * @param view      The reassembled payload.
+ * @param offset    Offset in the payload to start copying from.
+ * @param dst       Destination buffer.
+ * @param len       Number of bytes to copy.
+ *
+ * @return int      0 on success, -EINVAL if the range is out of bounds.
+ */
+int step_frag_view_copy(const struct step_frag_view *view, uint32_t offset,
+			void *dst, uint32_t len);
+
+/**
+ * @brief Splits a measurement into fragments of at most 'max_len' payload
+ *        bytes without copying, handing each of them to 'emit' in order.
+ *
+ * Measurements that fit in 'max_len' are passed to 'emit' as-is.
+ *
+ * @param mes       The measurement to split.
+ * @param max_len   Maximum payload length of a fragment, which must be larger
+ *                  than the timestamp.
+ * @param emit      Callback receiving each fragment.
+ * @param user_data User data passed to 'emit'.
+ *
+ * @return int      0 on success, -EINVAL on invalid arguments, otherwise the
+ *                  error returned by 'emit'.
+ */
+int step_frag_split(struct step_measurement *mes, uint16_t max_len,
+		    step_frag_emit_t emit, void *user_data);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_FRAG_H_ */
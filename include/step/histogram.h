@@ -0,0 +1,195 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_HISTOGRAM_H__
+#define STEP_HISTOGRAM_H__
+
+#include <step/step.h>
+
+/**
+ * @defgroup HISTOGRAM Latency Histograms
+ * @ingroup step_api
+ * @brief API header file for log-linear latency histograms.
+ *
+ * Values are counted in buckets that are exact below
+ * 2^CONFIG_STEP_HIST_SUB_BITS, and above that split every power of two into
+ * 2^CONFIG_STEP_HIST_SUB_BITS linear sub-buckets, as in HdrHistogram. Any
+ * 32-bit value can be recorded in constant time, and percentiles are
+ * reported with a relative error of at most 2^-CONFIG_STEP_HIST_SUB_BITS
+ * (25% with the default of 2 bits), without the tail being averaged away.
+ *
+ * A histogram takes (33 - CONFIG_STEP_HIST_SUB_BITS) *
+ * 2^CONFIG_STEP_HIST_SUB_BITS * 4 bytes of bucket counts, 496 bytes with the
+ * default settings.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Number of linear sub-buckets in every power of two. */
+#define STEP_HIST_SUB_COUNT     (1U << CONFIG_STEP_HIST_SUB_BITS)
+
+/** Total number of buckets, covering all 32-bit values. */
+#define STEP_HIST_BUCKETS       ((33 - CONFIG_STEP_HIST_SUB_BITS) << \
+				 CONFIG_STEP_HIST_SUB_BITS)
+
+/**
+ * @brief Log-linear histogram. Zero-initialise or call @ref step_hist_reset
+ *        before use.
+ */
+struct step_hist {
+	/** Number of recorded values. */
+	uint32_t count;
+	/** Smallest recorded value, if 'count' is non-zero. */
+	uint32_t min;
+	/** Largest recorded value. */
+	uint32_t max;
+	/** Sum of all recorded values. */
+	uint64_t sum;
+	/** Number of values recorded in each bucket. */
+	uint32_t buckets[STEP_HIST_BUCKETS];
+};
+
+/**
+ * @brief Summary statistics of a histogram. Percentiles are the highest
+ *        value in the bucket they fall in, capped to the maximum.
+ */
+struct step_hist_summary {
+	/** Number of recorded values. */
+	uint32_t count;
+	/** Smallest recorded value. */
+	uint32_t min;
+	/** Largest recorded value. */
+	uint32_t max;
+	/** Mean of the recorded values. */
+	uint32_t mean;
+	/** 50th percentile (median). */
+	uint32_t p50;
+	/** 99th percentile. */
+	uint32_t p99;
+	/** 99.9th percentile. */
+	uint32_t p999;
+};
+
+/**
+ * @brief Returns the bucket that 'val' is counted in.
+ */
+static inline uint32_t step_hist_bucket(uint32_t val)
+{
+	uint32_t shift;
+
+	if (val < STEP_HIST_SUB_COUNT) {
+		return val;
+	}
+
+	/* The top CONFIG_STEP_HIST_SUB_BITS + 1 bits select the bucket. */
+	shift = 31 - __builtin_clz(val) - CONFIG_STEP_HIST_SUB_BITS;
+
+	return ((shift + 1) << CONFIG_STEP_HIST_SUB_BITS) |
+	       ((val >> shift) & (STEP_HIST_SUB_COUNT - 1));
+}
+
+/**
+ * @brief Records a value.
+ *
+ * @param h     The histogram.
+ * @param val   The value to record.
+ */
+static inline void step_hist_record(struct step_hist *h, uint32_t val)
+{
+	if ((h->count == 0) || (val < h->min)) {
+		h->min = val;
+	}
+	if (val > h->max) {
+		h->max = val;
+	}
+	h->count++;
+	h->sum += val;
+	h->buckets[step_hist_bucket(val)]++;
+}
+
+/**
+ * @brief Records a value that stands for 'n' values, such as a sample taken
+ *        from one in every 'n' events.
+ *
+ * @param h     The histogram.
+ * @param val   The value to record.
+ * @param n     The weight of the value.
+ */
+static inline void step_hist_record_n(struct step_hist *h, uint32_t val,
+				      uint32_t n)
+{
+	if ((h->count == 0) || (val < h->min)) {
+		h->min = val;
+	}
+	if (val > h->max) {
+		h->max = val;
+	}
+	h->count += n;
+	h->sum += (uint64_t)val * n;
+	h->buckets[step_hist_bucket(val)] += n;
+}
+
+/**
+ * @brief Clears all recorded values.
+ *
+ * @param h     The histogram.
+ */
+void step_hist_reset(struct step_hist *h);
+
+/**
+ * @brief Adds the values recorded in 'src' to 'dst'.
+ *
+ * @param dst   The histogram to add to.
+ * @param src   The histogram to add.
+ */
+void step_hist_merge(struct step_hist *dst, const struct step_hist *src);
+
+/**
+ * @brief Returns the highest value in the bucket 'bucket'.
+ */
+uint32_t step_hist_bucket_max(uint32_t bucket);
+
+/**
+ * @brief Returns the value below which a given share of the recorded values
+ *        fall.
+ *
+ * @param h     The histogram.
+ * @param pcm   The percentile, in thousandths of a percent (per cent mille),
+ *              such as 99900 for the 99.9th percentile.
+ *
+ * @return uint32_t The highest value in the bucket holding the percentile,
+ *                  capped to the maximum recorded value, or 0 if the
+ *                  histogram is empty.
+ */
+uint32_t step_hist_percentile(const struct step_hist *h, uint32_t pcm);
+
+/**
+ * @brief Computes the summary statistics of a histogram.
+ *
+ * @param h     The histogram.
+ * @param s     The summary to fill in. All fields are 0 if the histogram is
+ *              empty.
+ */
+void step_hist_summarise(const struct step_hist *h,
+			 struct step_hist_summary *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_HISTOGRAM_H_ */
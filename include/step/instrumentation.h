@@ -13,29 +13,95 @@
 
 /**
  * @file
+ *
+ * Instrumentation records raw timer cycles. Converting them to ns takes a
+ * 64-bit division, so that is left to whoever reports the values, see
+ * @ref STEP_INSTR_TO_NS.
  */
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief A timer cycle count, or an interval between two of them. This is
+ *        64-bit wide if the system timer provides a 64-bit cycle counter, so
+ *        that long intervals can't wrap.
+ */
+#if CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+typedef uint64_t step_instr_cyc_t;
+#define STEP_INSTR_CYC_NOW() k_cycle_get_64()
+#else
+typedef uint32_t step_instr_cyc_t;
+#define STEP_INSTR_CYC_NOW() k_cycle_get_32()
+#endif
+
 #if CONFIG_STEP_INSTRUMENTATION
 /**
- * @brief Reads the high-precision timer start time.
+ * @brief Cost in cycles of a START/STOP pair with nothing between them, which
+ *        @ref STEP_INSTR_STOP subtracts from every interval.
+ */
+extern uint32_t step_instr_overhead_cyc;
+
+/**
+ * @brief Reads the high-precision timer start time into 't', which must be a
+ *        @ref step_instr_cyc_t.
+ */
+#define STEP_INSTR_START(t) do {		     \
+		(t) = STEP_INSTR_CYC_NOW();	     \
+} while (0)
+
+/**
+ * @brief Reads the high-precision timer stop time, and replaces 't' with the
+ *        cycles elapsed since @ref STEP_INSTR_START, less the calibrated
+ *        instrumentation overhead. Unsigned subtraction handles a counter
+ *        that wrapped once in between.
  */
-#define STEP_INSTR_START(t) do {	      \
-		t = k_cycle_get_32(); \
-} while (0);
+#define STEP_INSTR_STOP(t) do {					      \
+		step_instr_cyc_t _cyc = STEP_INSTR_CYC_NOW() - (t);   \
+		(t) = (_cyc > step_instr_overhead_cyc) ?	      \
+		      _cyc - step_instr_overhead_cyc : 0;	      \
+} while (0)
 
 /**
- * @brief Reads the high-precision timer stop time and converts to ns. This
- *        function modifies the value of t to store the execution time in ns.
+ * @brief Calibrates the instrumentation overhead, as the shortest of a series
+ *        of empty START/STOP pairs. This runs once at boot, and can be run
+ *        again if the CPU clock changes.
  */
-#define STEP_INSTR_STOP(t) do {				      \
-		uint32_t end = k_cycle_get_32();	      \
-		t = end < t ? 0xFFFFFFFF - t + end : end - t; \
-		t = k_cyc_to_ns_floor32(t);		      \
-} while (0);
+void step_instr_calibrate(void);
+
+/**
+ * @brief Returns the calibrated instrumentation overhead, in cycles.
+ */
+static inline uint32_t step_instr_overhead(void)
+{
+	return step_instr_overhead_cyc;
+}
 
 #else
-#define STEP_INSTR_START(t) do { } while(0);
-#define STEP_INSTR_STOP(t) do { } while(0);
+#define STEP_INSTR_START(t) do { } while (0)
+#define STEP_INSTR_STOP(t) do { } while (0)
+#endif
+
+/**
+ * @brief Converts a cycle count to ns, rounding down.
+ */
+#define STEP_INSTR_TO_NS(c) k_cyc_to_ns_floor64(c)
+
+/**
+ * @brief Clamps a cycle count to 32 bits, for storage in a histogram.
+ */
+static inline uint32_t step_instr_cyc_32(step_instr_cyc_t c)
+{
+#if CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+	return (c > UINT32_MAX) ? UINT32_MAX : (uint32_t)c;
+#else
+	return c;
+#endif
+}
+
+#ifdef __cplusplus
+}
 #endif
 
 #endif /* STEP_INSTRUMENTATION_H_ */
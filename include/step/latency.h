@@ -0,0 +1,140 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_LATENCY_H__
+#define STEP_LATENCY_H__
+
+#include <step/step.h>
+#include <step/histogram.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup LATENCY End-to-end Latency Tracing
+ * @ingroup step_api
+ * @brief API header file for end-to-end measurement latency tracing.
+ *
+ * Measurements are stamped with the cycle counter when they are allocated
+ * from the sample pool, queued with @ref step_pm_put, and taken off the
+ * queue by the processor manager. When a node chain that has subscribers
+ * completes, the time spent in each phase is recorded once in a histogram
+ * for the measurement's source ID:
+ *
+ * - Fill: allocation to @ref step_pm_put, the time the producer needs to
+ *   populate the measurement.
+ * - Queue: @ref step_pm_put to the start of processing.
+ * - Service: the start of processing to subscriber delivery, including
+ *   filter evaluation and every node in the chain.
+ * - Total: allocation to subscriber delivery.
+ *
+ * Measurements that didn't come from the sample pool are considered
+ * allocated when they are queued, so their fill time is 0.
+ *
+ * Source IDs 0 to CONFIG_STEP_LATENCY_SOURCES - 2 are tracked individually,
+ * and all other source IDs share the last slot.
+ *
+ * Latencies are recorded in timer cycles, and only converted to ns when
+ * they are reported, where they saturate at UINT32_MAX ns.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief The phases of a measurement's lifetime that latency is tracked for.
+ */
+enum step_lat_phase {
+	/** Allocation to being queued. */
+	STEP_LAT_FILL           = 0,
+	/** Queued to the start of processing. */
+	STEP_LAT_QUEUE          = 1,
+	/** Start of processing to subscriber delivery. */
+	STEP_LAT_SERVICE        = 2,
+	/** Allocation to subscriber delivery. */
+	STEP_LAT_TOTAL          = 3,
+	/** Number of tracked phases. */
+	STEP_LAT_PHASES         = 4,
+};
+
+#if CONFIG_STEP_LATENCY
+
+/**
+ * @brief Stamps the measurement as allocated.
+ */
+static inline void step_lat_stamp_alloc(struct step_measurement *mes)
+{
+	mes->queue.stamp_alloc = k_cycle_get_32();
+}
+
+/**
+ * @brief Stamps the measurement as queued. Measurements that didn't come
+ *        from the sample pool are also stamped as allocated.
+ */
+static inline void step_lat_stamp_put(struct step_measurement *mes)
+{
+	mes->queue.stamp_put = k_cycle_get_32();
+	if (!mes->queue.free_after_use) {
+		mes->queue.stamp_alloc = mes->queue.stamp_put;
+	}
+}
+
+/**
+ * @brief Stamps the measurement as taken off the queue, and records the fill
+ *        and queue times.
+ *
+ * @param mes   The measurement being processed.
+ */
+void step_lat_record_dequeue(struct step_measurement *mes);
+
+/**
+ * @brief Records the service and total times of a measurement being
+ *        delivered to a node chain's subscribers.
+ *
+ * @param mes   The measurement being delivered.
+ */
+void step_lat_record_delivery(const struct step_measurement *mes);
+
+/**
+ * @brief Returns the latency summary of a phase for a source ID.
+ *
+ * @param sourceid  The source ID. IDs without their own slot return the
+ *                  statistics shared by all such sources.
+ * @param phase     The phase to report.
+ * @param s         The summary to fill in, in nanoseconds.
+ *
+ * @return int  0 on success, -EINVAL if 'phase' is invalid.
+ */
+int step_lat_get(uint8_t sourceid, enum step_lat_phase phase,
+		 struct step_hist_summary *s);
+
+/**
+ * @brief Clears all recorded latencies.
+ */
+void step_lat_reset(void);
+
+/**
+ * @brief Prints the latency summaries of every source ID that has recorded
+ *        deliveries.
+ */
+void step_lat_print(void);
+
+#endif /* CONFIG_STEP_LATENCY */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_LATENCY_H_ */
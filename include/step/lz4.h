@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_LZ4_H__
+#define STEP_LZ4_H__
+
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup LZ4 LZ4 Payload Compression
+ * @ingroup step_api
+ * @brief API header file for LZ4 payload compression.
+ *
+ * Provides an LZ4 block format encoder and decoder, along with processor
+ * node callbacks that compress or decompress measurement payloads in place.
+ *
+ * Compressed payloads have the following layout:
+ *
+ * <PRE>
+ * +-------------------------+------------------+-----------------------+
+ * | Timestamp (if present)  | Orig. len (u16)  | LZ4 block             |
+ * +-------------------------+------------------+-----------------------+
+ * </PRE>
+ *
+ * The timestamp is kept uncompressed so that measurements can be ordered
+ * without decompressing them, and 'Orig. len' is the little-endian length
+ * of the uncompressed data following the timestamp.
+ *
+ * In streaming mode, the last CONFIG_STEP_NODE_LZ4_DICT_SIZE bytes of
+ * uncompressed data from each source ID are used as a dictionary for the
+ * next measurement from that source, which greatly improves the ratio for
+ * small, similar consecutive samples. These payloads are flagged with
+ * @ref STEP_MES_COMPRESSION_LZ4_STREAM, and can only be decompressed if
+ * every previous measurement from the same source was decompressed, in
+ * order, by a decoder also running in streaming mode. The encoder emits an
+ * independent @ref STEP_MES_COMPRESSION_LZ4 block whenever it has no
+ * dictionary for a source, which resets the decoder's dictionary as well.
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Compressor state. Can be reused across calls, but not shared between
+ *        concurrent callers.
+ */
+struct step_lz4_ctx {
+	/**
+	 * @brief Hash table of recent input positions. Doesn't need to be
+	 *        initialised, since stale entries are verified before use.
+	 */
+	uint16_t table[1 << CONFIG_STEP_NODE_LZ4_HASH_LOG];
+};
+
+/**
+ * @brief Config settings for the LZ4 compress and decompress nodes, assigned
+ *        to the node's 'config' field. A NULL config selects block mode.
+ */
+struct step_lz4_cfg {
+	/**
+	 * @brief Carry a per-source dictionary between consecutive measurements.
+	 */
+	bool stream;
+};
+
+/**
+ * @brief Compresses a buffer into an LZ4 block.
+ *
+ * @param ctx       Compressor state.
+ * @param src       Input buffer, starting with 'dict_len' bytes of dictionary
+ *                  data, followed by the data to compress.
+ * @param src_len   Total length of 'src' in bytes, including the dictionary.
+ *                  Must not exceed 65535 bytes.
+ * @param dict_len  Number of dictionary bytes at the start of 'src'.
+ * @param dst       Output buffer for the LZ4 block.
+ * @param dst_len   Size of 'dst' in bytes.
+ *
+ * @return int      The length of the LZ4 block, -ENOSPC if it doesn't fit in
+ *                  'dst', or -EINVAL on invalid arguments.
+ */
+int step_lz4_compress(struct step_lz4_ctx *ctx, const uint8_t *src,
+		      uint32_t src_len, uint32_t dict_len, uint8_t *dst,
+		      uint32_t dst_len);
+
+/**
+ * @brief Decompresses an LZ4 block.
+ *
+ * @param src       The LZ4 block.
+ * @param src_len   Length of 'src' in bytes.
+ * @param dst       Output buffer, starting with 'dict_len' bytes of dictionary
+ *                  data. Decompressed data is written after the dictionary.
+ * @param dict_len  Number of dictionary bytes at the start of 'dst'.
+ * @param dst_len   Total size of 'dst' in bytes, including the dictionary.
+ *
+ * @return int      The number of decompressed bytes, -ENOSPC if they don't
+ *                  fit in 'dst', or -EINVAL if the block is malformed.
+ */
+int step_lz4_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst,
+			uint32_t dict_len, uint32_t dst_len);
+
+/**
+ * @brief Node exec callback compressing the measurement's payload in place.
+ *
+ * Measurements that are already compressed are left untouched, as are
+ * payloads that don't shrink when compressed.
+ *
+ * @param mes       The measurement to compress.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_lz4_compress_exec(struct step_measurement *mes, uint32_t handle,
+			   uint32_t inst);
+
+/**
+ * @brief Node exec callback decompressing the measurement's payload in place.
+ *
+ * Measurements that aren't LZ4 compressed are left untouched. The payload
+ * buffer must be large enough for the uncompressed data, see
+ * @ref step_measurement.capacity.
+ *
+ * @param mes       The measurement to decompress.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, negative error code on failure.
+ */
+int step_lz4_decompress_exec(struct step_measurement *mes, uint32_t handle,
+			     uint32_t inst);
+
+/**
+ * @brief Drops all streaming dictionaries, for the compressor and the
+ *        decompressor.
+ */
+void step_lz4_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_LZ4_H_ */
@@ -113,8 +113,10 @@
  *           Compression algorithm used on the payload:
  *
  *           0 = None
- *           1 = LZ4
- *           2..7 = Reserved
+ *           1 = LZ4 (independent block)
+ *           2 = LZ4 (block depending on the previous block from this source)
+ *           3 = XOR/delta-of-delta time-series (TSC)
+ *           4..7 = Reserved
  *
  *       o Timestamp      [10:12]
  *
@@ -342,6 +344,16 @@ struct step_measurement {
 
 	/** Payload contents. */
 	void *payload;
+
+	/**
+	 * @brief Size of the payload buffer in bytes, which may be larger than
+	 *        the current payload length. Leave at 0 if the buffer is exactly
+	 *        'header.srclen.len' bytes long.
+	 *
+	 * Nodes that grow the payload in place, such as decompression, use this
+	 * to make sure the result fits in the buffer.
+	 */
+	uint16_t capacity;
 };
 
 /** Payload data structure used. */
@@ -368,6 +380,10 @@ enum step_mes_compression {
 	STEP_MES_COMPRESSION_NONE       = 0,
 	/** LZ4 compression. */
 	STEP_MES_COMPRESSION_LZ4        = 1,
+	/** LZ4 compression, using the source's previous payload as dictionary. */
+	STEP_MES_COMPRESSION_LZ4_STREAM = 2,
+	/** XOR and delta-of-delta time-series compression (Gorilla). */
+	STEP_MES_COMPRESSION_TSC        = 3,
 };
 
 /** Optional timestamp format used. */
@@ -408,6 +424,17 @@ enum step_mes_vector_sz {
 	STEP_MES_VECTOR_SZ_4            = 3,
 };
 
+/**
+ * @brief Calculates the number of bytes required to represent the specified
+ *        timestamp in memory.
+ *
+ * @param ts        The @ref step_mes_timestamp to get the size of.
+ *
+ * @return uint32_t The number of bytes required to represent @ref ts in
+ *                  memory.
+ */
+uint32_t step_mes_sz_timestamp(enum step_mes_timestamp ts);
+
 /**
  * @brief Calculates the minimum number of bytes required for the measurement
  *        payload, taking into account the timestamp, ctype, sample count and
@@ -428,6 +455,9 @@ int32_t step_mes_sz_payload(struct step_mes_header *hdr);
 /**
  * @brief Checks the populated @ref step_measurement for common errors, such
  *        as the payload length being too small for the minimum payload.
+ *
+ * The payload length of compressed measurements isn't checked, since it
+ * depends on the payload contents.
  * 
  * @param msg       The populated measurement to validate. 
  * 
@@ -56,6 +56,16 @@ enum step_mes_unit_ctype {
 	STEP_MES_UNIT_CTYPE_BOOL                        = 0x1D,
 	STEP_MES_UNIT_CTYPE_COMPLEX_32                  = 0x30,
 	STEP_MES_UNIT_CTYPE_COMPLEX_64                  = 0x31,
+	/**
+	 * @brief Signed Q1.15 fixed-point, int16_t, where the value is
+	 *        q * 2^-15 * 10^scale_factor.
+	 */
+	STEP_MES_UNIT_CTYPE_Q15                         = 0x40,
+	/**
+	 * @brief Signed Q1.31 fixed-point, int32_t, where the value is
+	 *        q * 2^-31 * 10^scale_factor.
+	 */
+	STEP_MES_UNIT_CTYPE_Q31                         = 0x41,
 
 	/* 0x80..0x8F: Range types (unit interval, percent, etc.) */
 	/** @brief 0..1.0 inclusive, STEP_MES_UNIT_CTYPE_FLOAT32. */
@@ -38,6 +38,27 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Return code for the start, exec and stop callbacks, indicating that
+ *        this node consumed the measurement. The remaining nodes in the chain
+ *        still run, but no other records in the processor node registry will
+ *        be evaluated against the measurement.
+ *
+ * @note  This can be combined with @ref STEP_NODE_RC_ABORT_CHAIN.
+ */
+#define STEP_NODE_RC_CONSUMED           (1 << 0)
+
+/**
+ * @brief Return code for the start, exec and stop callbacks, indicating that
+ *        the remaining nodes in this node chain should be skipped. Callbacks
+ *        of the current node still fire, but subscribers to the chain won't
+ *        be notified since it didn't complete. Evaluation of the rest of the
+ *        registry continues as normal.
+ *
+ * @note  This can be combined with @ref STEP_NODE_RC_CONSUMED.
+ */
+#define STEP_NODE_RC_ABORT_CHAIN        (1 << 1)
+
 /**
  * @typedef step_node_init_t
  * @brief Init callback prototype for node implementations.
@@ -58,7 +79,8 @@ typedef int (*step_node_init_t)(void *cfg, uint32_t handle, uint32_t inst);
  * @param handle    The handle of the source node this callback.
  * @param inst      step_node instance in a node chain (zero-based).
  *
- * @return 0 on success, negative error code on failure
+ * @return 0 on success, negative error code on failure, or a combination of
+ *         STEP_NODE_RC_* flags to control further processing.
  */
 typedef int (*step_node_callback_t)(struct step_measurement *mes,
 				    uint32_t handle, uint32_t inst);
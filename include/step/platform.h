@@ -17,6 +17,12 @@
 struct step_platform_queue {
     struct k_work work;
     bool free_after_use;
+#if CONFIG_STEP_LATENCY
+    /* Cycle counter when allocated, queued and dequeued. */
+    uint32_t stamp_alloc;
+    uint32_t stamp_put;
+    uint32_t stamp_dequeue;
+#endif
 };
 
 #else
@@ -7,9 +7,13 @@
 #ifndef STEP_PROC_MGR_H__
 #define STEP_PROC_MGR_H__
 
+#include <zephyr/sys/iterable_sections.h>
 #include <step/sample_pool.h>
 #include <step/step.h>
 #include <step/node.h>
+#if CONFIG_STEP_INSTRUMENTATION
+#include <step/histogram.h>
+#endif
 
 /**
  * @defgroup PROCMGR Processor Node Management
@@ -55,6 +59,119 @@ extern "C" {
  */
 typedef void (*node_chain_completed_callback)(struct step_measurement *mes, uint32_t node_handle, void* user_data);
 
+/**
+ * @brief Runtime counters of a registered node or node chain.
+ */
+struct step_pm_node_stats {
+	/** @brief Measurements evaluated against the chain's filters. */
+	uint32_t evals;
+	/** @brief Evaluations that matched, running the chain. */
+	uint32_t matches;
+	/** @brief Runs that a node aborted before the end of the chain. */
+	uint32_t aborts;
+	/** @brief Node callbacks that returned a negative error code. */
+	uint32_t errors;
+};
+
+/**
+ * @brief Processor manager statistics.
+ */
+struct step_pm_stats {
+	/** @brief Measurements queued with @ref step_pm_put. */
+	uint32_t queued;
+	/** @brief Measurements taken off the queue and processed. */
+	uint32_t processed;
+	/** @brief Measurements currently waiting in the queue. */
+	uint32_t queue_depth;
+	/** @brief High-water mark of 'queue_depth'. */
+	uint32_t queue_peak;
+	/** @brief Measurements dropped because no enabled node matched them. */
+	uint32_t dropped;
+	/** @brief Measurements that @ref step_pm_put failed to queue. */
+	uint32_t put_errors;
+	/** @brief Measurements rejected because the queue was full, see
+	 *         CONFIG_STEP_PROC_MGR_QUEUE_LIMIT. */
+	uint32_t rejected;
+	/** @brief Number of registered nodes or node chains. */
+	uint32_t nodes;
+};
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+/**
+ * @brief Processing worker activity over one monitoring interval.
+ */
+struct step_pm_monitor_sample {
+	/** @brief Share of CPU time spent in the worker, in permille. */
+	uint16_t worker_load;
+	/** @brief Share of CPU time not spent idle, in permille. Requires
+	 *         CONFIG_SCHED_THREAD_USAGE_ALL, 0 otherwise. */
+	uint16_t cpu_load;
+	/** @brief Measurements waiting in the queue at the end of the
+	 *         interval. */
+	uint32_t queue_depth;
+	/** @brief Measurements processed during the interval. */
+	uint32_t processed;
+};
+
+/**
+ * @brief Stack usage and recent activity of the processing worker.
+ */
+struct step_pm_worker_stats {
+	/** @brief Size of the worker's stack, in bytes. */
+	size_t stack_size;
+	/** @brief Most stack the worker has used since startup, in bytes. */
+	size_t stack_used;
+	/** @brief Cycles the worker has spent running since startup. */
+	uint64_t busy_cycles;
+	/** @brief Number of valid entries in 'history'. */
+	uint32_t samples;
+	/** @brief The most recent monitoring intervals, oldest first. */
+	struct step_pm_monitor_sample history[CONFIG_STEP_PROC_MGR_MONITOR_HISTORY];
+};
+#endif
+
+/**
+ * @brief A statically registered processor node or node chain.
+ *
+ * Records of this type are placed in a read-only iterable section. Use
+ * @ref STEP_NODE_DEFINE to declare them.
+ */
+struct step_pm_static_node {
+	/**
+	 * @brief The processor node or node chain to register.
+	 */
+	struct step_node *node;
+
+	/**
+	 * @brief Priority level (larger = higher priority).
+	 */
+	uint16_t priority;
+};
+
+/**
+ * @brief Declares a processor node or node chain to register at startup.
+ *
+ * The node and its priority are placed in a constant table in flash. The
+ * table is sorted by priority and each entry is registered with
+ * @ref step_pm_register during system initialisation, before 'main' is
+ * called, so the application doesn't need its own registration code.
+ *
+ * Nodes with the same priority are registered in order of @p name.
+ *
+ * @param name  Unique identifier for this registration.
+ * @param _node Address of the @ref step_node (or first node in the chain).
+ * @param _pri  Priority level (larger = higher priority), any constant
+ *              expression between 0 and 65535.
+ */
+#define STEP_NODE_DEFINE(name, _node, _pri)					\
+	BUILD_ASSERT(((_pri) >= 0) && ((_pri) <= UINT16_MAX),			\
+		     "STeP node priority must be between 0 and 65535");		\
+	static const STRUCT_SECTION_ITERABLE(step_pm_static_node,		\
+		_CONCAT(step_pm_static_node_, name)) = {			\
+		.node = (_node),						\
+		.priority = (_pri),						\
+	}
+
 /**
  * @brief Registers a new processor node.
  *
@@ -72,6 +189,11 @@ typedef void (*node_chain_completed_callback)(struct step_measurement *mes, uint
  * processing the measurement in destructive nodes later in the processing
  * pipeline.
  *
+ * If CONFIG_STEP_PROC_MGR_REORDER is enabled, nodes with the same priority
+ * are periodically reordered so that the nodes that match most often are
+ * evaluated first. Only use the same priority level for nodes that don't
+ * depend on the order in which they run.
+ *
  * @param node      The processor node to register with the manager.
  * @param pri       The priority level for this node (larger = higher priority).
  * @param handle    The handle the node has been registered under. Set to
@@ -81,6 +203,31 @@ typedef void (*node_chain_completed_callback)(struct step_measurement *mes, uint
  */
 int step_pm_register(struct step_node *node, uint16_t pri, uint32_t *handle);
 
+/**
+ * @brief Registers every processor node declared with @ref STEP_NODE_DEFINE,
+ *        from highest to lowest priority.
+ *
+ * This is called automatically during system initialisation, and only needs
+ * to be called again to restore the static nodes after @ref step_pm_clear.
+ *
+ * @note If any node can't be registered, the registry is cleared with
+ *       @ref step_pm_clear, including any nodes registered at runtime.
+ *
+ * @return int  0 on success, -ENOMEM if the static nodes don't fit in the
+ *              registry, or another negative error code on failure.
+ */
+int step_pm_register_static(void);
+
+/**
+ * @brief Gets the handle a node or node chain has been registered under.
+ *
+ * @param node      The processor node to search for.
+ * @param handle    The handle the node has been registered under.
+ *
+ * @return int  0 on success, -ENOENT if the node isn't registered.
+ */
+int step_pm_handle_get(struct step_node *node, uint32_t *handle);
+
 /**
  * @brief Gets a pointer to the node or node chain associated with the
  *        specified handle.
@@ -96,6 +243,9 @@ struct step_node* step_pm_node_get(uint32_t handle, uint32_t inst);
 /**
  * @brief Clears the registry, and resets the manager to it's default state.
  *
+ * @note This also removes any nodes declared with @ref STEP_NODE_DEFINE.
+ *       Call @ref step_pm_register_static to register them again.
+ *
  * @return int  0 on success, negative error code on failure.
  */
 int step_pm_clear(void);
@@ -104,9 +254,19 @@ int step_pm_clear(void);
  * @brief Adds the specified step_measurement to the processor manager
  *      internal queue to be evaulated.
  *
+ * Measurements allocated from the sample pool are freed once processing is
+ * complete, unless a node took ownership of the measurement by clearing
+ * 'mes->queue.free_after_use' while processing it. That node then becomes
+ * responsible for freeing it.
+ *
+ * If CONFIG_STEP_PROC_MGR_QUEUE_LIMIT is set and that many measurements
+ * are already waiting to be processed, the measurement is rejected and the
+ * caller keeps ownership of it.
+ *
  * @param mes The step_measurement to add.
  *
- * @return int  0 on success, negative error code on failure.
+ * @return int  0 on success, -ENOBUFS if the queue is full, negative error
+ *              code on other failures.
  */
 int step_pm_put(struct step_measurement *mes);
 
@@ -128,6 +288,20 @@ int step_pm_disable_node(uint32_t handle);
  */
 int step_pm_enable_node(uint32_t handle);
 
+/**
+ * @brief Marks a registered processor node as an exclusive consumer.
+ *
+ * When an exclusive node or node chain matches a measurement, it consumes
+ * it: once the chain has run, no lower-ranking records in the registry are
+ * evaluated against that measurement.
+ *
+ * @param handle    The handle the node has been registered under.
+ * @param exclusive true to make the node exclusive, false to clear the flag.
+ *
+ * @return int  0 on success, negative error code on failure.
+ */
+int step_pm_set_exclusive(uint32_t handle, bool exclusive);
+
 /**
  * @brief Registers a callback to a particular node chain.
  *
@@ -147,6 +321,103 @@ int step_pm_subscribe_to_node(uint32_t handle, node_chain_completed_callback cb,
  */
 int step_pm_list(void);
 
+/**
+ * @brief Returns a snapshot of the processor manager statistics.
+ *
+ * @param stats The struct to fill in.
+ */
+void step_pm_stats_get(struct step_pm_stats *stats);
+
+/**
+ * @brief Clears the processor manager statistics and the counters of every
+ *        registered node. The queue high-water mark is reset to the current
+ *        queue depth.
+ */
+void step_pm_stats_reset(void);
+
+/**
+ * @brief Returns a snapshot of the runtime counters of a node chain.
+ *
+ * @param handle    The handle the node has been registered under.
+ * @param stats     The struct to fill in.
+ *
+ * @return int  0 on success, -EINVAL if the handle is invalid.
+ */
+int step_pm_node_stats_get(uint32_t handle, struct step_pm_node_stats *stats);
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+/**
+ * @brief Returns the processing worker's stack high-water mark, and its CPU
+ *        load and queue depth over the last
+ *        CONFIG_STEP_PROC_MGR_MONITOR_HISTORY monitoring intervals.
+ *
+ * A worker load close to 1000 permille, or a queue depth that keeps
+ * growing, means the worker is saturated.
+ *
+ * @param stats The struct to fill in.
+ *
+ * @return int  0 on success, negative error code if the stack usage can't
+ *              be read.
+ */
+int step_pm_worker_stats_get(struct step_pm_worker_stats *stats);
+
+/**
+ * @brief Prints the processing worker's stack usage and activity history.
+ */
+void step_pm_worker_print(void);
+#endif
+
+#if CONFIG_STEP_INSTRUMENTATION
+/**
+ * @brief Returns the latency distribution of a node chain, or of one of the
+ *        nodes in it, in ns.
+ *
+ * Latencies are only recorded for runs where the chain's filters matched.
+ * The chain's latency includes filter evaluation, and the latency of each
+ * node covers its start, exec and stop callbacks.
+ *
+ * @param handle    The handle the node has been registered under.
+ * @param stage     The node instance in the chain, or -1 for the whole chain.
+ *                  Only the first CONFIG_STEP_INSTRUMENTATION_STAGES nodes
+ *                  are tracked individually.
+ * @param lat       The latency summary.
+ *
+ * @return int  0 on success, -EINVAL if the handle is invalid, -ENOTSUP if
+ *              'stage' isn't tracked.
+ */
+int step_pm_node_latency(uint32_t handle, int32_t stage,
+			 struct step_hist_summary *lat);
+
+/**
+ * @brief Clears the latency histograms of a node chain.
+ *
+ * @param handle    The handle the node has been registered under.
+ *
+ * @return int  0 on success, -EINVAL if the handle is invalid.
+ */
+int step_pm_node_latency_reset(uint32_t handle);
+
+/**
+ * @brief Sets the instrumentation sample rate, so that the processing of
+ *        one in every 'rate' measurements is timed.
+ *
+ * Each timed run is recorded as 'rate' runs, so latency histogram counts
+ * and percentiles estimate those of every run. With
+ * CONFIG_STEP_INSTRUMENTATION_BUDGET, the rate is adjusted automatically,
+ * starting from the one set here.
+ *
+ * @param rate  The sample rate, from 1 (every measurement) to 65535.
+ *
+ * @return int  0 on success, -EINVAL if the rate is out of range.
+ */
+int step_pm_instr_rate_set(uint32_t rate);
+
+/**
+ * @brief Returns the current instrumentation sample rate.
+ */
+uint32_t step_pm_instr_rate_get(void);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
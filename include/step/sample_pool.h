@@ -37,6 +37,26 @@
 extern "C" {
 #endif
 
+/**
+ * @brief Sample pool statistics.
+ */
+struct step_sp_stats {
+	/** @brief Bytes currently allocated, see @ref step_sp_bytes_alloc. */
+	int32_t bytes_alloc;
+	/** @brief High-water mark of 'bytes_alloc'. */
+	int32_t bytes_alloc_peak;
+	/** @brief Total bytes allocated. */
+	uint32_t bytes_alloc_total;
+	/** @brief Number of calls to @ref step_sp_free. */
+	uint32_t pool_free_calls;
+	/** @brief Total bytes freed. */
+	uint32_t bytes_freed_total;
+	/** @brief Number of calls to @ref step_sp_alloc. */
+	uint32_t pool_alloc_calls;
+	/** @brief Number of allocations that failed for lack of memory. */
+	uint32_t alloc_failures;
+};
+
 /**
  * @brief Frees the heap memory associated with 'ds'.
  *
@@ -73,6 +93,36 @@ struct step_measurement *step_sp_alloc(uint16_t sz);
  */
 int32_t step_sp_bytes_alloc(void);
 
+/**
+ * @brief Returns the highest number of bytes allocated from the sample pool's
+ *        heap memory at any one time since startup, or since the last call to
+ *        @ref step_sp_reset_peak. Uses the same accounting as
+ *        @ref step_sp_bytes_alloc.
+ *
+ * @return int32_t The high-water mark in bytes.
+ */
+int32_t step_sp_bytes_alloc_peak(void);
+
+/**
+ * @brief Resets the high-water mark to the number of bytes currently
+ *        allocated.
+ */
+void step_sp_reset_peak(void);
+
+/**
+ * @brief Returns a snapshot of the sample pool statistics.
+ *
+ * @param stats The struct to fill in.
+ */
+void step_sp_stats_get(struct step_sp_stats *stats);
+
+/**
+ * @brief Clears the cumulative sample pool statistics, and resets the
+ *        high-water mark to the number of bytes currently allocated.
+ *        'bytes_alloc' isn't affected.
+ */
+void step_sp_stats_reset(void);
+
 /**
  * @brief Prints the contents of the statistics struct. Useful for debug
  *        purposes to detect memory leaks, etc.
@@ -0,0 +1,135 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_SOURCE_STATS_H__
+#define STEP_SOURCE_STATS_H__
+
+#include <step/step.h>
+
+/**
+ * @defgroup SOURCESTATS Per-source Throughput Accounting
+ * @ingroup step_api
+ * @brief API header file for per-source throughput and drop accounting.
+ *
+ * Counts the measurements each source ID publishes, and where they were
+ * lost: not matched by any processor node, dropped by the producer because
+ * the sample pool was exhausted, or rejected by @ref step_pm_put because
+ * the processor manager's queue was full. Publish and drop rates are
+ * estimated with an exponentially weighted moving average over windows of
+ * CONFIG_STEP_SOURCE_STATS_WINDOW_MS.
+ *
+ * Rather than logging every lost measurement, a single aggregate warning
+ * naming the source with the most drops is logged at most once every
+ * CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS.
+ *
+ * Source IDs 0 to CONFIG_STEP_SOURCE_STATS_SOURCES - 2 are tracked
+ * individually, and all other source IDs share the last slot.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Throughput and drop counters of a source ID.
+ */
+struct step_src_stats {
+	/** @brief Measurements queued with @ref step_pm_put. */
+	uint32_t published;
+	/** @brief Measurements taken off the queue and processed. */
+	uint32_t processed;
+	/** @brief Processed measurements that no processor node matched. */
+	uint32_t unmatched;
+	/** @brief Measurements the producer dropped, see
+	 *         @ref step_src_report_alloc_drop. */
+	uint32_t dropped_alloc;
+	/** @brief Measurements rejected because the queue was full. */
+	uint32_t dropped_overload;
+	/** @brief Estimated publish rate, in measurements per second. */
+	uint32_t rate;
+	/** @brief Estimated rate of unmatched and dropped measurements, in
+	 *         measurements per second. */
+	uint32_t drop_rate;
+};
+
+#if CONFIG_STEP_SOURCE_STATS
+
+/**
+ * @brief Records a measurement being queued.
+ *
+ * @param sourceid  The measurement's source ID.
+ */
+void step_src_record_put(uint8_t sourceid);
+
+/**
+ * @brief Records a measurement being taken off the queue.
+ *
+ * @param sourceid  The measurement's source ID.
+ */
+void step_src_record_processed(uint8_t sourceid);
+
+/**
+ * @brief Records a processed measurement that no processor node matched.
+ *
+ * @param sourceid  The measurement's source ID.
+ */
+void step_src_record_unmatched(uint8_t sourceid);
+
+/**
+ * @brief Records a measurement rejected because the queue was full.
+ *
+ * @param sourceid  The measurement's source ID.
+ */
+void step_src_record_overload(uint8_t sourceid);
+
+/**
+ * @brief Reports a measurement that the producer had to drop because it
+ *        couldn't be allocated from the sample pool.
+ *
+ * The sample pool doesn't know which source an allocation is for, so
+ * producers should call this when @ref step_sp_alloc returns NULL.
+ *
+ * @param sourceid  The source ID of the dropped measurement.
+ */
+void step_src_report_alloc_drop(uint8_t sourceid);
+
+/**
+ * @brief Returns the counters and rate estimates of a source ID.
+ *
+ * @param sourceid  The source ID. IDs without their own slot return the
+ *                  counters shared by all such sources.
+ * @param stats     The struct to fill in.
+ */
+void step_src_stats_get(uint8_t sourceid, struct step_src_stats *stats);
+
+/**
+ * @brief Clears the counters and rate estimates of every source ID.
+ */
+void step_src_stats_reset(void);
+
+/**
+ * @brief Prints the counters of every source ID that has published or
+ *        dropped measurements.
+ */
+void step_src_stats_print(void);
+
+#endif /* CONFIG_STEP_SOURCE_STATS */
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_SOURCE_STATS_H_ */
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_TRACING_H__
+#define STEP_TRACING_H__
+
+#include <step/step.h>
+
+/**
+ * @file
+ *
+ * Pipeline trace points, emitted as Zephyr named trace events so they can be
+ * correlated with scheduler and ISR activity in CTF or SystemView traces.
+ * Events come in '_enter'/'_exit' pairs where they span a duration. All
+ * macros compile to nothing unless CONFIG_STEP_TRACING is enabled.
+ *
+ * Where an event refers to a node chain, 'arg0' holds the chain's handle in
+ * the upper 16 bits and the node's instance in the lower 16 bits.
+ */
+
+#if CONFIG_STEP_TRACING
+#include <zephyr/tracing/tracing.h>
+
+/**
+ * @brief Emits a named STeP trace event with two 32-bit arguments.
+ */
+#define STEP_TRACE(name, a0, a1) \
+	sys_trace_named_event("step_" name, (uint32_t)(a0), (uint32_t)(a1))
+
+/** @brief Packs a chain handle and node instance into one argument. */
+#define STEP_TRACE_NODE_ID(handle, inst) \
+	((((uint32_t)(handle)) << 16) | ((uint32_t)(inst) & 0xFFFF))
+
+#else
+#define STEP_TRACE(name, a0, a1) do { } while (0)
+#define STEP_TRACE_NODE_ID(handle, inst) 0
+#endif
+
+/** @brief 'sz' payload bytes were allocated for 'mes' from the sample pool. */
+#define STEP_TRACE_SP_ALLOC(mes, sz) \
+	STEP_TRACE("sp_alloc", (uintptr_t)(mes), (sz))
+
+/** @brief 'mes' was returned to the sample pool. */
+#define STEP_TRACE_SP_FREE(mes) \
+	STEP_TRACE("sp_free", (uintptr_t)(mes), 0)
+
+/** @brief 'mes' was queued for processing, with its source ID. */
+#define STEP_TRACE_PUT(mes) \
+	STEP_TRACE("put", (uintptr_t)(mes), (mes)->header.srclen.sourceid)
+
+/** @brief The processor manager took 'mes' off the queue. */
+#define STEP_TRACE_DEQUEUE_ENTER(mes) \
+	STEP_TRACE("dequeue_enter", (uintptr_t)(mes), \
+		   (mes)->header.srclen.sourceid)
+
+/** @brief The processor manager finished with 'mes'. */
+#define STEP_TRACE_DEQUEUE_EXIT(mes, matches) \
+	STEP_TRACE("dequeue_exit", (uintptr_t)(mes), (matches))
+
+/** @brief A cached filter result for chain 'handle' was a hit or a miss. */
+#define STEP_TRACE_CACHE(handle, hit) \
+	STEP_TRACE("cache", (handle), (hit))
+
+/** @brief Filter evaluation for chain 'handle' started. */
+#define STEP_TRACE_EVAL_ENTER(handle) \
+	STEP_TRACE("eval_enter", STEP_TRACE_NODE_ID(handle, 0), 0)
+
+/** @brief Filter evaluation for chain 'handle' finished. */
+#define STEP_TRACE_EVAL_EXIT(handle, match) \
+	STEP_TRACE("eval_exit", STEP_TRACE_NODE_ID(handle, 0), (match))
+
+/** @brief Node callback 'cb' of node 'handle:inst' was called. */
+#define STEP_TRACE_NODE_ENTER(handle, inst, cb) \
+	STEP_TRACE("node_enter", STEP_TRACE_NODE_ID(handle, inst), \
+		   (uintptr_t)(cb))
+
+/** @brief A node callback of node 'handle:inst' returned 'rc'. */
+#define STEP_TRACE_NODE_EXIT(handle, inst, rc) \
+	STEP_TRACE("node_exit", STEP_TRACE_NODE_ID(handle, inst), (rc))
+
+/** @brief Subscriber callback 'cb' of chain 'handle' was called. */
+#define STEP_TRACE_SUB_ENTER(handle, cb) \
+	STEP_TRACE("sub_enter", STEP_TRACE_NODE_ID(handle, 0), (uintptr_t)(cb))
+
+/** @brief Subscriber callback of chain 'handle' returned. */
+#define STEP_TRACE_SUB_EXIT(handle) \
+	STEP_TRACE("sub_exit", STEP_TRACE_NODE_ID(handle, 0), 0)
+
+#endif /* STEP_TRACING_H_ */
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef STEP_TSC_H__
+#define STEP_TSC_H__
+
+#include <stdbool.h>
+#include <step/step.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @defgroup TSC Time-Series Compression
+ * @ingroup step_api
+ * @brief API header file for lossless time-series payload compression.
+ *
+ * Slowly varying sensor values compress poorly with general purpose
+ * algorithms like LZ4, since consecutive samples rarely share whole bytes.
+ * This codec uses the approach described in Facebook's Gorilla paper
+ * instead:
+ *
+ * - Each 32-bit value is XORed with the previous value of the same vector
+ *   component. Identical values cost 1 bit. Other values only store the
+ *   meaningful bits of the XOR result, reusing the previous leading and
+ *   trailing zero counts when they still fit.
+ * - The timestamp is stored as the difference between the current and the
+ *   previous delta between timestamps, costing 1 bit for a steady rate.
+ *
+ * Payloads must contain 4-byte samples (float32, int32, uint32 or the 32-bit
+ * range ctypes), with up to 4 vector components, unformatted and unencoded.
+ * Multi-sample measurements, such as those produced by @ref BATCH, compress
+ * best. Compressed payloads are tagged as @ref STEP_MES_COMPRESSION_TSC and
+ * contain the original payload length as a 16-bit little-endian value,
+ * followed by the bitstream. Unlike LZ4, the timestamp is part of the
+ * compressed data.
+ *
+ * In streaming mode, the previous values and timestamp delta are carried
+ * across measurements from the same source ID, so that even single-sample
+ * measurements compress well. This requires every compressed measurement
+ * from a source to be decompressed in order, by a decoder also running in
+ * streaming mode. Every bitstream starts with a reset bit, which is set
+ * whenever the encoder starts over for a source, resetting the decoder's
+ * state for that source as well. Payloads that wouldn't shrink are left
+ * uncompressed, without affecting the stream.
+ *
+ * @{
+ */
+
+/**
+ * @file
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Config settings for the time-series compress and decompress nodes,
+ *        assigned to the node's 'config' field.
+ */
+struct step_tsc_cfg {
+	/**
+	 * @brief Carry per-source state between consecutive measurements.
+	 */
+	bool stream;
+};
+
+/**
+ * @brief Node exec callback compressing the measurement's payload in place.
+ *
+ * Payloads that can't be compressed, or wouldn't get any smaller, are left
+ * untouched.
+ *
+ * @param mes       The measurement to process.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, -EFBIG if the payload is larger than
+ *                  CONFIG_STEP_NODE_TSC_MAX_PAYLOAD.
+ */
+int step_tsc_compress_exec(struct step_measurement *mes, uint32_t handle,
+			   uint32_t inst);
+
+/**
+ * @brief Node exec callback decompressing the measurement's payload in place.
+ *
+ * Measurements that aren't tagged as @ref STEP_MES_COMPRESSION_TSC are left
+ * untouched.
+ *
+ * @param mes       The measurement to process. Its payload buffer must be
+ *                  large enough for the decompressed payload, see
+ *                  step_measurement.capacity.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ *
+ * @return int      0 on success, -ENOSPC if the payload buffer is too small,
+ *                  -ENOENT if there is no stream state for the source, or
+ *                  -EINVAL if the bitstream is malformed.
+ */
+int step_tsc_decompress_exec(struct step_measurement *mes, uint32_t handle,
+			     uint32_t inst);
+
+/**
+ * @brief Drops all per-source streaming state, for the compressor and the
+ *        decompressor.
+ */
+void step_tsc_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+/**
+ * @}
+ */
+
+#endif /* STEP_TSC_H_ */
@@ -0,0 +1,163 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/bench.h>
+#include <step/encoding.h>
+#if CONFIG_STEP_NODE_LZ4
+#include <step/lz4.h>
+#endif
+
+
+/* Payload size in bytes, before encoding. */
+#define BENCH_PAYLOAD (1024)
+
+/* Number of encode/decode rounds per codec. */
+#define BENCH_ITERATIONS (10000)
+
+/* Input data, and a working buffer large enough for any encoded output. */
+static uint8_t bench_ref[BENCH_PAYLOAD];
+static uint8_t bench_buf[MAX(STEP_ENC_BASE45_LEN(BENCH_PAYLOAD),
+			     STEP_ENC_BASE64_LEN(BENCH_PAYLOAD))];
+
+#if CONFIG_STEP_NODE_LZ4
+static struct step_lz4_ctx bench_lz4_ctx;
+static uint8_t bench_lz4_out[BENCH_PAYLOAD];
+#endif
+
+/**
+ * @brief Prints the throughput for 'bytes' processed in 't', an accumulated
+ *        @ref step_bench_elapsed value.
+ */
+static void bench_print(const char *name, uint64_t bytes, uint64_t t)
+{
+	/* MB/s, in hundredths. */
+	uint64_t ns = step_bench_to_ns(t);
+	uint64_t rate;
+
+	rate = ns ? (bytes * 100000ULL) / ns : 0;
+
+	printk("%-16s %6u.%02u MB/s", name, (uint32_t)(rate / 100),
+	       (uint32_t)(rate % 100));
+}
+
+/**
+ * @brief Runs an in-place encoder and decoder pair over the reference data.
+ */
+static int bench_codec(const char *name,
+		       int (*enc)(const uint8_t *, uint32_t, uint8_t *, uint32_t),
+		       int (*dec)(const uint8_t *, uint32_t, uint8_t *, uint32_t))
+{
+	int len = 0;
+	uint64_t t0, t1, t2;
+	uint64_t enc_t = 0;
+	uint64_t dec_t = 0;
+	char label[24];
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		memcpy(bench_buf, bench_ref, BENCH_PAYLOAD);
+
+		t0 = step_bench_now();
+		len = enc(bench_buf, BENCH_PAYLOAD, bench_buf, sizeof(bench_buf));
+		t1 = step_bench_now();
+		len = dec(bench_buf, len, bench_buf, sizeof(bench_buf));
+		t2 = step_bench_now();
+
+		enc_t += step_bench_elapsed(t0, t1);
+		dec_t += step_bench_elapsed(t1, t2);
+	}
+
+	if ((len != BENCH_PAYLOAD) || memcmp(bench_buf, bench_ref, BENCH_PAYLOAD)) {
+		printk("%s: round trip failed (%d)\n", name, len);
+		return -EIO;
+	}
+
+	snprintk(label, sizeof(label), "%s encode:", name);
+	bench_print(label, (uint64_t)BENCH_PAYLOAD * BENCH_ITERATIONS, enc_t);
+	printk("\n");
+	snprintk(label, sizeof(label), "%s decode:", name);
+	bench_print(label, (uint64_t)BENCH_PAYLOAD * BENCH_ITERATIONS, dec_t);
+	printk("\n");
+
+	return 0;
+}
+
+#if CONFIG_STEP_NODE_LZ4
+static int bench_lz4(void)
+{
+	int clen = 0;
+	int len = 0;
+	uint64_t t0, t1, t2;
+	uint64_t enc_t = 0;
+	uint64_t dec_t = 0;
+
+	for (uint32_t i = 0; i < BENCH_ITERATIONS; i++) {
+		t0 = step_bench_now();
+		clen = step_lz4_compress(&bench_lz4_ctx, bench_ref, BENCH_PAYLOAD, 0,
+					 bench_lz4_out, sizeof(bench_lz4_out));
+		t1 = step_bench_now();
+		if (clen < 0) {
+			printk("lz4: compression failed (%d)\n", clen);
+			return clen;
+		}
+		len = step_lz4_decompress(bench_lz4_out, clen, bench_buf, 0,
+					  BENCH_PAYLOAD);
+		t2 = step_bench_now();
+
+		enc_t += step_bench_elapsed(t0, t1);
+		dec_t += step_bench_elapsed(t1, t2);
+	}
+
+	if ((len != BENCH_PAYLOAD) || memcmp(bench_buf, bench_ref, BENCH_PAYLOAD)) {
+		printk("lz4: round trip failed (%d)\n", len);
+		return -EIO;
+	}
+
+	bench_print("lz4 compress:", (uint64_t)BENCH_PAYLOAD * BENCH_ITERATIONS,
+		    enc_t);
+	printk(" (ratio %u.%02u)\n", BENCH_PAYLOAD / clen,
+	       ((BENCH_PAYLOAD * 100) / clen) % 100);
+	bench_print("lz4 decompress:", (uint64_t)BENCH_PAYLOAD * BENCH_ITERATIONS,
+		    dec_t);
+	printk("\n");
+
+	return 0;
+}
+#endif
+
+int main(void)
+{
+	uint32_t seed = 1;
+
+	/* Slowly varying 16-bit samples with a little noise, similar to what a
+	 * typical sensor produces. */
+	for (uint32_t i = 0; i < BENCH_PAYLOAD / 2; i++) {
+		seed = (seed * 1103515245U) + 12345U;
+		sys_put_le16(2048 + ((i % 64) * 8) + ((seed >> 16) & 0x3),
+			     &bench_ref[i * 2]);
+	}
+
+	printk("\nCodec throughput, %u byte payload, %u iterations:\n\n",
+	       BENCH_PAYLOAD, BENCH_ITERATIONS);
+
+	if (bench_codec("base64", step_enc_base64_encode, step_enc_base64_decode) ||
+	    bench_codec("base45", step_enc_base45_encode, step_enc_base45_decode)) {
+		return 0;
+	}
+
+#if CONFIG_STEP_NODE_LZ4
+	if (bench_lz4()) {
+		return 0;
+	}
+#endif
+
+	printk("\nDone\n");
+
+	return 0;
+}
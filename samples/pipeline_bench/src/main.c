@@ -0,0 +1,327 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/kernel.h>
+#include <zephyr/sys/printk.h>
+#include <zephyr/sys/atomic.h>
+#include <step/bench.h>
+#include <step/sample_pool.h>
+#include <step/proc_mgr.h>
+#include <step/histogram.h>
+
+
+/* Upper limits of the parameter sweep. */
+#define BENCH_MAX_NODES         (4)
+#define BENCH_MAX_FILTERS       (8)
+#define BENCH_MAX_PRODUCERS     (4)
+#define BENCH_MAX_BATCH         (16)
+
+/* Producer threads run just below the processor manager's work queue. */
+#define BENCH_STACK_SIZE        (1024)
+#define BENCH_PRODUCER_PRIO     (CONFIG_STEP_PROC_MGR_PRIORITY + 1)
+
+/* Time to wait for a run to drain before giving up. */
+#define BENCH_TIMEOUT           K_SECONDS(60)
+
+/* Parameter sweep, every combination is run. */
+static const uint8_t bench_nodes[] = { 1, BENCH_MAX_NODES };
+static const uint8_t bench_filters[] = { 1, BENCH_MAX_FILTERS };
+static const uint16_t bench_payloads[] = { 16, 256 };
+static const uint8_t bench_producers[] = { 1, BENCH_MAX_PRODUCERS };
+static const uint8_t bench_batches[] = { 1, BENCH_MAX_BATCH };
+
+#define BENCH_RUNS (ARRAY_SIZE(bench_nodes) * ARRAY_SIZE(bench_filters) * \
+		    ARRAY_SIZE(bench_payloads) * ARRAY_SIZE(bench_producers) * \
+		    ARRAY_SIZE(bench_batches))
+
+/**
+ * @brief Parameters and results of a single benchmark run.
+ */
+struct bench_run {
+	/** Number of enabled processor nodes, each matching every measurement. */
+	uint8_t nodes;
+	/** Number of entries in each node's filter chain. */
+	uint8_t filters;
+	/** Number of producer threads. */
+	uint8_t producers;
+	/** Number of measurements a producer allocates before queueing them. */
+	uint8_t batch;
+	/** Payload size in bytes. */
+	uint16_t payload;
+
+	/** Time from the first allocation until the last delivery. */
+	uint64_t elapsed_ns;
+	/** Number of times a producer found the sample pool exhausted. */
+	atomic_t stalls;
+	/** Sample pool high-water mark in bytes. */
+	int32_t pool_peak;
+	/** Put to subscriber delivery latency. */
+	struct step_hist_summary lat;
+};
+
+static struct bench_run bench_run;
+
+/* Put to delivery latency histogram, only updated by the work queue. */
+static struct step_hist bench_lat;
+
+/* Deliveries so far, and the number that completes the run. */
+static atomic_t bench_delivered;
+static uint32_t bench_expected;
+K_SEM_DEFINE(bench_done, 0, 1);
+
+K_THREAD_STACK_ARRAY_DEFINE(bench_stacks, BENCH_MAX_PRODUCERS, BENCH_STACK_SIZE);
+static struct k_thread bench_threads[BENCH_MAX_PRODUCERS];
+
+/* Prevents the node's payload checksum from being optimised away. */
+static volatile uint32_t bench_sink;
+
+/* Node exec callback, checksumming the payload. */
+static int bench_exec(struct step_measurement *mes, uint32_t handle,
+		      uint32_t inst)
+{
+	const uint8_t *p = mes->payload;
+	uint32_t sum = 0;
+
+	for (uint16_t i = 0; i < mes->header.srclen.len; i++) {
+		sum += p[i];
+	}
+	bench_sink = sum;
+
+	return 0;
+}
+
+/* Subscriber callback, recording the latency since the measurement was put. */
+static void bench_on_delivery(struct step_measurement *mes, uint32_t handle,
+			      void *user_data)
+{
+	uint64_t stamp;
+	uint64_t ns;
+
+	memcpy(&stamp, mes->payload, sizeof(stamp));
+	ns = step_bench_to_ns(step_bench_elapsed(stamp, step_bench_now()));
+	step_hist_record(&bench_lat, ns > UINT32_MAX ? UINT32_MAX : (uint32_t)ns);
+
+	if (atomic_inc(&bench_delivered) + 1 == bench_expected) {
+		k_sem_give(&bench_done);
+	}
+}
+
+/* Filter chain entries, each matching any acceleration measurement. */
+static struct step_filter bench_filt[BENCH_MAX_FILTERS];
+
+static struct step_node bench_node[BENCH_MAX_NODES];
+static uint32_t bench_handle[BENCH_MAX_NODES];
+
+/**
+ * @brief Producer thread, publishing 'p1' measurements in bursts of
+ *        'bench_run.batch'.
+ */
+static void bench_producer(void *p1, void *p2, void *p3)
+{
+	uint32_t remaining = (uint32_t)(uintptr_t)p1;
+	struct step_measurement *burst[BENCH_MAX_BATCH];
+	struct step_measurement *mes;
+	uint32_t want;
+	uint32_t n;
+	uint64_t stamp;
+
+	while (remaining) {
+		/* Allocate and fill a burst. */
+		want = MIN(bench_run.batch, remaining);
+		for (n = 0; n < want; n++) {
+			mes = step_sp_alloc(bench_run.payload);
+			if (mes == NULL) {
+				break;
+			}
+			mes->header.filter.base_type = STEP_MES_TYPE_ACCELERATION;
+			mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_U8;
+			memset(mes->payload, (uint8_t)remaining, bench_run.payload);
+			burst[n] = mes;
+		}
+
+		/* Queue whatever was allocated, so a partial burst can't hold
+		 * on to pool memory while waiting for more. */
+		for (uint32_t i = 0; i < n; i++) {
+			stamp = step_bench_now();
+			memcpy(burst[i]->payload, &stamp, sizeof(stamp));
+			step_pm_put(burst[i]);
+		}
+		remaining -= n;
+
+		if (n < want) {
+			atomic_inc(&bench_run.stalls);
+			k_sleep(K_TICKS(1));
+		}
+	}
+}
+
+static int bench_setup(void)
+{
+	int rc;
+
+	for (uint32_t i = 0; i < BENCH_MAX_FILTERS; i++) {
+		bench_filt[i].op = i ? STEP_FILTER_OP_AND : STEP_FILTER_OP_IS;
+		bench_filt[i].match = STEP_MES_TYPE_ACCELERATION;
+		bench_filt[i].ignore_mask = ~STEP_MES_MASK_BASE_TYPE;
+	}
+
+	/* Nodes are registered once, and enabled as needed by each run. */
+	for (uint32_t i = 0; i < BENCH_MAX_NODES; i++) {
+		bench_node[i].name = "Benchmark node";
+		bench_node[i].filters.chain = bench_filt;
+		bench_node[i].filters.count = 1;
+		bench_node[i].callbacks.exec_handler = bench_exec;
+
+		rc = step_pm_register(&bench_node[i], 0, &bench_handle[i]);
+		if (rc) {
+			return rc;
+		}
+		rc = step_pm_subscribe_to_node(bench_handle[i], bench_on_delivery,
+					       NULL);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	return 0;
+}
+
+static int bench_exec_run(void)
+{
+	uint32_t share = CONFIG_BENCH_MESSAGES / bench_run.producers;
+	uint32_t count;
+	uint64_t t0;
+	int rc;
+
+	for (uint32_t i = 0; i < BENCH_MAX_NODES; i++) {
+		bench_node[i].filters.count = bench_run.filters;
+		if (i < bench_run.nodes) {
+			step_pm_enable_node(bench_handle[i]);
+		} else {
+			step_pm_disable_node(bench_handle[i]);
+		}
+	}
+
+	step_hist_reset(&bench_lat);
+	atomic_set(&bench_delivered, 0);
+	atomic_set(&bench_run.stalls, 0);
+	bench_expected = CONFIG_BENCH_MESSAGES * bench_run.nodes;
+	k_sem_reset(&bench_done);
+	step_sp_reset_peak();
+
+	t0 = step_bench_now();
+	for (uint32_t i = 0; i < bench_run.producers; i++) {
+		/* The last producer picks up the remainder. */
+		count = share;
+		if (i == bench_run.producers - 1) {
+			count += CONFIG_BENCH_MESSAGES % bench_run.producers;
+		}
+		k_thread_create(&bench_threads[i], bench_stacks[i],
+				K_THREAD_STACK_SIZEOF(bench_stacks[i]),
+				bench_producer, (void *)(uintptr_t)count, NULL,
+				NULL, BENCH_PRODUCER_PRIO, 0, K_NO_WAIT);
+	}
+
+	rc = k_sem_take(&bench_done, BENCH_TIMEOUT);
+	bench_run.elapsed_ns = step_bench_to_ns(step_bench_elapsed(t0,
+							step_bench_now()));
+
+	for (uint32_t i = 0; i < bench_run.producers; i++) {
+		k_thread_join(&bench_threads[i], K_FOREVER);
+	}
+
+	if (rc) {
+		printk("Run timed out after %u of %u deliveries\n",
+		       (uint32_t)atomic_get(&bench_delivered), bench_expected);
+		return rc;
+	}
+
+	bench_run.pool_peak = step_sp_bytes_alloc_peak();
+	step_hist_summarise(&bench_lat, &bench_run.lat);
+
+	return 0;
+}
+
+static void bench_print_header(void)
+{
+#if !CONFIG_BENCH_OUTPUT_JSON
+	printk("nodes,filters,payload,producers,batch,cache_depth,messages,"
+	       "elapsed_us,mes_per_s,lat_p50_ns,lat_p99_ns,lat_p999_ns,"
+	       "lat_max_ns,pool_peak_bytes,stalls\n");
+#endif
+}
+
+static void bench_print_run(void)
+{
+	uint32_t cache_depth = 0;
+	uint32_t rate = 0;
+
+#if CONFIG_STEP_FILTER_CACHE
+	cache_depth = CONFIG_STEP_FILTER_CACHE_DEPTH;
+#endif
+
+	/* Sustained processed measurements per second. */
+	if (bench_run.elapsed_ns) {
+		rate = (uint32_t)(((uint64_t)CONFIG_BENCH_MESSAGES * NSEC_PER_SEC) /
+				  bench_run.elapsed_ns);
+	}
+
+#if CONFIG_BENCH_OUTPUT_JSON
+	printk("{\"nodes\":%u,\"filters\":%u,\"payload\":%u,\"producers\":%u,"
+	       "\"batch\":%u,\"cache_depth\":%u,\"messages\":%u,"
+	       "\"elapsed_us\":%u,\"mes_per_s\":%u,\"lat_p50_ns\":%u,"
+	       "\"lat_p99_ns\":%u,\"lat_p999_ns\":%u,\"lat_max_ns\":%u,"
+	       "\"pool_peak_bytes\":%d,\"stalls\":%u}\n",
+#else
+	printk("%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%d,%u\n",
+#endif
+	       bench_run.nodes, bench_run.filters, bench_run.payload,
+	       bench_run.producers, bench_run.batch, cache_depth,
+	       CONFIG_BENCH_MESSAGES, (uint32_t)(bench_run.elapsed_ns / 1000),
+	       rate, bench_run.lat.p50, bench_run.lat.p99, bench_run.lat.p999,
+	       bench_run.lat.max, bench_run.pool_peak,
+	       (uint32_t)atomic_get(&bench_run.stalls));
+}
+
+int main(void)
+{
+	int rc;
+
+	rc = bench_setup();
+	if (rc) {
+		printk("Node registration failed (%d)\n", rc);
+		return 0;
+	}
+
+	printk("\nPipeline benchmark, %u measurements per run:\n\n",
+	       CONFIG_BENCH_MESSAGES);
+	bench_print_header();
+
+	/* Walk every combination of the sweep parameters. */
+	for (uint32_t i = 0; i < BENCH_RUNS; i++) {
+		uint32_t r = i;
+
+		bench_run.batch = bench_batches[r % ARRAY_SIZE(bench_batches)];
+		r /= ARRAY_SIZE(bench_batches);
+		bench_run.producers = bench_producers[r % ARRAY_SIZE(bench_producers)];
+		r /= ARRAY_SIZE(bench_producers);
+		bench_run.payload = bench_payloads[r % ARRAY_SIZE(bench_payloads)];
+		r /= ARRAY_SIZE(bench_payloads);
+		bench_run.filters = bench_filters[r % ARRAY_SIZE(bench_filters)];
+		r /= ARRAY_SIZE(bench_filters);
+		bench_run.nodes = bench_nodes[r];
+
+		if (bench_exec_run()) {
+			return 0;
+		}
+		bench_print_run();
+	}
+
+	printk("\nDone\n");
+
+	return 0;
+}
@@ -20,7 +20,7 @@ LOG_MODULE_REGISTER(step_shell);
 /**
  * @brief Instrumentation counter.
  */
-static uint32_t _instr;
+static step_instr_cyc_t _instr;
 
 static int
 step_shell_cmd_list(const struct shell *shell, size_t argc, char **argv)
@@ -49,7 +49,7 @@ step_shell_cmd_add(const struct shell *shell, size_t argc, char **argv)
 	/* step_node_print(test_node_chain); */
 
 #if CONFIG_STEP_INSTRUMENTATION
-	LOG_DBG("Took %d ns", _instr);
+	LOG_DBG("Took %u ns", (uint32_t)STEP_INSTR_TO_NS(_instr));
 #endif
 
 	return 0;
@@ -67,7 +67,7 @@ step_shell_cmd_clr(const struct shell *shell, size_t argc, char **argv)
 	STEP_INSTR_STOP(_instr);
 
 #if CONFIG_STEP_INSTRUMENTATION
-	LOG_DBG("Took %d ns", _instr);
+	LOG_DBG("Took %u ns", (uint32_t)STEP_INSTR_TO_NS(_instr));
 #endif
 
 	return 0;
@@ -112,14 +112,14 @@ step_shell_cmd_pub(const struct shell *shell, size_t argc, char **argv)
 	/* step_mes_print(smes); */
 
 #if CONFIG_STEP_INSTRUMENTATION
-	LOG_DBG("Took %d ns", _instr);
+	LOG_DBG("Took %u ns", (uint32_t)STEP_INSTR_TO_NS(_instr));
 #endif
 
 	return 0;
 }
 
 static int
-step_shell_cmd_stats(const struct shell *shell, size_t argc, char **argv)
+step_shell_cmd_cbstats(const struct shell *shell, size_t argc, char **argv)
 {
 	ARG_UNUSED(argc);
 	ARG_UNUSED(argv);
@@ -135,17 +135,6 @@ step_shell_cmd_stats(const struct shell *shell, size_t argc, char **argv)
 	return 0;
 }
 
-static int
-step_shell_cmd_pool(const struct shell *shell, size_t argc, char **argv)
-{
-	ARG_UNUSED(argc);
-	ARG_UNUSED(argv);
-
-	step_sp_print_stats();
-
-	return 0;
-}
-
 #if CONFIG_STEP_FILTER_CACHE
 static int
 step_shell_cmd_cache(const struct shell *shell, size_t argc, char **argv)
@@ -155,8 +144,6 @@ step_shell_cmd_cache(const struct shell *shell, size_t argc, char **argv)
 
 	shell_print(shell, "Cache slots:\n");
 	step_cache_print();
-	shell_print(shell, "\nStats:\n");
-	step_cache_print_stats();
 
 	return 0;
 }
@@ -167,36 +154,31 @@ void main(void)
 	printk("Type 'step help' for command options.\n\n");
 	printk("1.) Populate the processor registry: step add\n");
 	printk("2.) Publish measurement(s):          step pub\n");
-	printk("3.) Check results:                   step stats");
+	printk("3.) Check results:                   step stats, step cbstats");
 
 	while (1) {
 		k_sleep(K_FOREVER);
 	}
 }
 
-/* Subcommand array for "step" (level 1). */
-SHELL_STATIC_SUBCMD_SET_CREATE(
-	sub_step,
-	/* 'list' command handler. */
-	SHELL_CMD(list, NULL, "Display proc. registry", step_shell_cmd_list),
-	/* 'add' command handler. */
-	SHELL_CMD(add, NULL, "Populate proc. registry", step_shell_cmd_add),
-	/* 'clr' command handler. */
-	SHELL_CMD(clr, NULL, "Clear proc. registry", step_shell_cmd_clr),
-	/* 'pub' command handler. */
-	SHELL_CMD(pub, NULL, "Publish a measurement", step_shell_cmd_pub),
-	/* 'stats' command handler. */
-	SHELL_CMD(stats, NULL, "Display node cb stats", step_shell_cmd_stats),
-	/* 'pool' command handler. */
-	SHELL_CMD(pool, NULL, "Display meas. pool stats", step_shell_cmd_pool),
+/* Demo subcommands, added to the library's "step" root command. */
+/* 'list' command handler. */
+SHELL_SUBCMD_ADD((step), list, NULL, "Display proc. registry",
+		 step_shell_cmd_list, 1, 0);
+/* 'add' command handler. */
+SHELL_SUBCMD_ADD((step), add, NULL, "Populate proc. registry",
+		 step_shell_cmd_add, 1, 0);
+/* 'clr' command handler. */
+SHELL_SUBCMD_ADD((step), clr, NULL, "Clear proc. registry",
+		 step_shell_cmd_clr, 1, 0);
+/* 'pub' command handler. */
+SHELL_SUBCMD_ADD((step), pub, NULL, "Publish a measurement",
+		 step_shell_cmd_pub, 1, 0);
+/* 'cbstats' command handler. */
+SHELL_SUBCMD_ADD((step), cbstats, NULL, "Display node cb stats",
+		 step_shell_cmd_cbstats, 1, 0);
 #if CONFIG_STEP_FILTER_CACHE
-	/* 'cache' command handler. */
-	SHELL_CMD(cache, NULL, "Display cache stats", step_shell_cmd_cache),
+/* 'cache' command handler. */
+SHELL_SUBCMD_ADD((step), cache, NULL, "Display cache slots",
+		 step_shell_cmd_cache, 1, 0);
 #endif
-
-	/* Array terminator. */
-	SHELL_SUBCMD_SET_END
-	);
-
-/* Root command "step" (level 0). */
-SHELL_CMD_REGISTER(step, &sub_step, "Secure telemetry pipeline commands", NULL);
@@ -102,8 +102,9 @@ void main(void)
 {
 	int rc = 0;
 	uint32_t handle;
-	uint32_t instr = 0;
-	uint32_t instr_total = 0;
+	step_instr_cyc_t instr = 0;
+	uint64_t instr_total = 0;
+	uint32_t total_us;
 	struct step_measurement *mes;
 	struct accel_payload *payload;
 
@@ -144,13 +145,14 @@ void main(void)
 		instr_total += instr;
 	}
 
-	/* Display timing results. */
+	/* Display timing results. Cycles are converted to time only here. */
+	total_us = (uint32_t)(STEP_INSTR_TO_NS(instr_total) / 1000);
 	printk("\n");
 	printk("Processed %d measurements:\n\n", STEP_THROUGHPUT_MSGS);
-	printk("total time: %d us\n", instr_total / 1000);
-	printk("per sample: %d us\n", instr_total / STEP_THROUGHPUT_MSGS / 1000);
-	printk("mes/s:      %d\n", 1000000 /
-	       (instr_total / STEP_THROUGHPUT_MSGS / 1000));
+	printk("total time: %u us\n", total_us);
+	printk("per sample: %u us\n", total_us / STEP_THROUGHPUT_MSGS);
+	printk("mes/s:      %u\n", (uint32_t)((uint64_t)STEP_THROUGHPUT_MSGS *
+					      1000000 / MAX(total_us, 1)));
 	printk("\n");
 
 	/* Display sample pool stats. */
@@ -0,0 +1,289 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/batch.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(batch);
+
+/* Size of the arbitrary sample count word. */
+#define STEP_BATCH_COUNT_SZ     (4)
+
+static bool step_batch_is_pow2(uint32_t n)
+{
+	return (n != 0) && ((n & (n - 1)) == 0);
+}
+
+/**
+ * @brief Returns the size of a single sample described by 'hdr', including
+ *        every vector component, or a negative value if it has no fixed size.
+ */
+static int32_t step_batch_sz_sample(const struct step_mes_header *hdr)
+{
+	struct step_mes_header tmp = *hdr;
+
+	tmp.srclen.samples = 0;
+	tmp.filter.flags.timestamp = STEP_MES_TIMESTAMP_NONE;
+	tmp.filter.flags.encoding = STEP_MES_ENCODING_NONE;
+
+	return step_mes_sz_payload(&tmp);
+}
+
+/**
+ * @brief Completes the current batch and hands it to the flush callback.
+ *        Must be called with the batcher's mutex held.
+ */
+static int step_batch_publish(struct step_batch *b)
+{
+	int rc;
+	uint8_t *payload;
+	uint32_t ts;
+	uint32_t samples = 0;
+	uint32_t data_len;
+	struct step_measurement *mes = b->mes;
+
+	if (mes == NULL) {
+		return 0;
+	}
+
+	k_work_cancel_delayable(&b->work);
+
+	payload = mes->payload;
+	ts = step_mes_sz_timestamp(b->header.filter.flags.timestamp);
+	data_len = b->count * b->sample_sz;
+
+	if (step_batch_is_pow2(b->count) && (b->offset == ts)) {
+		/* 2^n samples, no count word required. */
+		while ((1U << samples) < b->count) {
+			samples++;
+		}
+		mes->header.srclen.len = ts + data_len;
+	} else {
+		/* Partial batch: insert the count word before the samples if
+		 * no room was reserved for it. */
+		if (b->offset == ts) {
+			memmove(payload + ts + STEP_BATCH_COUNT_SZ, payload + ts,
+				data_len);
+		}
+		sys_put_le32(b->count, payload + ts);
+		samples = 15;
+		mes->header.srclen.len = ts + STEP_BATCH_COUNT_SZ + data_len;
+	}
+	mes->header.srclen.samples = samples;
+
+	b->mes = NULL;
+	b->count = 0;
+
+	if (b->flush != NULL) {
+		rc = b->flush(mes, b->user_data);
+	} else {
+		rc = step_pm_put(mes);
+		if (rc) {
+			step_sp_free(mes);
+		}
+	}
+
+	if (rc) {
+		LOG_ERR("Unable to publish batch for source %u: %d",
+			b->header.srclen.sourceid, rc);
+	}
+
+	return rc;
+}
+
+static void step_batch_timeout(struct k_work *item)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(item);
+	struct step_batch *b = CONTAINER_OF(dwork, struct step_batch, work);
+
+	step_batch_flush(b);
+}
+
+int step_batch_init(struct step_batch *b)
+{
+	int32_t sz;
+	uint32_t ts;
+
+	sz = step_batch_sz_sample(&b->header);
+	if ((sz <= 0) || (b->max_samples < 2)) {
+		return -EINVAL;
+	}
+
+	/* Reserve room for the count word, which is only needed up front if
+	 * full batches aren't 2^n samples. */
+	ts = step_mes_sz_timestamp(b->header.filter.flags.timestamp);
+	if (ts + STEP_BATCH_COUNT_SZ + (uint32_t)sz * b->max_samples >
+	    UINT16_MAX) {
+		return -EINVAL;
+	}
+
+	b->sample_sz = sz;
+	b->offset = step_batch_is_pow2(b->max_samples) ? ts :
+		    ts + STEP_BATCH_COUNT_SZ;
+	b->mes = NULL;
+	b->count = 0;
+	b->header.srclen.fragment = STEP_MES_FRAGMENT_NONE;
+	b->header.srclen.samples = 0;
+
+	k_mutex_init(&b->mtx);
+	k_work_init_delayable(&b->work, step_batch_timeout);
+
+	return 0;
+}
+
+int step_batch_add(struct step_batch *b, const void *sample,
+		   uint64_t timestamp)
+{
+	int rc = 0;
+	uint32_t ts;
+	uint32_t ts32;
+
+	k_mutex_lock(&b->mtx, K_FOREVER);
+
+	if (b->mes == NULL) {
+		ts = step_mes_sz_timestamp(b->header.filter.flags.timestamp);
+		b->mes = step_sp_alloc(ts + STEP_BATCH_COUNT_SZ +
+				       b->sample_sz * b->max_samples);
+		if (b->mes == NULL) {
+			rc = -ENOMEM;
+			goto err;
+		}
+		b->mes->header = b->header;
+
+		/* Timestamps are stored in native byte order. */
+		if (ts == sizeof(ts32)) {
+			ts32 = (uint32_t)timestamp;
+			memcpy(b->mes->payload, &ts32, ts);
+		} else if (ts == sizeof(timestamp)) {
+			memcpy(b->mes->payload, &timestamp, ts);
+		}
+
+		if (b->timeout_ms) {
+			k_work_schedule(&b->work, K_MSEC(b->timeout_ms));
+		}
+	}
+
+	memcpy((uint8_t *)b->mes->payload + b->offset + b->count * b->sample_sz,
+	       sample, b->sample_sz);
+	b->count++;
+
+	if (b->count == b->max_samples) {
+		rc = step_batch_publish(b);
+	}
+
+err:
+	k_mutex_unlock(&b->mtx);
+	return rc;
+}
+
+int step_batch_flush(struct step_batch *b)
+{
+	int rc;
+
+	k_mutex_lock(&b->mtx, K_FOREVER);
+	rc = step_batch_publish(b);
+	k_mutex_unlock(&b->mtx);
+
+	return rc;
+}
+
+int step_batch_exec(struct step_measurement *mes, uint32_t handle,
+		    uint32_t inst)
+{
+	int rc;
+	uint32_t ts;
+	uint32_t ts32 = 0;
+	uint64_t timestamp = 0;
+	struct step_node *n = step_pm_node_get(handle, inst);
+	struct step_batch *b = n != NULL ? n->config : NULL;
+
+	if (b == NULL) {
+		return -EINVAL;
+	}
+
+	/* Only batch single, raw samples matching the batcher's header. */
+	if ((mes->header.srclen.samples != 0) ||
+	    (mes->header.srclen.fragment != STEP_MES_FRAGMENT_NONE) ||
+	    (mes->header.unit_bits != b->header.unit_bits) ||
+	    (mes->header.srclen.vec_sz != b->header.srclen.vec_sz) ||
+	    (mes->header.srclen.sourceid != b->header.srclen.sourceid) ||
+	    (mes->header.filter.flags.timestamp !=
+	     b->header.filter.flags.timestamp) ||
+	    mes->header.filter.flags.data_format ||
+	    mes->header.filter.flags.encoding ||
+	    mes->header.filter.flags.compression) {
+		return 0;
+	}
+
+	ts = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.len < ts + b->sample_sz) {
+		return -EINVAL;
+	}
+
+	if (ts == sizeof(ts32)) {
+		memcpy(&ts32, mes->payload, ts);
+		timestamp = ts32;
+	} else if (ts == sizeof(timestamp)) {
+		memcpy(&timestamp, mes->payload, ts);
+	}
+
+	rc = step_batch_add(b, (uint8_t *)mes->payload + ts, timestamp);
+	if (rc) {
+		return rc;
+	}
+
+	/* The sample is delivered as part of the batch. */
+	return STEP_NODE_RC_ABORT_CHAIN;
+}
+
+int step_batch_iter_init(struct step_batch_iter *it,
+			 const struct step_measurement *mes)
+{
+	int32_t sz;
+	uint32_t off;
+	uint32_t count;
+	const uint8_t *payload = mes->payload;
+
+	if (mes->header.filter.flags.data_format ||
+	    mes->header.filter.flags.encoding ||
+	    mes->header.filter.flags.compression ||
+	    (mes->header.srclen.fragment != STEP_MES_FRAGMENT_NONE)) {
+		return -EINVAL;
+	}
+
+	sz = step_batch_sz_sample(&mes->header);
+	if (sz <= 0) {
+		return -EINVAL;
+	}
+
+	off = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.samples < 15) {
+		count = 1U << mes->header.srclen.samples;
+	} else {
+		if (mes->header.srclen.len < off + STEP_BATCH_COUNT_SZ) {
+			return -EINVAL;
+		}
+		count = sys_get_le32(payload + off);
+		off += STEP_BATCH_COUNT_SZ;
+	}
+
+	if ((mes->header.srclen.len < off) ||
+	    (count > (mes->header.srclen.len - off) / (uint32_t)sz)) {
+		return -EINVAL;
+	}
+
+	it->pos = payload + off;
+	it->remaining = count;
+	it->sample_sz = sz;
+	it->ctype = mes->header.unit.ctype;
+
+	return 0;
+}
@@ -0,0 +1,481 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <step/binlog.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+
+/* First byte of every frame. */
+#define STEP_BINLOG_SYNC        (0xA5)
+
+/* Size of the measurement header in a record frame. */
+#define STEP_BINLOG_MES_HDR_SZ  (12)
+
+/* Size of the fixed part of an index or end frame's body. */
+#define STEP_BINLOG_META_SZ     (8)
+
+/* Total size of an end frame. */
+#define STEP_BINLOG_END_SZ      (STEP_BINLOG_FRAME_HDR_SZ + \
+				 STEP_BINLOG_META_SZ + STEP_BINLOG_CRC_SZ)
+
+BUILD_ASSERT(sizeof(struct step_mes_header) == STEP_BINLOG_MES_HDR_SZ,
+	     "Unexpected measurement header size");
+
+static const uint8_t step_binlog_magic[4] = { 'S', 'T', 'P', 'L' };
+
+/**
+ * @brief Passes bytes to the sink, keeping track of the log's size.
+ */
+static int step_binlog_emit(struct step_binlog_writer *w, const void *data,
+			    uint32_t len)
+{
+	int rc;
+
+	rc = w->sink(data, len, w->user_data);
+	if (rc == 0) {
+		w->offset += len;
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Writes a frame made up of 'hdr', which holds the prefix and the
+ *        fixed part of the body, followed by 'data' and the CRC.
+ */
+static int step_binlog_put_frame(struct step_binlog_writer *w,
+				 const uint8_t *hdr, uint32_t hdr_len,
+				 const void *data, uint32_t data_len)
+{
+	int rc;
+	uint32_t crc;
+	uint8_t crc_le[STEP_BINLOG_CRC_SZ];
+
+	crc = crc32_ieee_update(0, hdr, hdr_len);
+	rc = step_binlog_emit(w, hdr, hdr_len);
+	if (rc) {
+		return rc;
+	}
+
+	if (data_len) {
+		crc = crc32_ieee_update(crc, data, data_len);
+		rc = step_binlog_emit(w, data, data_len);
+		if (rc) {
+			return rc;
+		}
+	}
+
+	sys_put_le32(crc, crc_le);
+	return step_binlog_emit(w, crc_le, sizeof(crc_le));
+}
+
+/**
+ * @brief Writes an index frame for the records since the last one, if any.
+ */
+static int step_binlog_put_index(struct step_binlog_writer *w)
+{
+	int rc;
+	uint32_t off = w->offset;
+	uint8_t hdr[STEP_BINLOG_FRAME_HDR_SZ + STEP_BINLOG_META_SZ];
+
+	if (w->pending == 0) {
+		return 0;
+	}
+
+	hdr[0] = STEP_BINLOG_SYNC;
+	hdr[1] = STEP_BINLOG_FRAME_INDEX;
+	sys_put_le16(w->pending, &hdr[2]);
+	sys_put_le32(w->last_index, &hdr[4]);
+	sys_put_le32(w->records - w->pending, &hdr[8]);
+
+	rc = step_binlog_put_frame(w, hdr, sizeof(hdr), w->index,
+				   w->pending * sizeof(w->index[0]));
+
+	/* Records missing from a failed index are still found by scanning. */
+	w->pending = 0;
+	if (rc == 0) {
+		w->last_index = off;
+	}
+
+	return rc;
+}
+
+int step_binlog_writer_init(struct step_binlog_writer *w)
+{
+	uint8_t hdr[STEP_BINLOG_FILE_HDR_SZ];
+
+	if (w->sink == NULL) {
+		return -EINVAL;
+	}
+
+	w->offset = 0;
+	w->records = 0;
+	w->last_index = STEP_BINLOG_OFFSET_NONE;
+	w->pending = 0;
+	k_mutex_init(&w->mtx);
+
+	memcpy(hdr, step_binlog_magic, sizeof(step_binlog_magic));
+	hdr[4] = STEP_BINLOG_VERSION;
+	hdr[5] = 0;
+	sys_put_le16(CONFIG_STEP_BINLOG_INDEX_INTERVAL, &hdr[6]);
+
+	return step_binlog_emit(w, hdr, sizeof(hdr));
+}
+
+int step_binlog_write(struct step_binlog_writer *w,
+		      const struct step_measurement *mes)
+{
+	int rc;
+	uint32_t off;
+	uint64_t end;
+	uint8_t hdr[STEP_BINLOG_FRAME_HDR_SZ + STEP_BINLOG_MES_HDR_SZ];
+
+	k_mutex_lock(&w->mtx, K_FOREVER);
+
+	/* Leave room for the index and end frames, so offsets fit in 32 bits. */
+	off = w->offset;
+	end = (uint64_t)off + sizeof(hdr) + mes->header.srclen.len +
+	      STEP_BINLOG_CRC_SZ + STEP_BINLOG_FRAME_HDR_SZ +
+	      STEP_BINLOG_META_SZ + sizeof(w->index) + STEP_BINLOG_CRC_SZ +
+	      STEP_BINLOG_END_SZ;
+	if (end >= STEP_BINLOG_OFFSET_NONE) {
+		rc = -EINVAL;
+		goto out;
+	}
+
+	hdr[0] = STEP_BINLOG_SYNC;
+	hdr[1] = STEP_BINLOG_FRAME_RECORD;
+	sys_put_le16(0, &hdr[2]);
+	memcpy(&hdr[STEP_BINLOG_FRAME_HDR_SZ], &mes->header,
+	       STEP_BINLOG_MES_HDR_SZ);
+
+	rc = step_binlog_put_frame(w, hdr, sizeof(hdr), mes->payload,
+				   mes->header.srclen.len);
+	if (rc) {
+		goto out;
+	}
+
+	w->index[w->pending++] = sys_cpu_to_le32(off);
+	w->records++;
+	if (w->pending == CONFIG_STEP_BINLOG_INDEX_INTERVAL) {
+		rc = step_binlog_put_index(w);
+	}
+
+out:
+	k_mutex_unlock(&w->mtx);
+	return rc;
+}
+
+int step_binlog_writer_finish(struct step_binlog_writer *w)
+{
+	int rc;
+	uint8_t hdr[STEP_BINLOG_FRAME_HDR_SZ + STEP_BINLOG_META_SZ];
+
+	k_mutex_lock(&w->mtx, K_FOREVER);
+
+	rc = step_binlog_put_index(w);
+	if (rc == 0) {
+		hdr[0] = STEP_BINLOG_SYNC;
+		hdr[1] = STEP_BINLOG_FRAME_END;
+		sys_put_le16(0, &hdr[2]);
+		sys_put_le32(w->last_index, &hdr[4]);
+		sys_put_le32(w->records, &hdr[8]);
+		rc = step_binlog_put_frame(w, hdr, sizeof(hdr), NULL, 0);
+	}
+
+	k_mutex_unlock(&w->mtx);
+	return rc;
+}
+
+int step_binlog_buf_sink(const void *data, uint32_t len, void *user_data)
+{
+	struct step_binlog_buf *b = user_data;
+
+	if (len > b->len - b->pos) {
+		return -ENOSPC;
+	}
+
+	memcpy(b->buf + b->pos, data, len);
+	b->pos += len;
+
+	return 0;
+}
+
+int step_binlog_exec(struct step_measurement *mes, uint32_t handle,
+		     uint32_t inst)
+{
+	struct step_node *n = step_pm_node_get(handle, inst);
+
+	if ((n == NULL) || (n->config == NULL)) {
+		return -EINVAL;
+	}
+
+	return step_binlog_write(n->config, mes);
+}
+
+/**
+ * @brief Returns the size of the frame at 'pos', 0 if the log ends part way
+ *        through it, or -EBADMSG if there is no frame at 'pos'.
+ */
+static int32_t step_binlog_frame_sz(const struct step_binlog_reader *r,
+				    uint32_t pos)
+{
+	const uint8_t *p = r->buf + pos;
+	uint32_t avail = r->len - pos;
+	uint32_t sz;
+	struct step_mes_header hdr;
+
+	if (avail < STEP_BINLOG_FRAME_HDR_SZ) {
+		return 0;
+	}
+	if (p[0] != STEP_BINLOG_SYNC) {
+		return -EBADMSG;
+	}
+
+	switch (p[1]) {
+	case STEP_BINLOG_FRAME_RECORD:
+		if (avail < STEP_BINLOG_FRAME_HDR_SZ + STEP_BINLOG_MES_HDR_SZ) {
+			return 0;
+		}
+		memcpy(&hdr, p + STEP_BINLOG_FRAME_HDR_SZ, sizeof(hdr));
+		sz = STEP_BINLOG_MES_HDR_SZ + hdr.srclen.len;
+		break;
+	case STEP_BINLOG_FRAME_INDEX:
+		sz = STEP_BINLOG_META_SZ + sys_get_le16(p + 2) * sizeof(uint32_t);
+		break;
+	case STEP_BINLOG_FRAME_END:
+		sz = STEP_BINLOG_META_SZ;
+		break;
+	default:
+		return -EBADMSG;
+	}
+
+	sz += STEP_BINLOG_FRAME_HDR_SZ + STEP_BINLOG_CRC_SZ;
+
+	return avail < sz ? 0 : (int32_t)sz;
+}
+
+/**
+ * @brief Checks the CRC of the 'sz'-byte frame at 'pos'.
+ */
+static bool step_binlog_crc_ok(const struct step_binlog_reader *r,
+			       uint32_t pos, uint32_t sz)
+{
+	const uint8_t *p = r->buf + pos;
+
+	return crc32_ieee(p, sz - STEP_BINLOG_CRC_SZ) ==
+	       sys_get_le32(p + sz - STEP_BINLOG_CRC_SZ);
+}
+
+/**
+ * @brief Returns the offset of the first complete, valid frame at or after
+ *        'pos', or the log's length if there is none.
+ */
+static uint32_t step_binlog_resync(const struct step_binlog_reader *r,
+				   uint32_t pos)
+{
+	int32_t sz;
+
+	for (; pos < r->len; pos++) {
+		if (r->buf[pos] != STEP_BINLOG_SYNC) {
+			continue;
+		}
+		sz = step_binlog_frame_sz(r, pos);
+		if ((sz > 0) && step_binlog_crc_ok(r, pos, sz)) {
+			return pos;
+		}
+	}
+
+	return r->len;
+}
+
+int step_binlog_reader_init(struct step_binlog_reader *r, const void *buf,
+			    uint32_t len)
+{
+	const uint8_t *end;
+
+	if ((buf == NULL) || (len < STEP_BINLOG_FILE_HDR_SZ) ||
+	    memcmp(buf, step_binlog_magic, sizeof(step_binlog_magic))) {
+		return -EINVAL;
+	}
+
+	r->buf = buf;
+	r->len = len;
+	if (r->buf[4] != STEP_BINLOG_VERSION) {
+		return -ENOTSUP;
+	}
+
+	r->pos = STEP_BINLOG_FILE_HDR_SZ;
+	r->next = 0;
+	r->finished = false;
+	r->last_index = STEP_BINLOG_OFFSET_NONE;
+	r->records = 0;
+	r->map = NULL;
+
+	/* Finished logs end with an end frame pointing to the last index. */
+	if (len >= STEP_BINLOG_FILE_HDR_SZ + STEP_BINLOG_END_SZ) {
+		end = r->buf + len - STEP_BINLOG_END_SZ;
+		if ((end[0] == STEP_BINLOG_SYNC) &&
+		    (end[1] == STEP_BINLOG_FRAME_END) &&
+		    step_binlog_crc_ok(r, len - STEP_BINLOG_END_SZ,
+				       STEP_BINLOG_END_SZ)) {
+			r->finished = true;
+			r->last_index = sys_get_le32(end + 4);
+			r->records = sys_get_le32(end + 8);
+		}
+	}
+
+	return 0;
+}
+
+int step_binlog_next(struct step_binlog_reader *r, struct step_binlog_rec *rec)
+{
+	const uint8_t *p;
+	uint32_t pos;
+	int32_t sz;
+
+	while (r->pos < r->len) {
+		p = r->buf + r->pos;
+		sz = step_binlog_frame_sz(r, r->pos);
+
+		if (sz == 0) {
+			/* Either the frame is still being written, or its
+			 * length is corrupt and there are valid frames after
+			 * it. */
+			pos = step_binlog_resync(r, r->pos + 1);
+			if (pos == r->len) {
+				return -ENODATA;
+			}
+			r->pos = pos;
+			return -EBADMSG;
+		}
+
+		if ((sz < 0) || !step_binlog_crc_ok(r, r->pos, sz)) {
+			r->pos = step_binlog_resync(r, r->pos + 1);
+			return -EBADMSG;
+		}
+
+		switch (p[1]) {
+		case STEP_BINLOG_FRAME_RECORD:
+			memcpy(&rec->header, p + STEP_BINLOG_FRAME_HDR_SZ,
+			       sizeof(rec->header));
+			rec->payload = p + STEP_BINLOG_FRAME_HDR_SZ +
+				       STEP_BINLOG_MES_HDR_SZ;
+			rec->offset = r->pos;
+			rec->index = r->next++;
+			r->pos += sz;
+			return 0;
+		case STEP_BINLOG_FRAME_INDEX:
+			/* Realign the record count, which may have drifted if
+			 * corrupt records were skipped. */
+			r->next = sys_get_le32(p + 8) + sys_get_le16(p + 2);
+			break;
+		default:
+			break;
+		}
+
+		r->pos += sz;
+	}
+
+	return -ENODATA;
+}
+
+/**
+ * @brief Seeks via the chain of index frames of a finished log.
+ *
+ * @return int  0 on success, -ENOENT if the chain is damaged.
+ */
+static int step_binlog_seek_index(struct step_binlog_reader *r,
+				  uint32_t index)
+{
+	const uint8_t *p;
+	uint32_t off = r->last_index;
+	uint32_t first;
+	uint32_t count;
+	int32_t sz;
+
+	while ((off >= STEP_BINLOG_FILE_HDR_SZ) && (off < r->len)) {
+		p = r->buf + off;
+		sz = step_binlog_frame_sz(r, off);
+		if ((sz <= 0) || (p[1] != STEP_BINLOG_FRAME_INDEX) ||
+		    !step_binlog_crc_ok(r, off, sz)) {
+			break;
+		}
+
+		first = sys_get_le32(p + 8);
+		count = sys_get_le16(p + 2);
+		if (index >= first) {
+			if (index - first >= count) {
+				break;
+			}
+			r->pos = sys_get_le32(p + STEP_BINLOG_FRAME_HDR_SZ +
+					      STEP_BINLOG_META_SZ +
+					      (index - first) * sizeof(uint32_t));
+			r->next = index;
+			return 0;
+		}
+
+		/* Index frames are written in order, so offsets only go back. */
+		if (sys_get_le32(p + 4) >= off) {
+			break;
+		}
+		off = sys_get_le32(p + 4);
+	}
+
+	return -ENOENT;
+}
+
+int step_binlog_seek(struct step_binlog_reader *r, uint32_t index)
+{
+	const uint8_t *p;
+	int32_t sz;
+
+	if (r->finished) {
+		if (index >= r->records) {
+			return -ENOENT;
+		}
+		if (step_binlog_seek_index(r, index) == 0) {
+			return 0;
+		}
+	}
+
+	/* Fall back to skipping records from the start. */
+	r->pos = STEP_BINLOG_FILE_HDR_SZ;
+	r->next = 0;
+	while ((r->pos < r->len) && (r->next <= index)) {
+		p = r->buf + r->pos;
+		sz = step_binlog_frame_sz(r, r->pos);
+		if (sz == 0) {
+			break;
+		} else if (sz < 0) {
+			r->pos = step_binlog_resync(r, r->pos + 1);
+			continue;
+		}
+
+		if (p[1] == STEP_BINLOG_FRAME_RECORD) {
+			if (r->next == index) {
+				return 0;
+			}
+			r->next++;
+		} else if (p[1] == STEP_BINLOG_FRAME_INDEX) {
+			r->next = sys_get_le32(p + 8) + sys_get_le16(p + 2);
+		}
+		r->pos += sz;
+	}
+
+	return -ENOENT;
+}
+
+void step_binlog_rec_mes(const struct step_binlog_rec *rec,
+			 struct step_measurement *mes)
+{
+	memset(mes, 0, sizeof(*mes));
+	mes->header = rec->header;
+	mes->payload = (void *)rec->payload;
+}
@@ -0,0 +1,67 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <step/binlog.h>
+
+int step_binlog_map(const char *path, struct step_binlog_reader *r)
+{
+	int fd;
+	int rc;
+	struct stat st;
+	void *map;
+
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		return -errno;
+	}
+
+	if (fstat(fd, &st) < 0) {
+		rc = -errno;
+		close(fd);
+		return rc;
+	}
+	if ((st.st_size < STEP_BINLOG_FILE_HDR_SZ) ||
+	    ((uint64_t)st.st_size > UINT32_MAX)) {
+		close(fd);
+		return -EINVAL;
+	}
+
+	/* The mapping stays valid once the file is closed. */
+	map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+	rc = map == MAP_FAILED ? -errno : 0;
+	close(fd);
+	if (rc) {
+		return rc;
+	}
+
+	/* Logs are mostly read front to back. */
+	(void)madvise(map, st.st_size, MADV_SEQUENTIAL);
+
+	rc = step_binlog_reader_init(r, map, (uint32_t)st.st_size);
+	if (rc) {
+		munmap(map, st.st_size);
+		return rc;
+	}
+	r->map = map;
+
+	return 0;
+}
+
+void step_binlog_unmap(struct step_binlog_reader *r)
+{
+	if (r->map != NULL) {
+		munmap(r->map, r->len);
+		r->map = NULL;
+		r->buf = NULL;
+		r->len = 0;
+	}
+}
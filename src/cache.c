@@ -8,42 +8,65 @@
 #include <step/cache.h>
 
 #if CONFIG_STEP_FILTER_CACHE
+/* Serialises the processor manager's lookups with application calls. */
+K_MUTEX_DEFINE(step_cache_mtx);
+
 static struct step_cache_rec step_cache_recs[CONFIG_STEP_FILTER_CACHE_DEPTH];
 
-/* Sample pool statistics */
-struct step_cache_stats {
+/* Number of records currently in use (the working set). Records at or
+ * beyond this index are always empty. */
+static uint32_t step_cache_depth = CONFIG_STEP_FILTER_CACHE_DEPTH;
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+/* Runtime cost tracking for the current evaluation window. */
+struct step_cache_window {
 	/**
-	 * @brief The number of times 'step_cache_clear' has been called.
+	 * @brief Lookups performed while the cache is active.
 	 */
-	uint32_t clear_calls;
+	uint32_t checks;
 
 	/**
-	 * @brief The number of times 'step_cache_check' has been called.
+	 * @brief Lookups that returned a cached result.
 	 */
-	uint32_t check_calls;
+	uint32_t hits;
 
 	/**
-	 * @brief The number of times 'step_cache_add' has been called.
+	 * @brief Records removed to make room for new entries.
 	 */
-	uint32_t add_calls;
+	uint32_t removals;
 
 	/**
-	 * @brief The number of matches.
+	 * @brief Uncached filter evaluations reported by the processor manager.
 	 */
-	uint32_t matches;
+	uint32_t evals;
 
 	/**
-	 * @brief The number of records removed due to an overflow.
+	 * @brief Cycles spent in 'step_cache_check' and 'step_cache_add'.
 	 */
-	uint32_t removals;
+	uint32_t cache_cyc;
+
+	/**
+	 * @brief Cycles spent on uncached filter evaluations.
+	 */
+	uint32_t eval_cyc;
+
+	/**
+	 * @brief Windows left before the cache is probed again, 0 if active.
+	 */
+	uint32_t bypass;
 };
 
+/* Cost tracking instance for the adaptive cache. */
+static struct step_cache_window step_cache_win = { 0 };
+#endif
+
 /* Stats tracking instance for STEP cache. */
 static struct step_cache_stats step_cache_stats_inst = { 0 };
 
 void step_cache_print(void)
 {
-	for (uint32_t i = 0; i < CONFIG_STEP_FILTER_CACHE_DEPTH; i++) {
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
 		if (step_cache_recs[i].last_used != 0) {
 			printk("%04d: 0x%08X 0x%02d %d (last_used: %" PRId64 ")\n", i,
 			       step_cache_recs[i].input,
@@ -54,18 +77,48 @@ void step_cache_print(void)
 			printk("%04d: empty\n", i);
 		}
 	}
+	k_mutex_unlock(&step_cache_mtx);
 }
 
 void step_cache_print_stats(void)
 {
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
 	printk("clear calls: %d\n", step_cache_stats_inst.clear_calls);
 	printk("check calls: %d\n", step_cache_stats_inst.check_calls);
 	printk("add calls:   %d\n", step_cache_stats_inst.add_calls);
 	printk("matches:     %d\n", step_cache_stats_inst.matches);
 	printk("removals:    %d\n", step_cache_stats_inst.removals);
+	printk("depth:       %d\n", step_cache_depth);
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	printk("bypassed:    %d windows\n", step_cache_stats_inst.bypassed_windows);
+	printk("resizes:     %d\n", step_cache_stats_inst.resizes);
+	printk("active:      %s\n", step_cache_active() ? "yes" : "no");
+#endif
+	k_mutex_unlock(&step_cache_mtx);
 }
 
-void step_cache_clear(void)
+void step_cache_stats_get(struct step_cache_stats *stats)
+{
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+	*stats = step_cache_stats_inst;
+	k_mutex_unlock(&step_cache_mtx);
+}
+
+void step_cache_stats_reset(void)
+{
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+	memset(&step_cache_stats_inst, 0, sizeof(step_cache_stats_inst));
+	k_mutex_unlock(&step_cache_mtx);
+}
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+static void step_cache_adapt(void);
+#endif
+
+/**
+ * @brief Empties every record. The cache lock must be held.
+ */
+static void step_cache_empty(void)
 {
 	step_cache_stats_inst.clear_calls++;
 
@@ -73,15 +126,27 @@ void step_cache_clear(void)
 	       sizeof(struct step_cache_rec) * CONFIG_STEP_FILTER_CACHE_DEPTH);
 }
 
+void step_cache_clear(void)
+{
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+	step_cache_empty();
+	k_mutex_unlock(&step_cache_mtx);
+}
+
 int step_cache_check(uint32_t filter, uint32_t handle, int *result)
 {
 	int match = 0;
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	uint32_t start = k_cycle_get_32();
+#endif
+
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
 
 	step_cache_stats_inst.check_calls++;
 
 	*result = 0;
 
-	for (uint32_t i = 0; i < CONFIG_STEP_FILTER_CACHE_DEPTH; i++) {
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
 		if ((step_cache_recs[i].last_used != 0) &&
 		    (step_cache_recs[i].input == filter) &&
 		    (step_cache_recs[i].handle == handle)) {
@@ -96,6 +161,16 @@ int step_cache_check(uint32_t filter, uint32_t handle, int *result)
 	}
 
 exit:
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	step_cache_win.cache_cyc += k_cycle_get_32() - start;
+	step_cache_win.checks++;
+	step_cache_win.hits += match;
+	if (step_cache_win.checks == CONFIG_STEP_FILTER_CACHE_ADAPTIVE_WINDOW) {
+		step_cache_adapt();
+	}
+#endif
+	k_mutex_unlock(&step_cache_mtx);
+
 	return match;
 }
 
@@ -104,11 +179,16 @@ int step_cache_add(uint32_t filter, uint32_t handle, int result)
 	int rc = 0;
 	int free = -1;
 	int64_t oldest = 0x7FFFFFFFFFFFFFFF;
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	uint32_t start = k_cycle_get_32();
+#endif
+
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
 
 	step_cache_stats_inst.add_calls++;
 
 	/* Scan for a free slot in the cache. */
-	for (uint32_t i = 0; i < CONFIG_STEP_FILTER_CACHE_DEPTH; i++) {
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
 		if (step_cache_recs[i].last_used == 0) {
 			free = i;
 			goto insert;
@@ -116,7 +196,7 @@ int step_cache_add(uint32_t filter, uint32_t handle, int result)
 	}
 
 	/* No free slot found, find the least recently used record. */
-	for (uint32_t i = 0; i < CONFIG_STEP_FILTER_CACHE_DEPTH; i++) {
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
 		if (step_cache_recs[i].last_used < oldest) {
 			oldest = step_cache_recs[i].last_used;
 			free = i;
@@ -125,6 +205,10 @@ int step_cache_add(uint32_t filter, uint32_t handle, int result)
 
 	/* Free least recently used record. */
 	memset(&(step_cache_recs[free]), 0, sizeof(struct step_cache_rec));
+	step_cache_stats_inst.removals++;
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	step_cache_win.removals++;
+#endif
 
 insert:
 	step_cache_recs[free].input = filter;
@@ -132,6 +216,157 @@ insert:
 	step_cache_recs[free].result = result;
 	step_cache_recs[free].last_used = k_uptime_get();
 
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	step_cache_win.cache_cyc += k_cycle_get_32() - start;
+#endif
+	k_mutex_unlock(&step_cache_mtx);
+
 	return rc;
 }
+
+/**
+ * @brief Resizes the working set to 'depth' records, which must be valid.
+ *        The cache lock must be held.
+ */
+static void step_cache_resize(uint32_t depth)
+{
+	uint32_t used = 0;
+
+	/* Compact records into the start of the cache so that the most recent
+	 * entries survive a reduction in size. */
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
+		if (step_cache_recs[i].last_used == 0) {
+			continue;
+		}
+		if (i != used) {
+			step_cache_recs[used] = step_cache_recs[i];
+			memset(&(step_cache_recs[i]), 0, sizeof(struct step_cache_rec));
+		}
+		used++;
+	}
+
+	/* Drop the least recently used records that no longer fit. */
+	while (used > depth) {
+		uint32_t lru = 0;
+
+		for (uint32_t i = 1; i < used; i++) {
+			if (step_cache_recs[i].last_used <
+			    step_cache_recs[lru].last_used) {
+				lru = i;
+			}
+		}
+		step_cache_recs[lru] = step_cache_recs[used - 1];
+		memset(&(step_cache_recs[used - 1]), 0, sizeof(struct step_cache_rec));
+		used--;
+	}
+
+	step_cache_depth = depth;
+}
+
+int step_cache_depth_set(uint32_t depth)
+{
+	if ((depth == 0) || (depth > CONFIG_STEP_FILTER_CACHE_DEPTH)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+	step_cache_resize(depth);
+	k_mutex_unlock(&step_cache_mtx);
+
+	return 0;
+}
+
+uint32_t step_cache_depth_get(void)
+{
+	return step_cache_depth;
+}
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+/**
+ * @brief Compares the cost of the cache against raw filter evaluation over
+ *        the last window, and enables, bypasses or resizes the cache. The
+ *        cache lock must be held.
+ */
+static void step_cache_adapt(void)
+{
+	struct step_cache_window *w = &step_cache_win;
+	uint32_t misses = w->checks - w->hits;
+	uint64_t eval_avg, cost_cached, cost_uncached;
+	uint32_t used = 0;
+
+	/* Without any misses there's no evaluation cost to compare against,
+	 * and the cache is clearly doing its job. */
+	if ((misses == 0) || (w->evals == 0)) {
+		goto resize;
+	}
+
+	/* Every lookup would need a full evaluation without the cache, while
+	 * with the cache only the misses are evaluated. */
+	eval_avg = w->eval_cyc / w->evals;
+	cost_uncached = eval_avg * w->checks;
+	cost_cached = (uint64_t)w->cache_cyc + eval_avg * misses;
+
+	if (cost_cached > cost_uncached) {
+		/* The cache is slower than evaluating: bypass it for a while,
+		 * and release its contents since they'll be stale on return. */
+		w->bypass = CONFIG_STEP_FILTER_CACHE_ADAPTIVE_PROBE;
+		step_cache_empty();
+		goto reset;
+	}
+
+resize:
+	/* Grow the working set if records were evicted, up to the budget. */
+	if ((w->removals > 0) && (step_cache_depth < CONFIG_STEP_FILTER_CACHE_DEPTH)) {
+		step_cache_resize(MIN(step_cache_depth * 2,
+				      CONFIG_STEP_FILTER_CACHE_DEPTH));
+		step_cache_stats_inst.resizes++;
+		goto reset;
+	}
+
+	/* Shrink the working set if less than half of it is in use, since
+	 * every lookup scans the whole working set. */
+	for (uint32_t i = 0; i < step_cache_depth; i++) {
+		used += step_cache_recs[i].last_used != 0 ? 1 : 0;
+	}
+	if ((w->removals == 0) && (used < step_cache_depth / 2) &&
+	    (step_cache_depth / 2 >= CONFIG_STEP_FILTER_CACHE_ADAPTIVE_MIN_DEPTH)) {
+		step_cache_resize(step_cache_depth / 2);
+		step_cache_stats_inst.resizes++;
+	}
+
+reset:
+	w->checks = w->hits = w->removals = w->evals = 0;
+	w->cache_cyc = w->eval_cyc = 0;
+}
+
+bool step_cache_active(void)
+{
+	return step_cache_win.bypass == 0;
+}
+
+void step_cache_report_eval(uint32_t cycles)
+{
+	struct step_cache_window *w = &step_cache_win;
+
+	k_mutex_lock(&step_cache_mtx, K_FOREVER);
+
+	w->evals++;
+	w->eval_cyc += cycles;
+
+	/* While bypassed, windows are counted in evaluations. Once enough
+	 * windows have passed, re-enable the cache to measure it again. */
+	if (w->bypass && (w->evals == CONFIG_STEP_FILTER_CACHE_ADAPTIVE_WINDOW)) {
+		step_cache_stats_inst.bypassed_windows++;
+		w->bypass--;
+		w->checks = w->hits = w->removals = 0;
+		w->cache_cyc = 0;
+		if (w->bypass) {
+			w->evals = 0;
+			w->eval_cyc = 0;
+		}
+	}
+
+	k_mutex_unlock(&step_cache_mtx);
+}
+#endif
 #endif
@@ -0,0 +1,577 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/cbor.h>
+
+/* Major types. */
+#define STEP_CBOR_MT_UINT       (0)
+#define STEP_CBOR_MT_NINT       (1)
+#define STEP_CBOR_MT_BYTES      (2)
+#define STEP_CBOR_MT_TEXT       (3)
+#define STEP_CBOR_MT_ARRAY      (4)
+#define STEP_CBOR_MT_MAP        (5)
+#define STEP_CBOR_MT_TAG        (6)
+#define STEP_CBOR_MT_SIMPLE     (7)
+
+/* Additional information values. */
+#define STEP_CBOR_AI_1BYTE      (24)
+#define STEP_CBOR_AI_2BYTES     (25)
+#define STEP_CBOR_AI_4BYTES     (26)
+#define STEP_CBOR_AI_8BYTES     (27)
+#define STEP_CBOR_AI_INDEF      (31)
+
+/* Simple values. */
+#define STEP_CBOR_FALSE         (20)
+#define STEP_CBOR_TRUE          (21)
+#define STEP_CBOR_NULL          (22)
+#define STEP_CBOR_UNDEF         (23)
+
+/**
+ * @brief Appends raw bytes, or only counts them in sizing mode.
+ */
+static int step_cbor_write(struct step_cbor_writer *w, const void *data,
+			   uint32_t len)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	if (w->buf != NULL) {
+		if (len > w->len - w->pos) {
+			w->err = -ENOSPC;
+			return w->err;
+		}
+		if (len) {
+			memcpy(w->buf + w->pos, data, len);
+		}
+	}
+	w->pos += len;
+
+	return 0;
+}
+
+/**
+ * @brief Writes an item head, using the shortest encoding for 'val'.
+ */
+static int step_cbor_put_head(struct step_cbor_writer *w, uint8_t major,
+			      uint64_t val)
+{
+	uint8_t hdr[9];
+	uint32_t len;
+
+	if (val < STEP_CBOR_AI_1BYTE) {
+		hdr[0] = (major << 5) | (uint8_t)val;
+		len = 1;
+	} else if (val <= UINT8_MAX) {
+		hdr[0] = (major << 5) | STEP_CBOR_AI_1BYTE;
+		hdr[1] = (uint8_t)val;
+		len = 2;
+	} else if (val <= UINT16_MAX) {
+		hdr[0] = (major << 5) | STEP_CBOR_AI_2BYTES;
+		sys_put_be16((uint16_t)val, &hdr[1]);
+		len = 3;
+	} else if (val <= UINT32_MAX) {
+		hdr[0] = (major << 5) | STEP_CBOR_AI_4BYTES;
+		sys_put_be32((uint32_t)val, &hdr[1]);
+		len = 5;
+	} else {
+		hdr[0] = (major << 5) | STEP_CBOR_AI_8BYTES;
+		sys_put_be64(val, &hdr[1]);
+		len = 9;
+	}
+
+	return step_cbor_write(w, hdr, len);
+}
+
+void step_cbor_writer_init(struct step_cbor_writer *w, uint8_t *buf,
+			   uint32_t len)
+{
+	w->buf = buf;
+	w->len = buf != NULL ? len : 0;
+	w->pos = 0;
+	w->err = 0;
+}
+
+void step_cbor_writer_init_mes(struct step_cbor_writer *w,
+			       struct step_measurement *mes)
+{
+	uint32_t ts = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	uint32_t cap = mes->capacity ? mes->capacity : mes->header.srclen.len;
+
+	step_cbor_writer_init(w, NULL, 0);
+
+	/* A missing payload would otherwise select sizing mode. */
+	if ((mes->payload == NULL) || (cap < ts)) {
+		w->err = -EINVAL;
+		return;
+	}
+
+	step_cbor_writer_init(w, (uint8_t *)mes->payload + ts, cap - ts);
+}
+
+int step_cbor_writer_finish(struct step_cbor_writer *w)
+{
+	return w->err ? w->err : (int)w->pos;
+}
+
+int step_cbor_writer_finish_mes(struct step_cbor_writer *w,
+				struct step_measurement *mes)
+{
+	if (w->err) {
+		return w->err;
+	}
+
+	mes->header.srclen.len =
+		step_mes_sz_timestamp(mes->header.filter.flags.timestamp) + w->pos;
+	mes->header.filter.flags.data_format = STEP_MES_FORMAT_CBOR;
+
+	return 0;
+}
+
+int step_cbor_put_uint(struct step_cbor_writer *w, uint64_t val)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_UINT, val);
+}
+
+int step_cbor_put_int(struct step_cbor_writer *w, int64_t val)
+{
+	if (val >= 0) {
+		return step_cbor_put_head(w, STEP_CBOR_MT_UINT, (uint64_t)val);
+	}
+
+	/* Negative integers are encoded as -1 - val. */
+	return step_cbor_put_head(w, STEP_CBOR_MT_NINT, (uint64_t)(-(val + 1)));
+}
+
+int step_cbor_put_bytes(struct step_cbor_writer *w, const void *data,
+			uint32_t len)
+{
+	step_cbor_put_head(w, STEP_CBOR_MT_BYTES, len);
+
+	return step_cbor_write(w, data, len);
+}
+
+int step_cbor_put_text(struct step_cbor_writer *w, const char *str,
+		       uint32_t len)
+{
+	step_cbor_put_head(w, STEP_CBOR_MT_TEXT, len);
+
+	return step_cbor_write(w, str, len);
+}
+
+int step_cbor_put_array(struct step_cbor_writer *w, uint32_t count)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_ARRAY, count);
+}
+
+int step_cbor_put_map(struct step_cbor_writer *w, uint32_t count)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_MAP, count);
+}
+
+int step_cbor_put_tag(struct step_cbor_writer *w, uint64_t tag)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_TAG, tag);
+}
+
+int step_cbor_put_bool(struct step_cbor_writer *w, bool val)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_SIMPLE,
+				  val ? STEP_CBOR_TRUE : STEP_CBOR_FALSE);
+}
+
+int step_cbor_put_null(struct step_cbor_writer *w)
+{
+	return step_cbor_put_head(w, STEP_CBOR_MT_SIMPLE, STEP_CBOR_NULL);
+}
+
+int step_cbor_put_float(struct step_cbor_writer *w, float val)
+{
+	uint8_t buf[5];
+	uint32_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	buf[0] = (STEP_CBOR_MT_SIMPLE << 5) | STEP_CBOR_AI_4BYTES;
+	sys_put_be32(bits, &buf[1]);
+
+	return step_cbor_write(w, buf, sizeof(buf));
+}
+
+int step_cbor_put_double(struct step_cbor_writer *w, double val)
+{
+	uint8_t buf[9];
+	uint64_t bits;
+
+	memcpy(&bits, &val, sizeof(bits));
+	buf[0] = (STEP_CBOR_MT_SIMPLE << 5) | STEP_CBOR_AI_8BYTES;
+	sys_put_be64(bits, &buf[1]);
+
+	return step_cbor_write(w, buf, sizeof(buf));
+}
+
+void step_cbor_reader_init(struct step_cbor_reader *r, const uint8_t *buf,
+			   uint32_t len)
+{
+	r->buf = buf;
+	r->len = buf != NULL ? len : 0;
+	r->pos = 0;
+}
+
+int step_cbor_reader_init_mes(struct step_cbor_reader *r,
+			      struct step_measurement *mes)
+{
+	uint32_t ts = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+
+	if ((mes->header.filter.flags.data_format != STEP_MES_FORMAT_CBOR) ||
+	    (mes->header.filter.flags.encoding != STEP_MES_ENCODING_NONE) ||
+	    (mes->header.filter.flags.compression != STEP_MES_COMPRESSION_NONE) ||
+	    (mes->payload == NULL) || (mes->header.srclen.len < ts)) {
+		step_cbor_reader_init(r, NULL, 0);
+		return -EINVAL;
+	}
+
+	step_cbor_reader_init(r, (const uint8_t *)mes->payload + ts,
+			      mes->header.srclen.len - ts);
+
+	return 0;
+}
+
+/**
+ * @brief Converts a half precision float to double precision.
+ */
+static double step_cbor_half(uint16_t h)
+{
+	uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+	int32_t exp = (h >> 10) & 0x1F;
+	uint32_t mant = h & 0x3FF;
+	uint32_t bits;
+	float f;
+
+	if (exp == 0) {
+		if (mant == 0) {
+			bits = sign;
+		} else {
+			/* Subnormal half, normal float. */
+			exp = 1;
+			while (!(mant & 0x400)) {
+				mant <<= 1;
+				exp--;
+			}
+			bits = sign | ((uint32_t)(exp + 112) << 23) |
+			       ((mant & 0x3FF) << 13);
+		}
+	} else if (exp == 31) {
+		/* Infinity or NaN. */
+		bits = sign | 0x7F800000 | (mant << 13);
+	} else {
+		bits = sign | ((uint32_t)(exp + 112) << 23) | (mant << 13);
+	}
+
+	memcpy(&f, &bits, sizeof(f));
+
+	return f;
+}
+
+int step_cbor_next(struct step_cbor_reader *r, struct step_cbor_item *item)
+{
+	uint32_t pos = r->pos;
+	uint64_t val;
+	uint32_t n;
+	uint8_t major;
+	uint8_t ai;
+	float f;
+	double d;
+
+	if (pos >= r->len) {
+		return -ENODATA;
+	}
+
+	major = r->buf[pos] >> 5;
+	ai = r->buf[pos] & 0x1F;
+	pos++;
+
+	/* Decode the argument. */
+	if (ai < STEP_CBOR_AI_1BYTE) {
+		val = ai;
+	} else if (ai <= STEP_CBOR_AI_8BYTES) {
+		n = 1 << (ai - STEP_CBOR_AI_1BYTE);
+		if (n > r->len - pos) {
+			return -EINVAL;
+		}
+		switch (n) {
+		case 1:
+			val = r->buf[pos];
+			break;
+		case 2:
+			val = sys_get_be16(&r->buf[pos]);
+			break;
+		case 4:
+			val = sys_get_be32(&r->buf[pos]);
+			break;
+		default:
+			val = sys_get_be64(&r->buf[pos]);
+			break;
+		}
+		pos += n;
+	} else if (ai == STEP_CBOR_AI_INDEF) {
+		return -ENOTSUP;
+	} else {
+		/* Reserved. */
+		return -EINVAL;
+	}
+
+	switch (major) {
+	case STEP_CBOR_MT_UINT:
+		item->type = STEP_CBOR_TYPE_UINT;
+		item->u = val;
+		break;
+	case STEP_CBOR_MT_NINT:
+		if (val > INT64_MAX) {
+			return -EINVAL;
+		}
+		item->type = STEP_CBOR_TYPE_NINT;
+		item->i = -1 - (int64_t)val;
+		break;
+	case STEP_CBOR_MT_BYTES:
+	case STEP_CBOR_MT_TEXT:
+		if (val > r->len - pos) {
+			return -EINVAL;
+		}
+		item->type = major == STEP_CBOR_MT_BYTES ?
+			     STEP_CBOR_TYPE_BYTES : STEP_CBOR_TYPE_TEXT;
+		item->str.ptr = &r->buf[pos];
+		item->str.len = (uint32_t)val;
+		pos += (uint32_t)val;
+		break;
+	case STEP_CBOR_MT_ARRAY:
+	case STEP_CBOR_MT_MAP:
+		if (val > UINT32_MAX) {
+			return -EINVAL;
+		}
+		item->type = major == STEP_CBOR_MT_ARRAY ?
+			     STEP_CBOR_TYPE_ARRAY : STEP_CBOR_TYPE_MAP;
+		item->count = (uint32_t)val;
+		break;
+	case STEP_CBOR_MT_TAG:
+		item->type = STEP_CBOR_TYPE_TAG;
+		item->u = val;
+		break;
+	default:
+		switch (ai) {
+		case STEP_CBOR_AI_2BYTES:
+			item->type = STEP_CBOR_TYPE_FLOAT;
+			item->f = step_cbor_half((uint16_t)val);
+			break;
+		case STEP_CBOR_AI_4BYTES:
+			n = (uint32_t)val;
+			memcpy(&f, &n, sizeof(f));
+			item->type = STEP_CBOR_TYPE_FLOAT;
+			item->f = f;
+			break;
+		case STEP_CBOR_AI_8BYTES:
+			memcpy(&d, &val, sizeof(d));
+			item->type = STEP_CBOR_TYPE_FLOAT;
+			item->f = d;
+			break;
+		case STEP_CBOR_FALSE:
+		case STEP_CBOR_TRUE:
+			item->type = STEP_CBOR_TYPE_BOOL;
+			item->b = ai == STEP_CBOR_TRUE;
+			break;
+		case STEP_CBOR_NULL:
+			item->type = STEP_CBOR_TYPE_NULL;
+			break;
+		case STEP_CBOR_UNDEF:
+			item->type = STEP_CBOR_TYPE_UNDEF;
+			break;
+		default:
+			/* Unassigned simple values. */
+			return -ENOTSUP;
+		}
+		break;
+	}
+
+	r->pos = pos;
+
+	return 0;
+}
+
+int step_cbor_skip(struct step_cbor_reader *r)
+{
+	int rc;
+	uint32_t start = r->pos;
+	uint64_t pending = 1;
+	struct step_cbor_item item;
+
+	while (pending) {
+		rc = step_cbor_next(r, &item);
+		if (rc) {
+			/* Running out of data inside a container is malformed. */
+			if ((rc == -ENODATA) && (r->pos != start)) {
+				rc = -EINVAL;
+			}
+			r->pos = start;
+			return rc;
+		}
+		pending--;
+
+		if (item.type == STEP_CBOR_TYPE_ARRAY) {
+			pending += item.count;
+		} else if (item.type == STEP_CBOR_TYPE_MAP) {
+			pending += (uint64_t)item.count * 2;
+		} else if (item.type == STEP_CBOR_TYPE_TAG) {
+			pending++;
+		}
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Reads the next item, rewinding the reader unless it has the
+ *        expected type.
+ */
+static int step_cbor_get(struct step_cbor_reader *r,
+			 struct step_cbor_item *item, enum step_cbor_type type)
+{
+	int rc;
+	uint32_t start = r->pos;
+
+	rc = step_cbor_next(r, item);
+	if (rc) {
+		return rc;
+	}
+
+	if (item->type != type) {
+		r->pos = start;
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int step_cbor_get_uint(struct step_cbor_reader *r, uint64_t *val)
+{
+	int rc;
+	struct step_cbor_item item;
+
+	rc = step_cbor_get(r, &item, STEP_CBOR_TYPE_UINT);
+	if (rc == 0) {
+		*val = item.u;
+	}
+
+	return rc;
+}
+
+int step_cbor_get_int(struct step_cbor_reader *r, int64_t *val)
+{
+	int rc;
+	uint32_t start = r->pos;
+	struct step_cbor_item item;
+
+	rc = step_cbor_next(r, &item);
+	if (rc) {
+		return rc;
+	}
+
+	if ((item.type == STEP_CBOR_TYPE_UINT) && (item.u <= INT64_MAX)) {
+		*val = (int64_t)item.u;
+	} else if (item.type == STEP_CBOR_TYPE_NINT) {
+		*val = item.i;
+	} else {
+		r->pos = start;
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int step_cbor_get_float(struct step_cbor_reader *r, float *val)
+{
+	int rc;
+	uint32_t start = r->pos;
+	struct step_cbor_item item;
+
+	rc = step_cbor_next(r, &item);
+	if (rc) {
+		return rc;
+	}
+
+	switch (item.type) {
+	case STEP_CBOR_TYPE_FLOAT:
+		*val = (float)item.f;
+		break;
+	case STEP_CBOR_TYPE_UINT:
+		*val = (float)item.u;
+		break;
+	case STEP_CBOR_TYPE_NINT:
+		*val = (float)item.i;
+		break;
+	default:
+		r->pos = start;
+		return -EBADMSG;
+	}
+
+	return 0;
+}
+
+int step_cbor_get_text(struct step_cbor_reader *r, const char **str,
+		       uint32_t *len)
+{
+	int rc;
+	struct step_cbor_item item;
+
+	rc = step_cbor_get(r, &item, STEP_CBOR_TYPE_TEXT);
+	if (rc == 0) {
+		*str = (const char *)item.str.ptr;
+		*len = item.str.len;
+	}
+
+	return rc;
+}
+
+int step_cbor_get_bytes(struct step_cbor_reader *r, const uint8_t **data,
+			uint32_t *len)
+{
+	int rc;
+	struct step_cbor_item item;
+
+	rc = step_cbor_get(r, &item, STEP_CBOR_TYPE_BYTES);
+	if (rc == 0) {
+		*data = item.str.ptr;
+		*len = item.str.len;
+	}
+
+	return rc;
+}
+
+int step_cbor_get_array(struct step_cbor_reader *r, uint32_t *count)
+{
+	int rc;
+	struct step_cbor_item item;
+
+	rc = step_cbor_get(r, &item, STEP_CBOR_TYPE_ARRAY);
+	if (rc == 0) {
+		*count = item.count;
+	}
+
+	return rc;
+}
+
+int step_cbor_get_map(struct step_cbor_reader *r, uint32_t *count)
+{
+	int rc;
+	struct step_cbor_item item;
+
+	rc = step_cbor_get(r, &item, STEP_CBOR_TYPE_MAP);
+	if (rc == 0) {
+		*count = item.count;
+	}
+
+	return rc;
+}
@@ -0,0 +1,419 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <step/convert.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+
+/* Number of values converted per block. */
+#define STEP_CONV_BLOCK         (32)
+/* Size of the arbitrary sample count word. */
+#define STEP_CONV_COUNT_SZ      (4)
+
+/**
+ * @brief Conversion between two related units, as 'to = from * mul + add'.
+ */
+struct step_conv_unit {
+	uint16_t from;
+	uint16_t to;
+	float mul;
+	float add;
+};
+
+static const struct step_conv_unit step_conv_units[] = {
+	{ STEP_MES_UNIT_SI_DEGREE_CELSIUS, STEP_MES_UNIT_SI_KELVIN, 1.0F, 273.15F },
+	{ STEP_MES_UNIT_SI_KELVIN, STEP_MES_UNIT_SI_DEGREE_CELSIUS, 1.0F, -273.15F },
+	{ STEP_MES_UNIT_SI_DEGREE, STEP_MES_UNIT_SI_RADIAN, 0.017453293F, 0.0F },
+	{ STEP_MES_UNIT_SI_RADIAN, STEP_MES_UNIT_SI_DEGREE, 57.29578F, 0.0F },
+	{ STEP_MES_UNIT_SI_HECTOPASCAL, STEP_MES_UNIT_SI_PASCAL, 100.0F, 0.0F },
+	{ STEP_MES_UNIT_SI_PASCAL, STEP_MES_UNIT_SI_HECTOPASCAL, 0.01F, 0.0F },
+	{ STEP_MES_UNIT_SI_MILLIVOLTS, STEP_MES_UNIT_SI_VOLT, 0.001F, 0.0F },
+	{ STEP_MES_UNIT_SI_VOLT, STEP_MES_UNIT_SI_MILLIVOLTS, 1000.0F, 0.0F },
+	{ STEP_MES_UNIT_SI_MICROTESLA, STEP_MES_UNIT_SI_TESLA, 0.000001F, 0.0F },
+	{ STEP_MES_UNIT_SI_TESLA, STEP_MES_UNIT_SI_MICROTESLA, 1000000.0F, 0.0F },
+	{ STEP_MES_UNIT_SI_GRAMS, STEP_MES_UNIT_SI_KILOGRAM, 0.001F, 0.0F },
+	{ STEP_MES_UNIT_SI_KILOGRAM, STEP_MES_UNIT_SI_GRAMS, 1000.0F, 0.0F },
+};
+
+/**
+ * @brief Returns the size of the supported ctypes, or 0 if unsupported.
+ */
+static uint32_t step_conv_sz_ctype(uint8_t ctype)
+{
+	switch (ctype) {
+	case STEP_MES_UNIT_CTYPE_S8:
+	case STEP_MES_UNIT_CTYPE_U8:
+		return 1;
+	case STEP_MES_UNIT_CTYPE_S16:
+	case STEP_MES_UNIT_CTYPE_U16:
+	case STEP_MES_UNIT_CTYPE_Q15:
+		return 2;
+	case STEP_MES_UNIT_CTYPE_S32:
+	case STEP_MES_UNIT_CTYPE_U32:
+	case STEP_MES_UNIT_CTYPE_Q31:
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32:
+		return 4;
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64:
+		return 8;
+	default:
+		return 0;
+	}
+}
+
+/**
+ * @brief Widens 'n' values of 'ctype' to float. 'src' may be unaligned.
+ */
+static void step_conv_load(const uint8_t *src, uint8_t ctype, float *out,
+			   uint32_t n)
+{
+	switch (ctype) {
+	case STEP_MES_UNIT_CTYPE_S8:
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)(int8_t)src[i];
+		}
+		break;
+	case STEP_MES_UNIT_CTYPE_U8:
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)src[i];
+		}
+		break;
+	case STEP_MES_UNIT_CTYPE_S16: {
+		int16_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i];
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_U16: {
+		uint16_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i];
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_S32: {
+		int32_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i];
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_U32: {
+		uint32_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i];
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_Q15: {
+		int16_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i] * (1.0F / 32768.0F);
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_Q31: {
+		int32_t v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i] * (1.0F / 2147483648.0F);
+		}
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32:
+		memcpy(out, src, n * sizeof(float));
+		break;
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64: {
+		double v[STEP_CONV_BLOCK];
+
+		memcpy(v, src, n * sizeof(v[0]));
+		for (uint32_t i = 0; i < n; i++) {
+			out[i] = (float)v[i];
+		}
+		break;
+	}
+	}
+}
+
+/**
+ * @brief Rounds to the nearest integer and clamps to [min, max].
+ */
+static inline float step_conv_round(float v, float min, float max)
+{
+	v = v < 0.0F ? v - 0.5F : v + 0.5F;
+
+	return v < min ? min : (v > max ? max : v);
+}
+
+/**
+ * @brief Narrows 'n' float values to 'ctype'. 'dst' may be unaligned.
+ */
+static void step_conv_store(const float *in, uint8_t *dst, uint8_t ctype,
+			    uint32_t n)
+{
+	switch (ctype) {
+	case STEP_MES_UNIT_CTYPE_S8:
+		for (uint32_t i = 0; i < n; i++) {
+			dst[i] = (uint8_t)(int8_t)step_conv_round(in[i], INT8_MIN,
+								  INT8_MAX);
+		}
+		break;
+	case STEP_MES_UNIT_CTYPE_U8:
+		for (uint32_t i = 0; i < n; i++) {
+			dst[i] = (uint8_t)step_conv_round(in[i], 0, UINT8_MAX);
+		}
+		break;
+	case STEP_MES_UNIT_CTYPE_S16: {
+		int16_t v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (int16_t)step_conv_round(in[i], INT16_MIN,
+							INT16_MAX);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_U16: {
+		uint16_t v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (uint16_t)step_conv_round(in[i], 0, UINT16_MAX);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_S32: {
+		int32_t v[STEP_CONV_BLOCK];
+
+		/* INT32_MAX isn't representable as a float, use the largest
+		 * float below it. */
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (int32_t)step_conv_round(in[i], -2147483648.0F,
+							2147483520.0F);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_U32: {
+		uint32_t v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (uint32_t)step_conv_round(in[i], 0.0F,
+							 4294967040.0F);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_Q15: {
+		int16_t v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (int16_t)step_conv_round(in[i] * 32768.0F,
+							INT16_MIN, INT16_MAX);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_Q31: {
+		int32_t v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (int32_t)step_conv_round(in[i] * 2147483648.0F,
+							-2147483648.0F,
+							2147483520.0F);
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32:
+		memcpy(dst, in, n * sizeof(float));
+		break;
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64: {
+		double v[STEP_CONV_BLOCK];
+
+		for (uint32_t i = 0; i < n; i++) {
+			v[i] = (double)in[i];
+		}
+		memcpy(dst, v, n * sizeof(v[0]));
+		break;
+	}
+	}
+}
+
+int step_conv_coeffs(uint16_t src_unit, int8_t src_scale, uint16_t dst_unit,
+		     int8_t dst_scale, float *scale, float *offset)
+{
+	float mul = 1.0F;
+	float add = 0.0F;
+	double p;
+	int32_t e;
+
+	if (src_unit != dst_unit) {
+		uint32_t i;
+
+		for (i = 0; i < ARRAY_SIZE(step_conv_units); i++) {
+			if ((step_conv_units[i].from == src_unit) &&
+			    (step_conv_units[i].to == dst_unit)) {
+				mul = step_conv_units[i].mul;
+				add = step_conv_units[i].add;
+				break;
+			}
+		}
+		if (i == ARRAY_SIZE(step_conv_units)) {
+			return -ENOTSUP;
+		}
+	}
+
+	/* Keep the exponent within float range. */
+	e = (int32_t)src_scale - dst_scale;
+	if ((e > 38) || (e < -38) || (dst_scale > 38) || (dst_scale < -38)) {
+		return -ERANGE;
+	}
+
+	/* out = (in * 10^src * mul + add) / 10^dst */
+	p = 1.0;
+	for (int32_t i = 0; i < (e < 0 ? -e : e); i++) {
+		p *= 10.0;
+	}
+	*scale = (float)(e < 0 ? mul / p : mul * p);
+
+	p = 1.0;
+	for (int32_t i = 0; i < (dst_scale < 0 ? -dst_scale : dst_scale); i++) {
+		p *= 10.0;
+	}
+	*offset = (float)(dst_scale < 0 ? add * p : add / p);
+
+	return 0;
+}
+
+int step_conv_values(const void *src, uint8_t src_ctype, void *dst,
+		     uint8_t dst_ctype, uint32_t count, float scale,
+		     float offset)
+{
+	float buf[STEP_CONV_BLOCK];
+	uint32_t ssz = step_conv_sz_ctype(src_ctype);
+	uint32_t dsz = step_conv_sz_ctype(dst_ctype);
+	uint32_t n;
+	uint32_t start;
+	bool affine = (scale != 1.0F) || (offset != 0.0F);
+	bool backwards = dsz > ssz;
+
+	if ((ssz == 0) || (dsz == 0)) {
+		return -ENOTSUP;
+	}
+
+	if ((src_ctype == dst_ctype) && !affine) {
+		if (src != dst) {
+			memmove(dst, src, count * ssz);
+		}
+		return 0;
+	}
+
+	/* When converting in place to a larger type, walk the blocks from the
+	 * end so that no source value is overwritten before it is read. */
+	for (uint32_t done = 0; done < count; done += n) {
+		n = MIN(count - done, STEP_CONV_BLOCK);
+		start = backwards ? count - done - n : done;
+
+		step_conv_load((const uint8_t *)src + start * ssz, src_ctype, buf,
+			       n);
+		if (affine) {
+			for (uint32_t i = 0; i < n; i++) {
+				buf[i] = buf[i] * scale + offset;
+			}
+		}
+		step_conv_store(buf, (uint8_t *)dst + start * dsz, dst_ctype, n);
+	}
+
+	return 0;
+}
+
+int step_conv_mes(struct step_measurement *mes,
+		  const struct step_conv_target *target)
+{
+	int rc;
+	float scale;
+	float offset;
+	uint8_t *payload = mes->payload;
+	uint16_t dst_unit = target->si_unit ? target->si_unit :
+			    mes->header.unit.si_unit;
+	uint8_t dst_ctype = target->ctype ? target->ctype :
+			    mes->header.unit.ctype;
+	uint32_t ssz = step_conv_sz_ctype(mes->header.unit.ctype);
+	uint32_t dsz = step_conv_sz_ctype(dst_ctype);
+	uint32_t off;
+	uint32_t count;
+	uint32_t capacity;
+
+	if (mes->header.filter.flags.data_format ||
+	    mes->header.filter.flags.encoding ||
+	    mes->header.filter.flags.compression ||
+	    (mes->header.srclen.fragment != STEP_MES_FRAGMENT_NONE)) {
+		return -EINVAL;
+	}
+	if ((ssz == 0) || (dsz == 0)) {
+		return -ENOTSUP;
+	}
+
+	off = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.samples == 15) {
+		off += STEP_CONV_COUNT_SZ;
+	}
+	if ((mes->header.srclen.len < off) ||
+	    ((mes->header.srclen.len - off) % ssz)) {
+		return -EINVAL;
+	}
+	count = (mes->header.srclen.len - off) / ssz;
+
+	capacity = mes->capacity ? mes->capacity : mes->header.srclen.len;
+	if (off + count * dsz > capacity) {
+		return -ENOSPC;
+	}
+
+	rc = step_conv_coeffs(mes->header.unit.si_unit,
+			      mes->header.unit.scale_factor, dst_unit,
+			      target->scale_factor, &scale, &offset);
+	if (rc) {
+		return rc;
+	}
+
+	rc = step_conv_values(payload + off, mes->header.unit.ctype,
+			      payload + off, dst_ctype, count, scale, offset);
+	if (rc) {
+		return rc;
+	}
+
+	mes->header.unit.si_unit = dst_unit;
+	mes->header.unit.scale_factor = target->scale_factor;
+	mes->header.unit.ctype = dst_ctype;
+	mes->header.srclen.len = off + count * dsz;
+
+	return 0;
+}
+
+int step_conv_exec(struct step_measurement *mes, uint32_t handle,
+		   uint32_t inst)
+{
+	struct step_node *n = step_pm_node_get(handle, inst);
+
+	if ((n == NULL) || (n->config == NULL)) {
+		return -EINVAL;
+	}
+
+	return step_conv_mes(mes, n->config);
+}
@@ -0,0 +1,335 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <step/encoding.h>
+#include <step/node.h>
+
+/* Invalid character marker in the decode tables. */
+#define STEP_ENC_INVALID        (0xFF)
+
+static const uint8_t step_enc_base64_chars[64] =
+	"ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+static const uint8_t step_enc_base45_chars[45] =
+	"0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ $%*+-./:";
+
+/* Character to 6-bit value, STEP_ENC_INVALID for anything else. */
+static const uint8_t step_enc_base64_vals[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0x3E, 0xFF, 0xFF, 0xFF, 0x3F,
+	0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B,
+	0x3C, 0x3D, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06,
+	0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E,
+	0x0F, 0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16,
+	0x17, 0x18, 0x19, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20,
+	0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28,
+	0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x2F, 0x30,
+	0x31, 0x32, 0x33, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+/* Character to base 45 digit, STEP_ENC_INVALID for anything else. */
+static const uint8_t step_enc_base45_vals[256] = {
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x24, 0xFF, 0xFF, 0xFF, 0x25, 0x26, 0xFF, 0xFF,
+	0xFF, 0xFF, 0x27, 0x28, 0xFF, 0x29, 0x2A, 0x2B,
+	0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+	0x08, 0x09, 0x2C, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F, 0x10,
+	0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18,
+	0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F, 0x20,
+	0x21, 0x22, 0x23, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+};
+
+int step_enc_base64_encode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len)
+{
+	uint32_t olen = STEP_ENC_BASE64_LEN(len);
+	uint32_t i = len - (len % 3);
+	uint32_t o = olen;
+	uint32_t v;
+
+	if (olen > dst_len) {
+		return -ENOSPC;
+	}
+
+	/* Work backwards, so each group is read before its output can overwrite
+	 * it when encoding in place. Start with the padded tail group. */
+	if (len % 3) {
+		v = src[i] << 16;
+		if (len % 3 == 2) {
+			v |= src[i + 1] << 8;
+		}
+		o -= 4;
+		dst[o] = step_enc_base64_chars[v >> 18];
+		dst[o + 1] = step_enc_base64_chars[(v >> 12) & 0x3F];
+		dst[o + 2] = (len % 3 == 2) ?
+			     step_enc_base64_chars[(v >> 6) & 0x3F] : '=';
+		dst[o + 3] = '=';
+	}
+
+	while (i) {
+		i -= 3;
+		o -= 4;
+		v = (src[i] << 16) | (src[i + 1] << 8) | src[i + 2];
+		dst[o] = step_enc_base64_chars[v >> 18];
+		dst[o + 1] = step_enc_base64_chars[(v >> 12) & 0x3F];
+		dst[o + 2] = step_enc_base64_chars[(v >> 6) & 0x3F];
+		dst[o + 3] = step_enc_base64_chars[v & 0x3F];
+	}
+
+	return olen;
+}
+
+int step_enc_base64_decode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len)
+{
+	uint32_t o = 0;
+	uint32_t pad = 0;
+	uint32_t v;
+	uint8_t a, b, c, d;
+
+	if (len % 4) {
+		return -EINVAL;
+	}
+
+	if (len) {
+		pad = (src[len - 1] == '=') + (src[len - 2] == '=');
+	}
+	if ((len / 4) * 3 - pad > dst_len) {
+		return -ENOSPC;
+	}
+
+	/* Work forwards, output never overtakes the input when in place. */
+	for (uint32_t i = 0; i < len; i += 4) {
+		a = step_enc_base64_vals[src[i]];
+		b = step_enc_base64_vals[src[i + 1]];
+		c = step_enc_base64_vals[src[i + 2]];
+		d = step_enc_base64_vals[src[i + 3]];
+
+		/* Padding is only valid at the end of the last group. */
+		if ((i + 4 == len) && pad) {
+			d = 0;
+			if (pad == 2) {
+				c = 0;
+			}
+		}
+
+		/* Valid values are < 64, so a single test catches all groups. */
+		if ((a | b | c | d) & 0xC0) {
+			return -EINVAL;
+		}
+
+		v = (a << 18) | (b << 12) | (c << 6) | d;
+		dst[o++] = v >> 16;
+		if ((i + 4 < len) || (pad < 2)) {
+			dst[o++] = (v >> 8) & 0xFF;
+		}
+		if ((i + 4 < len) || (pad < 1)) {
+			dst[o++] = v & 0xFF;
+		}
+	}
+
+	return o;
+}
+
+int step_enc_base45_encode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len)
+{
+	uint32_t olen = STEP_ENC_BASE45_LEN(len);
+	uint32_t i = len - (len % 2);
+	uint32_t o = olen;
+	uint32_t v;
+
+	if (olen > dst_len) {
+		return -ENOSPC;
+	}
+
+	/* Work backwards, so each pair is read before its output can overwrite
+	 * it when encoding in place. A trailing byte becomes two characters. */
+	if (len % 2) {
+		v = src[i];
+		o -= 2;
+		dst[o] = step_enc_base45_chars[v % 45];
+		dst[o + 1] = step_enc_base45_chars[v / 45];
+	}
+
+	while (i) {
+		i -= 2;
+		o -= 3;
+		v = (src[i] << 8) | src[i + 1];
+		dst[o] = step_enc_base45_chars[v % 45];
+		dst[o + 1] = step_enc_base45_chars[(v / 45) % 45];
+		dst[o + 2] = step_enc_base45_chars[v / 2025];
+	}
+
+	return olen;
+}
+
+int step_enc_base45_decode(const uint8_t *src, uint32_t len, uint8_t *dst,
+			   uint32_t dst_len)
+{
+	uint32_t o = 0;
+	uint32_t i = 0;
+	uint32_t v;
+	uint8_t c, d, e;
+
+	if (len % 3 == 1) {
+		return -EINVAL;
+	}
+	if ((len / 3) * 2 + (len % 3 ? 1 : 0) > dst_len) {
+		return -ENOSPC;
+	}
+
+	/* Work forwards, output never overtakes the input when in place. */
+	for (; i + 3 <= len; i += 3) {
+		c = step_enc_base45_vals[src[i]];
+		d = step_enc_base45_vals[src[i + 1]];
+		e = step_enc_base45_vals[src[i + 2]];
+		if ((c == STEP_ENC_INVALID) || (d == STEP_ENC_INVALID) ||
+		    (e == STEP_ENC_INVALID)) {
+			return -EINVAL;
+		}
+		v = c + (d * 45) + (e * 2025);
+		if (v > 0xFFFF) {
+			return -EINVAL;
+		}
+		dst[o++] = v >> 8;
+		dst[o++] = v & 0xFF;
+	}
+
+	/* Trailing pair encodes a single byte. */
+	if (i < len) {
+		c = step_enc_base45_vals[src[i]];
+		d = step_enc_base45_vals[src[i + 1]];
+		if ((c == STEP_ENC_INVALID) || (d == STEP_ENC_INVALID)) {
+			return -EINVAL;
+		}
+		v = c + (d * 45);
+		if (v > 0xFF) {
+			return -EINVAL;
+		}
+		dst[o++] = v;
+	}
+
+	return o;
+}
+
+/**
+ * @brief Encodes the measurement's payload in place, updating the header.
+ */
+static int step_enc_encode_mes(struct step_measurement *mes,
+			       enum step_mes_encoding enc)
+{
+	int rc;
+	uint32_t cap;
+
+	if (mes->header.filter.flags.encoding != STEP_MES_ENCODING_NONE) {
+		return 0;
+	}
+
+	cap = mes->capacity ? mes->capacity : mes->header.srclen.len;
+	if (enc == STEP_MES_ENCODING_BASE64) {
+		rc = step_enc_base64_encode(mes->payload, mes->header.srclen.len,
+					    mes->payload, cap);
+	} else {
+		rc = step_enc_base45_encode(mes->payload, mes->header.srclen.len,
+					    mes->payload, cap);
+	}
+	if (rc < 0) {
+		return rc;
+	}
+
+	mes->header.srclen.len = rc;
+	mes->header.filter.flags.encoding = enc;
+
+	return 0;
+}
+
+int step_enc_base64_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst)
+{
+	return step_enc_encode_mes(mes, STEP_MES_ENCODING_BASE64);
+}
+
+int step_enc_base45_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst)
+{
+	return step_enc_encode_mes(mes, STEP_MES_ENCODING_BASE45);
+}
+
+int step_enc_decode_exec(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst)
+{
+	int rc;
+
+	switch (mes->header.filter.flags.encoding) {
+	case STEP_MES_ENCODING_NONE:
+		return 0;
+	case STEP_MES_ENCODING_BASE64:
+		rc = step_enc_base64_decode(mes->payload, mes->header.srclen.len,
+					    mes->payload, mes->header.srclen.len);
+		break;
+	case STEP_MES_ENCODING_BASE45:
+		rc = step_enc_base45_decode(mes->payload, mes->header.srclen.len,
+					    mes->payload, mes->header.srclen.len);
+		break;
+	default:
+		return -ENOTSUP;
+	}
+	if (rc < 0) {
+		return rc;
+	}
+
+	mes->header.srclen.len = rc;
+	mes->header.filter.flags.encoding = STEP_MES_ENCODING_NONE;
+
+	return 0;
+}
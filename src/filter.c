@@ -5,8 +5,22 @@
  */
 
 #include <errno.h>
+#include <string.h>
 #include <step/filter.h>
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define STEP_FILT_BATCH_LANES (8)
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#define STEP_FILT_BATCH_LANES (4)
+#elif defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+#include <arm_mve.h>
+#define STEP_FILT_BATCH_LANES (4)
+#else
+#define STEP_FILT_BATCH_LANES (1)
+#endif
+
 void step_filt_print(struct step_filter_chain *fc)
 {
 	if (fc->count == 0) {
@@ -52,6 +66,47 @@ void step_filt_print(struct step_filter_chain *fc)
 	}
 }
 
+/**
+ * @brief Applies a filter chain operand to the current and previous results.
+ *
+ * @param op		The operand to apply.
+ * @param prev		Sum of the previous match results.
+ * @param curr_eval	Result of the current filter's equality check.
+ *
+ * @return int		1 if the chain matches up to this entry, otherwise 0.
+ */
+static int step_filt_apply_op(enum step_filter_op op, int prev, int curr_eval)
+{
+	int match = 0;
+
+	/* Operand evaluation against prev result(s). */
+	switch (op) {
+	case STEP_FILTER_OP_IS:
+		match = curr_eval ? 1 : 0;
+		break;
+	case STEP_FILTER_OP_NOT:
+		match = curr_eval ? 0 : 1;
+		break;
+	case STEP_FILTER_OP_AND:
+		match = (curr_eval & prev) ? 1 : 0;
+		break;
+	case STEP_FILTER_OP_AND_NOT:
+		match = (prev && !curr_eval) ? 1 : 0;
+		break;
+	case STEP_FILTER_OP_OR:
+		match = (prev || curr_eval) ? 1 : 0;
+		break;
+	case STEP_FILTER_OP_OR_NOT:
+		match = (prev || !curr_eval) ? 1 : 0;
+		break;
+	case STEP_FILTER_OP_XOR:
+		match = (prev != curr_eval) ? 1 : 0;
+		break;
+	}
+
+	return match;
+}
+
 /**
  * @brief Evaluates a single filter record.
  *
@@ -67,8 +122,6 @@ static void step_filt_evaluate_filter(struct step_filter *f,
 	uint32_t mes_cmp = mes->header.filter_bits;
 	uint32_t f_cmp = f->match;
 
-	*match = 0;
-
 	/* Mask out any ignored bits. */
 	if (f->ignore_mask) {
 		mes_cmp &= ~(f->ignore_mask);
@@ -78,30 +131,7 @@ static void step_filt_evaluate_filter(struct step_filter *f,
 	/* Equality check. */
 	curr_eval = (mes_cmp == f_cmp ? 1 : 0);
 
-	/* Operand evaluation against prev result(s). */
-	switch (f->op) {
-	case STEP_FILTER_OP_IS:
-		*match = curr_eval ? 1 : 0;
-		break;
-	case STEP_FILTER_OP_NOT:
-		*match = curr_eval ? 0 : 1;
-		break;
-	case STEP_FILTER_OP_AND:
-		*match = (curr_eval & prev) ? 1 : 0;
-		break;
-	case STEP_FILTER_OP_AND_NOT:
-		*match = (prev && !curr_eval) ? 1 : 0;
-		break;
-	case STEP_FILTER_OP_OR:
-		*match = (prev || curr_eval) ? 1 : 0;
-		break;
-	case STEP_FILTER_OP_OR_NOT:
-		*match = (prev || !curr_eval) ? 1 : 0;
-		break;
-	case STEP_FILTER_OP_XOR:
-		*match = (prev != curr_eval) ? 1 : 0;
-		break;
-	}
+	*match = step_filt_apply_op(f->op, prev, curr_eval);
 }
 
 int step_filt_evaluate(struct step_filter_chain *fc, struct step_measurement *mes,
@@ -151,3 +181,112 @@ err:
 bail:
 	return rc;
 }
+
+/**
+ * @brief Compares STEP_FILT_BATCH_LANES (mask, match) pairs against the
+ *        filter word, returning one result bit per pair.
+ *
+ * @param filter_bits	The measurement's filter word.
+ * @param mask		Pointer to the first mask to evaluate.
+ * @param match		Pointer to the first match value to evaluate.
+ *
+ * @return uint32_t	Bit 'n' is set if pair 'n' matched.
+ */
+static inline uint32_t step_filt_batch_lanes(uint32_t filter_bits,
+					     const uint32_t *mask,
+					     const uint32_t *match)
+{
+#if defined(__AVX2__)
+	__m256i f = _mm256_set1_epi32((int)filter_bits);
+	__m256i m = _mm256_loadu_si256((const __m256i *)mask);
+	__m256i v = _mm256_loadu_si256((const __m256i *)match);
+	__m256i eq = _mm256_cmpeq_epi32(_mm256_and_si256(f, m), v);
+
+	return (uint32_t)_mm256_movemask_ps(_mm256_castsi256_ps(eq));
+#elif defined(__SSE2__)
+	__m128i f = _mm_set1_epi32((int)filter_bits);
+	__m128i m = _mm_loadu_si128((const __m128i *)mask);
+	__m128i v = _mm_loadu_si128((const __m128i *)match);
+	__m128i eq = _mm_cmpeq_epi32(_mm_and_si128(f, m), v);
+
+	return (uint32_t)_mm_movemask_ps(_mm_castsi128_ps(eq));
+#elif defined(__ARM_FEATURE_MVE) && (__ARM_FEATURE_MVE & 1)
+	uint32x4_t f = vdupq_n_u32(filter_bits);
+	uint32x4_t m = vld1q_u32(mask);
+	uint32x4_t v = vld1q_u32(match);
+	/* MVE predicates hold 4 bits per 32-bit lane, keep one of each. */
+	uint32_t p = vcmpeqq_u32(vandq_u32(f, m), v);
+
+	return (p & 0x1) | ((p >> 3) & 0x2) | ((p >> 6) & 0x4) |
+	       ((p >> 9) & 0x8);
+#else
+	return ((filter_bits & mask[0]) == match[0]) ? 1 : 0;
+#endif
+}
+
+void step_filt_batch_evaluate(uint32_t filter_bits, const uint32_t *mask,
+			      const uint32_t *match, uint32_t count,
+			      uint32_t *bitmap)
+{
+	uint32_t i = 0;
+
+	memset(bitmap, 0, sizeof(uint32_t) * ((count + 31) / 32));
+
+	/* Evaluate as many full SIMD lanes as possible. Since the lane count
+	 * is a power of two <= 32, a block of lanes never spans two words. */
+	for (; i + STEP_FILT_BATCH_LANES <= count; i += STEP_FILT_BATCH_LANES) {
+		bitmap[i >> 5] |= step_filt_batch_lanes(filter_bits,
+							&mask[i], &match[i])
+				  << (i & 31);
+	}
+
+	/* Scalar tail. */
+	for (; i < count; i++) {
+		if ((filter_bits & mask[i]) == match[i]) {
+			bitmap[i >> 5] |= 1UL << (i & 31);
+		}
+	}
+}
+
+int step_filt_batch_resolve(struct step_filter_chain *fc,
+			    const uint32_t *bitmap, uint32_t first,
+			    uint32_t count, int *match)
+{
+	int rc = 0;
+	int curr_eval = 0;
+	uint32_t bit;
+
+	*match = 0;
+
+	/* Count = 0 or fc = NULL means accept all measurements. */
+	if ((fc == NULL) || (fc->count == 0) || (fc->chain == NULL)) {
+		*match = 1;
+		goto bail;
+	}
+
+	/* The table only holds the entries that were compiled. */
+	if (fc->count != count) {
+		rc = -EINVAL;
+		goto err;
+	}
+
+	/* Make sure we start the chain with IS or NOT operands. */
+	if ((fc->chain[0].op != STEP_FILTER_OP_IS) &&
+	    (fc->chain[0].op != STEP_FILTER_OP_NOT)) {
+		rc = -EINVAL;
+		goto err;
+	}
+
+	/* Fold the precomputed equality results using each entry's operand. */
+	for (uint32_t i = 0; i < count; i++) {
+		bit = first + i;
+		curr_eval = step_filt_apply_op(fc->chain[i].op, curr_eval,
+					       (bitmap[bit >> 5] >> (bit & 31)) & 1);
+	}
+
+	*match = curr_eval;
+
+err:
+bail:
+	return rc;
+}
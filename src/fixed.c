@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <step/fixed.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+
+/* Size of the arbitrary sample count word. */
+#define STEP_FIXED_COUNT_SZ     (4)
+
+/**
+ * @brief Reciprocal of a full scale of 10^(n+6) micro-units, as
+ *        'q = (micro * mul) >> shift'.
+ */
+struct step_fixed_recip {
+	uint32_t mul;
+	uint8_t shift;
+};
+
+/* 2^(31 + shift) / 10^(n + 6) for n = -6..3, with shift = floor(log2(10^(n + 6)))
+ * so that 'mul' keeps 31 significant bits. */
+static const struct step_fixed_recip step_fixed_recips[] = {
+	{ 2147483648U, 0 },
+	{ 1717986918U, 3 },
+	{ 1374389535U, 6 },
+	{ 1099511628U, 9 },
+	{ 1759218604U, 13 },
+	{ 1407374884U, 16 },
+	{ 1125899907U, 19 },
+	{ 1801439851U, 23 },
+	{ 1441151881U, 26 },
+	{ 1152921505U, 29 },
+};
+
+void step_q15_to_q31(const int16_t *src, int32_t *dst, uint32_t n)
+{
+	/* Walk backwards, since 'dst' is larger than 'src' in place. Shift
+	 * the unsigned bit pattern, since left-shifting a negative value is
+	 * undefined. */
+	for (uint32_t i = n; i > 0; i--) {
+		dst[i - 1] = (int32_t)((uint32_t)(uint16_t)src[i - 1] << 16);
+	}
+}
+
+void step_q31_to_q15(const int32_t *src, int16_t *dst, uint32_t n)
+{
+	for (uint32_t i = 0; i < n; i++) {
+		dst[i] = (int16_t)(src[i] >> 16);
+	}
+}
+
+void step_q31_scale(const int32_t *src, int32_t scale_fract, int8_t shift,
+		    int32_t *dst, uint32_t n)
+{
+	int32_t k = shift + 1;
+	int32_t in;
+	int32_t out;
+
+	for (uint32_t i = 0; i < n; i++) {
+		in = (int32_t)(((int64_t)src[i] * scale_fract) >> 32);
+		if (k >= 0) {
+			out = (int32_t)((uint32_t)in << k);
+			if (in != (out >> k)) {
+				/* Saturate in the direction of the input. */
+				out = INT32_MAX ^ (in >> 31);
+			}
+		} else {
+			out = in >> -k;
+		}
+		dst[i] = out;
+	}
+}
+
+int step_q31_from_micro(int64_t micro, int8_t scale, int32_t *q)
+{
+	const struct step_fixed_recip *r;
+	int64_t fs = 1;
+
+	if ((scale < -6) || (scale > 3)) {
+		return -ERANGE;
+	}
+
+	for (int32_t i = 0; i < scale + 6; i++) {
+		fs *= 10;
+	}
+
+	/* Saturating also keeps the product below within 61 bits. */
+	if (micro >= fs) {
+		*q = INT32_MAX;
+	} else if (micro <= -fs) {
+		*q = INT32_MIN;
+	} else {
+		r = &step_fixed_recips[scale + 6];
+		*q = (int32_t)((micro * r->mul +
+				(r->shift ? (1LL << (r->shift - 1)) : 0)) >>
+			       r->shift);
+	}
+
+	return 0;
+}
+
+int step_fixed_block_exec(struct step_measurement *mes, uint32_t handle,
+			  uint32_t inst)
+{
+	struct step_node *n = step_pm_node_get(handle, inst);
+	struct step_fixed_cfg *cfg = n != NULL ? n->config : NULL;
+	uint8_t *payload = mes->payload;
+	uint32_t sz;
+	uint32_t off;
+	uint32_t count;
+
+	if (cfg == NULL) {
+		return -EINVAL;
+	}
+
+	switch (mes->header.unit.ctype) {
+	case STEP_MES_UNIT_CTYPE_Q15:
+		sz = sizeof(int16_t);
+		break;
+	case STEP_MES_UNIT_CTYPE_Q31:
+		sz = sizeof(int32_t);
+		break;
+	default:
+		return 0;
+	}
+
+	if (mes->header.filter.flags.data_format ||
+	    mes->header.filter.flags.encoding ||
+	    mes->header.filter.flags.compression ||
+	    (mes->header.srclen.fragment != STEP_MES_FRAGMENT_NONE)) {
+		return 0;
+	}
+
+	off = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.samples == 15) {
+		off += STEP_FIXED_COUNT_SZ;
+	}
+	if ((mes->header.srclen.len < off) ||
+	    ((mes->header.srclen.len - off) % sz) ||
+	    ((uintptr_t)(payload + off) % sz)) {
+		return -EINVAL;
+	}
+	count = (mes->header.srclen.len - off) / sz;
+
+	if ((sz == sizeof(int32_t)) && (cfg->q31 != NULL)) {
+		cfg->q31((const int32_t *)(payload + off),
+			 (int32_t *)(payload + off), count);
+	} else if ((sz == sizeof(int16_t)) && (cfg->q15 != NULL)) {
+		cfg->q15((const int16_t *)(payload + off),
+			 (int16_t *)(payload + off), count);
+	}
+
+	return 0;
+}
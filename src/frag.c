@@ -0,0 +1,309 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <step/frag.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(frag);
+
+/**
+ * @brief Partial fragments held for a single source.
+ */
+struct step_frag_slot {
+	/** Set when this slot is in use. */
+	bool used;
+	/** The source ID the fragments belong to. */
+	uint8_t sourceid;
+	/** Set when the rest of the current set should be dropped. */
+	bool discard;
+	/** Number of fragments held. */
+	uint8_t count;
+	/** Uptime in ms when the first fragment arrived. */
+	uint32_t started;
+	/** The fragments, in arrival order. */
+	struct step_measurement *frags[CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS - 1];
+	/** Set for fragments that should be freed to the sample pool. */
+	bool pooled[CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS - 1];
+};
+
+K_MUTEX_DEFINE(step_frag_mtx);
+
+static struct step_frag_slot step_frag_slots[CONFIG_STEP_NODE_FRAG_SOURCES];
+
+/**
+ * @brief Frees the fragments held in a slot, and marks it as unused.
+ */
+static void step_frag_release(struct step_frag_slot *slot)
+{
+	for (uint32_t i = 0; i < slot->count; i++) {
+		if (slot->pooled[i]) {
+			step_sp_free(slot->frags[i]);
+		}
+	}
+
+	slot->count = 0;
+	slot->used = false;
+}
+
+/**
+ * @brief Drops sets that have been waiting for their final fragment for too
+ *        long.
+ */
+static void step_frag_expire(uint32_t now)
+{
+	for (uint32_t i = 0; i < CONFIG_STEP_NODE_FRAG_SOURCES; i++) {
+		if (step_frag_slots[i].used &&
+		    (now - step_frag_slots[i].started >
+		     CONFIG_STEP_NODE_FRAG_TIMEOUT_MS)) {
+			LOG_WRN("Reassembly timed out for source %u",
+				step_frag_slots[i].sourceid);
+			step_frag_release(&step_frag_slots[i]);
+		}
+	}
+}
+
+/**
+ * @brief Finds the slot for 'sourceid', optionally claiming a free one.
+ */
+static struct step_frag_slot *step_frag_slot_get(uint8_t sourceid, bool create)
+{
+	struct step_frag_slot *free_slot = NULL;
+
+	for (uint32_t i = 0; i < CONFIG_STEP_NODE_FRAG_SOURCES; i++) {
+		if (step_frag_slots[i].used) {
+			if (step_frag_slots[i].sourceid == sourceid) {
+				return &step_frag_slots[i];
+			}
+		} else if (free_slot == NULL) {
+			free_slot = &step_frag_slots[i];
+		}
+	}
+
+	if (!create || (free_slot == NULL)) {
+		return NULL;
+	}
+
+	free_slot->used = true;
+	free_slot->discard = false;
+	free_slot->sourceid = sourceid;
+	free_slot->count = 0;
+	free_slot->started = k_uptime_get_32();
+
+	return free_slot;
+}
+
+/**
+ * @brief Appends a fragment's payload to the view, skipping its timestamp.
+ */
+static int step_frag_view_add(struct step_frag_view *view,
+			      struct step_measurement *frag)
+{
+	uint32_t ts = step_mes_sz_timestamp(frag->header.filter.flags.timestamp);
+
+	if (frag->header.srclen.len < ts) {
+		return -EINVAL;
+	}
+
+	if (view->count == 0) {
+		view->header = frag->header;
+		view->header.srclen.fragment = STEP_MES_FRAGMENT_NONE;
+		view->timestamp = ts ? frag->payload : NULL;
+	}
+
+	view->seg[view->count].ptr = (const uint8_t *)frag->payload + ts;
+	view->seg[view->count].len = frag->header.srclen.len - ts;
+	view->len += view->seg[view->count].len;
+	view->count++;
+
+	return 0;
+}
+
+int step_frag_reassemble_exec(struct step_measurement *mes, uint32_t handle,
+			      uint32_t inst)
+{
+	int rc = 0;
+	struct step_node *n = step_pm_node_get(handle, inst);
+	struct step_frag_cfg *cfg = n != NULL ? n->config : NULL;
+	struct step_frag_slot *slot;
+	struct step_frag_view view;
+	uint32_t ts;
+
+	if (mes->header.srclen.fragment == STEP_MES_FRAGMENT_NONE) {
+		return 0;
+	}
+
+	if ((cfg == NULL) || (cfg->cb == NULL)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_frag_mtx, K_FOREVER);
+
+	step_frag_expire(k_uptime_get_32());
+
+	switch (mes->header.srclen.fragment) {
+	case STEP_MES_FRAGMENT_PARTIAL:
+		slot = step_frag_slot_get(mes->header.srclen.sourceid, true);
+		if (slot == NULL) {
+			LOG_WRN("No reassembly slot for source %u, fragment dropped",
+				mes->header.srclen.sourceid);
+			rc = STEP_NODE_RC_ABORT_CHAIN;
+			break;
+		}
+
+		/* Keep room for the final fragment in the view. Once a set
+		 * overflows, the rest of it is dropped up to its final fragment. */
+		if (slot->discard ||
+		    (slot->count == CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS - 1)) {
+			if (!slot->discard) {
+				LOG_WRN("Too many fragments for source %u, set dropped",
+					mes->header.srclen.sourceid);
+				step_frag_release(slot);
+				slot->used = true;
+				slot->discard = true;
+			}
+			rc = STEP_NODE_RC_ABORT_CHAIN;
+			break;
+		}
+
+		/* Take ownership of the fragment until the set is complete. */
+		slot->frags[slot->count] = mes;
+		slot->pooled[slot->count] = mes->queue.free_after_use;
+		slot->count++;
+		mes->queue.free_after_use = false;
+		rc = STEP_NODE_RC_ABORT_CHAIN;
+		break;
+
+	case STEP_MES_FRAGMENT_FINAL:
+		slot = step_frag_slot_get(mes->header.srclen.sourceid, false);
+		if ((slot != NULL) && slot->discard) {
+			step_frag_release(slot);
+			rc = STEP_NODE_RC_ABORT_CHAIN;
+			break;
+		}
+
+		memset(&view, 0, sizeof(view));
+		for (uint32_t i = 0; (slot != NULL) && (i < slot->count); i++) {
+			rc = step_frag_view_add(&view, slot->frags[i]);
+			if (rc) {
+				break;
+			}
+		}
+		if (rc == 0) {
+			rc = step_frag_view_add(&view, mes);
+		}
+
+		if (rc == 0) {
+			ts = step_mes_sz_timestamp(view.header.filter.flags.timestamp);
+			view.header.srclen.len = MIN(view.len + ts, UINT16_MAX);
+			cfg->cb(&view, cfg->user_data);
+		}
+
+		if (slot != NULL) {
+			step_frag_release(slot);
+		}
+		break;
+
+	default:
+		rc = -EINVAL;
+		break;
+	}
+
+	k_mutex_unlock(&step_frag_mtx);
+
+	return rc;
+}
+
+void step_frag_flush(void)
+{
+	k_mutex_lock(&step_frag_mtx, K_FOREVER);
+
+	for (uint32_t i = 0; i < CONFIG_STEP_NODE_FRAG_SOURCES; i++) {
+		if (step_frag_slots[i].used) {
+			step_frag_release(&step_frag_slots[i]);
+		}
+	}
+
+	k_mutex_unlock(&step_frag_mtx);
+}
+
+int step_frag_view_copy(const struct step_frag_view *view, uint32_t offset,
+			void *dst, uint32_t len)
+{
+	uint8_t *out = dst;
+	uint32_t chunk;
+
+	if ((offset > view->len) || (len > view->len - offset)) {
+		return -EINVAL;
+	}
+
+	for (uint32_t i = 0; (i < view->count) && len; i++) {
+		/* Skip segments before the offset. */
+		if (offset >= view->seg[i].len) {
+			offset -= view->seg[i].len;
+			continue;
+		}
+
+		chunk = MIN(view->seg[i].len - offset, len);
+		memcpy(out, view->seg[i].ptr + offset, chunk);
+		out += chunk;
+		len -= chunk;
+		offset = 0;
+	}
+
+	return 0;
+}
+
+int step_frag_split(struct step_measurement *mes, uint16_t max_len,
+		    step_frag_emit_t emit, void *user_data)
+{
+	int rc;
+	uint32_t off = 0;
+	uint32_t total = mes->header.srclen.len;
+	uint32_t ts = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	struct step_measurement frag;
+
+	if ((emit == NULL) || (max_len == 0) ||
+	    (mes->header.srclen.fragment != STEP_MES_FRAGMENT_NONE)) {
+		return -EINVAL;
+	}
+
+	if (total <= max_len) {
+		return emit(mes, user_data);
+	}
+
+	/* The first fragment must hold the timestamp and some data. */
+	if (max_len <= ts) {
+		return -EINVAL;
+	}
+
+	while (off < total) {
+		memset(&frag, 0, sizeof(frag));
+		frag.header = mes->header;
+		frag.payload = (uint8_t *)mes->payload + off;
+		frag.header.srclen.len = MIN(max_len, total - off);
+		frag.header.srclen.fragment = off + frag.header.srclen.len < total ?
+					      STEP_MES_FRAGMENT_PARTIAL :
+					      STEP_MES_FRAGMENT_FINAL;
+
+		/* Only the first fragment carries the timestamp. */
+		if (off) {
+			frag.header.filter.flags.timestamp = STEP_MES_TIMESTAMP_NONE;
+		}
+
+		rc = emit(&frag, user_data);
+		if (rc) {
+			return rc;
+		}
+
+		off += frag.header.srclen.len;
+	}
+
+	return 0;
+}
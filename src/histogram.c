@@ -0,0 +1,93 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <step/histogram.h>
+
+void step_hist_reset(struct step_hist *h)
+{
+	memset(h, 0, sizeof(*h));
+}
+
+void step_hist_merge(struct step_hist *dst, const struct step_hist *src)
+{
+	if (src->count == 0) {
+		return;
+	}
+
+	if ((dst->count == 0) || (src->min < dst->min)) {
+		dst->min = src->min;
+	}
+	if (src->max > dst->max) {
+		dst->max = src->max;
+	}
+	dst->count += src->count;
+	dst->sum += src->sum;
+
+	for (uint32_t i = 0; i < STEP_HIST_BUCKETS; i++) {
+		dst->buckets[i] += src->buckets[i];
+	}
+}
+
+uint32_t step_hist_bucket_max(uint32_t bucket)
+{
+	uint32_t shift;
+	uint32_t sub;
+
+	if (bucket < STEP_HIST_SUB_COUNT) {
+		return bucket;
+	}
+
+	/* Inverse of step_hist_bucket(). */
+	shift = (bucket >> CONFIG_STEP_HIST_SUB_BITS) - 1;
+	sub = STEP_HIST_SUB_COUNT | (bucket & (STEP_HIST_SUB_COUNT - 1));
+
+	return (uint32_t)((((uint64_t)sub + 1) << shift) - 1);
+}
+
+uint32_t step_hist_percentile(const struct step_hist *h, uint32_t pcm)
+{
+	uint64_t rank;
+	uint64_t seen = 0;
+	uint32_t val;
+
+	if (h->count == 0) {
+		return 0;
+	}
+
+	/* Rank of the value we're looking for, starting at 1. */
+	rank = ((uint64_t)h->count * pcm + 99999) / 100000;
+	if (rank == 0) {
+		rank = 1;
+	}
+
+	for (uint32_t i = 0; i < STEP_HIST_BUCKETS; i++) {
+		seen += h->buckets[i];
+		if (seen >= rank) {
+			val = step_hist_bucket_max(i);
+			return val > h->max ? h->max : val;
+		}
+	}
+
+	return h->max;
+}
+
+void step_hist_summarise(const struct step_hist *h,
+			 struct step_hist_summary *s)
+{
+	memset(s, 0, sizeof(*s));
+	if (h->count == 0) {
+		return;
+	}
+
+	s->count = h->count;
+	s->min = h->min;
+	s->max = h->max;
+	s->mean = (uint32_t)(h->sum / h->count);
+	s->p50 = step_hist_percentile(h, 50000);
+	s->p99 = step_hist_percentile(h, 99000);
+	s->p999 = step_hist_percentile(h, 99900);
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/init.h>
+#include <step/instrumentation.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(instrumentation);
+
+/* Empty START/STOP pairs to time during calibration. */
+#define STEP_INSTR_CAL_RUNS             32
+
+uint32_t step_instr_overhead_cyc;
+
+void step_instr_calibrate(void)
+{
+	step_instr_cyc_t t;
+	step_instr_cyc_t min = UINT32_MAX;
+
+	/* Measure the raw cost, then keep the shortest run. Longer runs were
+	 * interrupted or preempted. */
+	step_instr_overhead_cyc = 0;
+	for (uint32_t i = 0; i < STEP_INSTR_CAL_RUNS; i++) {
+		STEP_INSTR_START(t);
+		STEP_INSTR_STOP(t);
+		if (t < min) {
+			min = t;
+		}
+	}
+	step_instr_overhead_cyc = (uint32_t)min;
+
+	LOG_DBG("Instrumentation overhead: %u cycles (%u ns)",
+		step_instr_overhead_cyc,
+		(uint32_t)STEP_INSTR_TO_NS(step_instr_overhead_cyc));
+}
+
+static int step_instr_init(void)
+{
+	step_instr_calibrate();
+
+	return 0;
+}
+
+/* Calibrate before any APPLICATION level init can take measurements. */
+SYS_INIT(step_instr_init, POST_KERNEL, CONFIG_APPLICATION_INIT_PRIORITY);
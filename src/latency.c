@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <errno.h>
+#include <step/latency.h>
+
+K_MUTEX_DEFINE(step_lat_mtx);
+
+/* Latency histograms in cycles, per source ID slot and phase. Values are
+ * only converted to ns when they're reported. */
+static struct step_hist step_lat_hist[CONFIG_STEP_LATENCY_SOURCES]
+				     [STEP_LAT_PHASES];
+
+static const char *step_lat_phase_names[STEP_LAT_PHASES] = {
+	"fill", "queue", "service", "total"
+};
+
+static inline struct step_hist *step_lat_slot(uint8_t sourceid)
+{
+	if (sourceid >= CONFIG_STEP_LATENCY_SOURCES - 1) {
+		sourceid = CONFIG_STEP_LATENCY_SOURCES - 1;
+	}
+
+	return step_lat_hist[sourceid];
+}
+
+/**
+ * @brief Converts a cycle count to ns, saturating at UINT32_MAX.
+ */
+static inline uint32_t step_lat_ns(uint32_t cyc)
+{
+	uint64_t ns = k_cyc_to_ns_floor64(cyc);
+
+	return (ns > UINT32_MAX) ? UINT32_MAX : (uint32_t)ns;
+}
+
+/**
+ * @brief Summarises a histogram of cycle counts, in ns.
+ */
+static void step_lat_summarise(const struct step_hist *h,
+			       struct step_hist_summary *s)
+{
+	step_hist_summarise(h, s);
+	s->min = step_lat_ns(s->min);
+	s->max = step_lat_ns(s->max);
+	s->mean = step_lat_ns(s->mean);
+	s->p50 = step_lat_ns(s->p50);
+	s->p99 = step_lat_ns(s->p99);
+	s->p999 = step_lat_ns(s->p999);
+}
+
+void step_lat_record_dequeue(struct step_measurement *mes)
+{
+	struct step_hist *h = step_lat_slot(mes->header.srclen.sourceid);
+
+	mes->queue.stamp_dequeue = k_cycle_get_32();
+
+	k_mutex_lock(&step_lat_mtx, K_FOREVER);
+	/* Unsigned subtraction handles counter wraparound. */
+	step_hist_record(&h[STEP_LAT_FILL],
+			 mes->queue.stamp_put - mes->queue.stamp_alloc);
+	step_hist_record(&h[STEP_LAT_QUEUE],
+			 mes->queue.stamp_dequeue - mes->queue.stamp_put);
+	k_mutex_unlock(&step_lat_mtx);
+}
+
+void step_lat_record_delivery(const struct step_measurement *mes)
+{
+	struct step_hist *h = step_lat_slot(mes->header.srclen.sourceid);
+	uint32_t now = k_cycle_get_32();
+
+	k_mutex_lock(&step_lat_mtx, K_FOREVER);
+	step_hist_record(&h[STEP_LAT_SERVICE], now - mes->queue.stamp_dequeue);
+	step_hist_record(&h[STEP_LAT_TOTAL], now - mes->queue.stamp_alloc);
+	k_mutex_unlock(&step_lat_mtx);
+}
+
+int step_lat_get(uint8_t sourceid, enum step_lat_phase phase,
+		 struct step_hist_summary *s)
+{
+	if ((phase < STEP_LAT_FILL) || (phase >= STEP_LAT_PHASES)) {
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_lat_mtx, K_FOREVER);
+	step_lat_summarise(&step_lat_slot(sourceid)[phase], s);
+	k_mutex_unlock(&step_lat_mtx);
+
+	return 0;
+}
+
+void step_lat_reset(void)
+{
+	k_mutex_lock(&step_lat_mtx, K_FOREVER);
+	for (uint32_t i = 0; i < CONFIG_STEP_LATENCY_SOURCES; i++) {
+		for (uint32_t p = 0; p < STEP_LAT_PHASES; p++) {
+			step_hist_reset(&step_lat_hist[i][p]);
+		}
+	}
+	k_mutex_unlock(&step_lat_mtx);
+}
+
+void step_lat_print(void)
+{
+	struct step_hist_summary s;
+
+	k_mutex_lock(&step_lat_mtx, K_FOREVER);
+	for (uint32_t i = 0; i < CONFIG_STEP_LATENCY_SOURCES; i++) {
+		if (step_lat_hist[i][STEP_LAT_QUEUE].count == 0) {
+			continue;
+		}
+
+		if (i < CONFIG_STEP_LATENCY_SOURCES - 1) {
+			printk("Source %u:\n", i);
+		} else {
+			printk("Source %u+:\n", i);
+		}
+		for (uint32_t p = 0; p < STEP_LAT_PHASES; p++) {
+			step_lat_summarise(&step_lat_hist[i][p], &s);
+			printk("  %s: %u runs, mean %u, min %u, p50 %u, p99 %u, "
+			       "p99.9 %u, max %u ns\n",
+			       step_lat_phase_names[p], s.count, s.mean, s.min,
+			       s.p50, s.p99, s.p999, s.max);
+		}
+	}
+	k_mutex_unlock(&step_lat_mtx);
+}
@@ -0,0 +1,477 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/lz4.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(lz4);
+
+/* Minimum match length. */
+#define STEP_LZ4_MINMATCH       (4)
+/* The last match must start at least this many bytes before the block end. */
+#define STEP_LZ4_MFLIMIT        (12)
+/* The last bytes of a block are always literals. */
+#define STEP_LZ4_LASTLITERALS   (5)
+/* Largest match offset. */
+#define STEP_LZ4_MAX_DISTANCE   (65535)
+
+/**
+ * @brief Per-source streaming dictionary.
+ */
+struct step_lz4_dict {
+	/** The source ID this dictionary belongs to. */
+	uint8_t sourceid;
+	/** Set when this slot is in use. */
+	bool used;
+	/** Number of valid bytes in 'data'. */
+	uint16_t len;
+	/** Last time this slot was used, to replace the least recently used. */
+	uint32_t last_used;
+	/** The most recent uncompressed data from this source. */
+	uint8_t data[CONFIG_STEP_NODE_LZ4_DICT_SIZE];
+};
+
+/* Serialises access to the node state below. */
+K_MUTEX_DEFINE(step_lz4_node_mtx);
+
+/* Compressor state shared by all compress node instances. */
+static struct step_lz4_ctx step_lz4_node_ctx;
+
+/* Dictionary followed by the data being (de)compressed. */
+static uint8_t step_lz4_scratch[CONFIG_STEP_NODE_LZ4_DICT_SIZE +
+				CONFIG_STEP_NODE_LZ4_MAX_PAYLOAD];
+
+static struct step_lz4_dict step_lz4_enc_dict[CONFIG_STEP_NODE_LZ4_STREAM_SOURCES];
+static struct step_lz4_dict step_lz4_dec_dict[CONFIG_STEP_NODE_LZ4_STREAM_SOURCES];
+static uint32_t step_lz4_dict_clock;
+
+static inline uint32_t step_lz4_hash(const uint8_t *p)
+{
+	return (sys_get_le32(p) * 2654435761U) >>
+	       (32 - CONFIG_STEP_NODE_LZ4_HASH_LOG);
+}
+
+/**
+ * @brief Writes an LZ4 length extension (the part of a length >= 15).
+ */
+static inline uint8_t *step_lz4_put_len(uint8_t *op, uint32_t len)
+{
+	while (len >= 255) {
+		*op++ = 255;
+		len -= 255;
+	}
+	*op++ = (uint8_t)len;
+
+	return op;
+}
+
+/**
+ * @brief Writes a sequence to 'op', with 'mlen' set to 0 for the final,
+ *        literals-only sequence.
+ *
+ * @return uint8_t* The new output position, or NULL if it doesn't fit.
+ */
+static uint8_t *step_lz4_put_seq(uint8_t *op, uint8_t *oend,
+				 const uint8_t *lit, uint32_t llen,
+				 uint32_t off, uint32_t mlen)
+{
+	uint8_t *token = op++;
+	uint32_t need;
+
+	/* Worst case sequence size. */
+	need = 1 + llen + (llen / 255) + 1 + (mlen ? 2 + (mlen / 255) + 1 : 0);
+	if (need > (uint32_t)(oend - token)) {
+		return NULL;
+	}
+
+	*token = (uint8_t)(MIN(llen, 15) << 4);
+	if (llen >= 15) {
+		op = step_lz4_put_len(op, llen - 15);
+	}
+	memcpy(op, lit, llen);
+	op += llen;
+
+	if (mlen) {
+		mlen -= STEP_LZ4_MINMATCH;
+		*token |= (uint8_t)MIN(mlen, 15);
+		sys_put_le16((uint16_t)off, op);
+		op += 2;
+		if (mlen >= 15) {
+			op = step_lz4_put_len(op, mlen - 15);
+		}
+	}
+
+	return op;
+}
+
+int step_lz4_compress(struct step_lz4_ctx *ctx, const uint8_t *src,
+		      uint32_t src_len, uint32_t dict_len, uint8_t *dst,
+		      uint32_t dst_len)
+{
+	uint32_t ip = dict_len;
+	uint32_t anchor = dict_len;
+	uint32_t ref;
+	uint32_t mlen;
+	uint32_t h;
+	uint8_t *op = dst;
+	uint8_t *oend = dst + dst_len;
+
+	if ((ctx == NULL) || (src == NULL) || (dst == NULL) ||
+	    (dict_len > src_len) || (src_len > UINT16_MAX)) {
+		return -EINVAL;
+	}
+
+	/* Load the dictionary. */
+	for (uint32_t p = 0; p + STEP_LZ4_MINMATCH <= dict_len; p++) {
+		ctx->table[step_lz4_hash(src + p)] = (uint16_t)p;
+	}
+
+	/* Greedy match search, stopping where the last match may start. */
+	while (ip + STEP_LZ4_MFLIMIT <= src_len) {
+		h = step_lz4_hash(src + ip);
+		ref = ctx->table[h];
+		ctx->table[h] = (uint16_t)ip;
+
+		/* Entries left over from previous calls can point anywhere, so the
+		 * candidate is always checked against the input. */
+		if ((ref >= ip) || (ip - ref > STEP_LZ4_MAX_DISTANCE) ||
+		    (sys_get_le32(src + ref) != sys_get_le32(src + ip))) {
+			ip++;
+			continue;
+		}
+
+		/* Extend the match forwards, then backwards over the literals. */
+		mlen = STEP_LZ4_MINMATCH;
+		while ((ip + mlen < src_len - STEP_LZ4_LASTLITERALS) &&
+		       (src[ref + mlen] == src[ip + mlen])) {
+			mlen++;
+		}
+		while ((ip > anchor) && (ref > 0) && (src[ip - 1] == src[ref - 1])) {
+			ip--;
+			ref--;
+			mlen++;
+		}
+
+		op = step_lz4_put_seq(op, oend, src + anchor, ip - anchor,
+				      ip - ref, mlen);
+		if (op == NULL) {
+			return -ENOSPC;
+		}
+
+		ip += mlen;
+		anchor = ip;
+
+		/* Index a position inside the match to improve the next search. */
+		if (ip + STEP_LZ4_MFLIMIT <= src_len) {
+			ctx->table[step_lz4_hash(src + ip - 2)] = (uint16_t)(ip - 2);
+		}
+	}
+
+	/* Final literals. */
+	op = step_lz4_put_seq(op, oend, src + anchor, src_len - anchor, 0, 0);
+	if (op == NULL) {
+		return -ENOSPC;
+	}
+
+	return op - dst;
+}
+
+/**
+ * @brief Reads an LZ4 length extension, adding it to 'len'.
+ *
+ * @return int 0 on success, -EINVAL if the block ends first.
+ */
+static inline int step_lz4_get_len(const uint8_t *src, uint32_t src_len,
+				   uint32_t *ip, uint32_t *len)
+{
+	uint8_t b;
+
+	do {
+		if (*ip >= src_len) {
+			return -EINVAL;
+		}
+		b = src[(*ip)++];
+		*len += b;
+	} while (b == 255);
+
+	return 0;
+}
+
+int step_lz4_decompress(const uint8_t *src, uint32_t src_len, uint8_t *dst,
+			uint32_t dict_len, uint32_t dst_len)
+{
+	uint32_t ip = 0;
+	uint32_t op = dict_len;
+	uint32_t llen;
+	uint32_t mlen;
+	uint32_t off;
+	uint8_t token;
+
+	if ((src == NULL) || (dst == NULL) || (dict_len > dst_len)) {
+		return -EINVAL;
+	}
+
+	while (ip < src_len) {
+		token = src[ip++];
+
+		/* Literals. */
+		llen = token >> 4;
+		if ((llen == 15) && step_lz4_get_len(src, src_len, &ip, &llen)) {
+			return -EINVAL;
+		}
+		if (llen > src_len - ip) {
+			return -EINVAL;
+		}
+		if (llen > dst_len - op) {
+			return -ENOSPC;
+		}
+		memcpy(dst + op, src + ip, llen);
+		ip += llen;
+		op += llen;
+
+		/* The final sequence has no match. */
+		if (ip == src_len) {
+			break;
+		}
+
+		/* Match. */
+		if (src_len - ip < 2) {
+			return -EINVAL;
+		}
+		off = sys_get_le16(src + ip);
+		ip += 2;
+		if ((off == 0) || (off > op)) {
+			return -EINVAL;
+		}
+		mlen = token & 0xF;
+		if ((mlen == 15) && step_lz4_get_len(src, src_len, &ip, &mlen)) {
+			return -EINVAL;
+		}
+		mlen += STEP_LZ4_MINMATCH;
+		if (mlen > dst_len - op) {
+			return -ENOSPC;
+		}
+
+		/* Matches can overlap the output, so copy byte by byte. */
+		for (uint32_t i = 0; i < mlen; i++, op++) {
+			dst[op] = dst[op - off];
+		}
+	}
+
+	return op - dict_len;
+}
+
+/**
+ * @brief Finds the dictionary for 'sourceid', optionally replacing the least
+ *        recently used slot if it isn't present.
+ */
+static struct step_lz4_dict *step_lz4_dict_get(struct step_lz4_dict *dicts,
+					       uint8_t sourceid, bool create)
+{
+	struct step_lz4_dict *lru = &dicts[0];
+
+	for (uint32_t i = 0; i < CONFIG_STEP_NODE_LZ4_STREAM_SOURCES; i++) {
+		if (dicts[i].used && (dicts[i].sourceid == sourceid)) {
+			dicts[i].last_used = ++step_lz4_dict_clock;
+			return &dicts[i];
+		}
+		if (!dicts[i].used) {
+			lru = &dicts[i];
+		} else if (lru->used && (dicts[i].last_used < lru->last_used)) {
+			lru = &dicts[i];
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	lru->used = true;
+	lru->sourceid = sourceid;
+	lru->len = 0;
+	lru->last_used = ++step_lz4_dict_clock;
+
+	return lru;
+}
+
+/**
+ * @brief Keeps the tail of the 'len' bytes in the scratch buffer as the
+ *        source's next dictionary.
+ */
+static void step_lz4_dict_update(struct step_lz4_dict *dict, uint32_t len)
+{
+	uint32_t keep = MIN(len, CONFIG_STEP_NODE_LZ4_DICT_SIZE);
+
+	memcpy(dict->data, step_lz4_scratch + len - keep, keep);
+	dict->len = (uint16_t)keep;
+}
+
+/**
+ * @brief Returns true if the node instance is configured for streaming.
+ */
+static bool step_lz4_node_stream(uint32_t handle, uint32_t inst)
+{
+	struct step_node *n = step_pm_node_get(handle, inst);
+	struct step_lz4_cfg *cfg = n != NULL ? n->config : NULL;
+
+	return (cfg != NULL) && cfg->stream;
+}
+
+int step_lz4_compress_exec(struct step_measurement *mes, uint32_t handle,
+			   uint32_t inst)
+{
+	int rc = 0;
+	int clen;
+	uint8_t *payload = mes->payload;
+	uint32_t ts_len;
+	uint32_t data_len;
+	uint32_t dict_len = 0;
+	struct step_lz4_dict *dict = NULL;
+
+	if (mes->header.filter.flags.compression != STEP_MES_COMPRESSION_NONE) {
+		return 0;
+	}
+
+	ts_len = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.len < ts_len) {
+		return -EINVAL;
+	}
+	data_len = mes->header.srclen.len - ts_len;
+	if (data_len > CONFIG_STEP_NODE_LZ4_MAX_PAYLOAD) {
+		return -EFBIG;
+	}
+
+	k_mutex_lock(&step_lz4_node_mtx, K_FOREVER);
+
+	if (step_lz4_node_stream(handle, inst)) {
+		dict = step_lz4_dict_get(step_lz4_enc_dict,
+					 mes->header.srclen.sourceid, true);
+		dict_len = dict->len;
+		memcpy(step_lz4_scratch, dict->data, dict_len);
+	}
+	memcpy(step_lz4_scratch + dict_len, payload + ts_len, data_len);
+
+	/* Only keep the compressed block if it saves space. */
+	clen = -ENOSPC;
+	if (data_len > 3) {
+		clen = step_lz4_compress(&step_lz4_node_ctx, step_lz4_scratch,
+					 dict_len + data_len, dict_len,
+					 payload + ts_len + 2, data_len - 3);
+	}
+	if (clen < 0) {
+		/* Restore the payload, and restart the stream from scratch. */
+		memcpy(payload + ts_len, step_lz4_scratch + dict_len, data_len);
+		if (dict != NULL) {
+			dict->used = false;
+		}
+		goto out;
+	}
+
+	sys_put_le16((uint16_t)data_len, payload + ts_len);
+	mes->header.srclen.len = ts_len + 2 + clen;
+	mes->header.filter.flags.compression = dict_len ?
+		STEP_MES_COMPRESSION_LZ4_STREAM : STEP_MES_COMPRESSION_LZ4;
+
+	if (dict != NULL) {
+		step_lz4_dict_update(dict, dict_len + data_len);
+	}
+
+out:
+	k_mutex_unlock(&step_lz4_node_mtx);
+
+	return rc;
+}
+
+int step_lz4_decompress_exec(struct step_measurement *mes, uint32_t handle,
+			     uint32_t inst)
+{
+	int rc = 0;
+	uint8_t *payload = mes->payload;
+	uint32_t ts_len;
+	uint32_t orig_len;
+	uint32_t capacity;
+	uint32_t dict_len = 0;
+	uint8_t compression = mes->header.filter.flags.compression;
+	struct step_lz4_dict *dict = NULL;
+
+	if ((compression != STEP_MES_COMPRESSION_LZ4) &&
+	    (compression != STEP_MES_COMPRESSION_LZ4_STREAM)) {
+		return 0;
+	}
+
+	ts_len = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	if (mes->header.srclen.len < ts_len + 2) {
+		return -EINVAL;
+	}
+	orig_len = sys_get_le16(payload + ts_len);
+	capacity = mes->capacity ? mes->capacity : mes->header.srclen.len;
+	if (ts_len + orig_len > capacity) {
+		return -ENOSPC;
+	}
+	if (orig_len > CONFIG_STEP_NODE_LZ4_MAX_PAYLOAD) {
+		return -EFBIG;
+	}
+
+	k_mutex_lock(&step_lz4_node_mtx, K_FOREVER);
+
+	if (step_lz4_node_stream(handle, inst)) {
+		/* Independent blocks restart the source's stream. */
+		dict = step_lz4_dict_get(step_lz4_dec_dict,
+					 mes->header.srclen.sourceid,
+					 compression == STEP_MES_COMPRESSION_LZ4);
+		if (dict == NULL) {
+			LOG_ERR("No dictionary for source %u",
+				mes->header.srclen.sourceid);
+			rc = -ENOENT;
+			goto err;
+		}
+		if (compression == STEP_MES_COMPRESSION_LZ4_STREAM) {
+			dict_len = dict->len;
+			memcpy(step_lz4_scratch, dict->data, dict_len);
+		}
+	} else if (compression == STEP_MES_COMPRESSION_LZ4_STREAM) {
+		rc = -ENOTSUP;
+		goto err;
+	}
+
+	rc = step_lz4_decompress(payload + ts_len + 2,
+				 mes->header.srclen.len - ts_len - 2,
+				 step_lz4_scratch, dict_len,
+				 dict_len + CONFIG_STEP_NODE_LZ4_MAX_PAYLOAD);
+	if (rc != (int)orig_len) {
+		rc = rc < 0 ? rc : -EINVAL;
+		if (dict != NULL) {
+			dict->used = false;
+		}
+		goto err;
+	}
+	rc = 0;
+
+	memcpy(payload + ts_len, step_lz4_scratch + dict_len, orig_len);
+	mes->header.srclen.len = ts_len + orig_len;
+	mes->header.filter.flags.compression = STEP_MES_COMPRESSION_NONE;
+
+	if (dict != NULL) {
+		step_lz4_dict_update(dict, dict_len + orig_len);
+	}
+
+err:
+	k_mutex_unlock(&step_lz4_node_mtx);
+
+	return rc;
+}
+
+void step_lz4_reset(void)
+{
+	k_mutex_lock(&step_lz4_node_mtx, K_FOREVER);
+	memset(step_lz4_enc_dict, 0, sizeof(step_lz4_enc_dict));
+	memset(step_lz4_dec_dict, 0, sizeof(step_lz4_dec_dict));
+	k_mutex_unlock(&step_lz4_node_mtx);
+}
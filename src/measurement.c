@@ -4,177 +4,130 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <zephyr/sys/atomic.h>
+#include <zephyr/sys/util.h>
 #include <step/filter.h>
 #include <step/measurement/measurement.h>
 
+/* Size in bytes of each fixed-size ctype, indexed by ctype. Entries are 0
+ * when the size can't be determined from the ctype alone. */
+static const uint8_t step_mes_ctype_sz[256] = {
+	[STEP_MES_UNIT_CTYPE_S8] = 1,
+	[STEP_MES_UNIT_CTYPE_U8] = 1,
+	[STEP_MES_UNIT_CTYPE_BOOL] = 1,
+	[STEP_MES_UNIT_CTYPE_S16] = 2,
+	[STEP_MES_UNIT_CTYPE_U16] = 2,
+	[STEP_MES_UNIT_CTYPE_Q15] = 2,
+	[STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32] = 4,
+	[STEP_MES_UNIT_CTYPE_S32] = 4,
+	[STEP_MES_UNIT_CTYPE_U32] = 4,
+	[STEP_MES_UNIT_CTYPE_Q31] = 4,
+	[STEP_MES_UNIT_CTYPE_RANG_UNIT_INTERVAL_32] = 4,
+	[STEP_MES_UNIT_CTYPE_RANG_PERCENT_32] = 4,
+	[STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64] = 8,
+	[STEP_MES_UNIT_CTYPE_S64] = 8,
+	[STEP_MES_UNIT_CTYPE_U64] = 8,
+	[STEP_MES_UNIT_CTYPE_COMPLEX_32] = 8,
+	[STEP_MES_UNIT_CTYPE_RANG_UNIT_INTERVAL_64] = 8,
+	[STEP_MES_UNIT_CTYPE_RANG_PERCENT_64] = 8,
+	[STEP_MES_UNIT_CTYPE_IEEE754_FLOAT128] = 16,
+	[STEP_MES_UNIT_CTYPE_S128] = 16,
+	[STEP_MES_UNIT_CTYPE_U128] = 16,
+	[STEP_MES_UNIT_CTYPE_COMPLEX_64] = 16,
+};
+
+/* Size in bytes of each timestamp format, indexed by the 3-bit timestamp
+ * field. */
+static const uint8_t step_mes_ts_sz[8] = {
+	[STEP_MES_TIMESTAMP_EPOCH_32] = 4,
+	[STEP_MES_TIMESTAMP_UPTIME_MS_32] = 4,
+	[STEP_MES_TIMESTAMP_EPOCH_64] = 8,
+	[STEP_MES_TIMESTAMP_UPTIME_MS_64] = 8,
+	[STEP_MES_TIMESTAMP_UPTIME_US_64] = 8,
+};
+
+#if CONFIG_STEP_MES_SZ_CACHE
+/* Number of bits used to store the payload size in a cache entry. The
+ * remaining upper bits hold the key. */
+#define STEP_MES_SZ_CACHE_SZ_BITS       (11)
+#define STEP_MES_SZ_CACHE_SZ_MASK       ((1U << STEP_MES_SZ_CACHE_SZ_BITS) - 1)
+
+/* Minimum payload sizes of recently validated header templates. Each entry
+ * packs the key and size into a single word, so that entries can be read
+ * and updated atomically without a lock. 0 marks an empty entry, which can't
+ * collide with a valid one since cached ctypes are never 0. */
+static atomic_t step_mes_sz_cache[CONFIG_STEP_MES_SZ_CACHE];
+
 /**
- * @brief Simplistic ceil function for positive numbers.
- *
- * @param n The input floating point value.
- *
- * @return uint32_t The ceil of @ref n.
+ * @brief Packs the header fields that determine the minimum payload size
+ *        into a 21-bit key.
  */
-static int32_t step_mes_sz_ceil(float n)
+static uint32_t step_mes_sz_key(const struct step_mes_header *hdr)
 {
-	int32_t i = (int32_t)n;
-
-	if (n == (float)i) {
-		return i;
-	}
-
-	return i + 1;
+	return hdr->unit.ctype |
+	       ((uint32_t)hdr->srclen.vec_sz << 8) |
+	       ((uint32_t)hdr->srclen.samples << 10) |
+	       ((uint32_t)hdr->filter.flags.timestamp << 14) |
+	       ((uint32_t)hdr->filter.flags.encoding << 17);
 }
 
 /**
- * @brief Simplistic base 2 pow function for integers.
- *
- * @param e The input exponent.
- *
- * @return uint32_t The ceil of @ref n.
+ * @brief Cached version of @ref step_mes_sz_payload.
  */
-static uint32_t step_mes_sz_pow2(uint32_t e)
+static int32_t step_mes_sz_payload_cached(struct step_mes_header *hdr)
 {
-	uint32_t x = 1;
+	uint32_t key = step_mes_sz_key(hdr);
+	atomic_t *entry = &step_mes_sz_cache[(key ^ (key >> 8)) %
+					     CONFIG_STEP_MES_SZ_CACHE];
+	uint32_t val = (uint32_t)atomic_get(entry);
+	int32_t sz;
 
-	for (uint32_t i = 0; i < e; i++) {
-		x *= 2;
+	if ((val != 0) && ((val >> STEP_MES_SZ_CACHE_SZ_BITS) == key)) {
+		return val & STEP_MES_SZ_CACHE_SZ_MASK;
 	}
 
-	return x;
-}
-
-/**
- * @brief Calculates the number of bytes required to represent the specified
- *        timestamp in memory.
- *
- * @param ts        The @ref step_mes_timestamp to get the size of.
- *
- * @return uint32_t The number of bytes required to represent @ref ts in
- *                  memory.
- */
-static uint32_t step_mes_sz_timestamp(enum step_mes_timestamp ts)
-{
-	uint32_t len = 0;
-
-	switch (ts) {
-	case STEP_MES_TIMESTAMP_NONE:
-		len = 0;
-		break;
-	case STEP_MES_TIMESTAMP_EPOCH_32:
-	case STEP_MES_TIMESTAMP_UPTIME_MS_32:
-		len = 4;
-		break;
-	case STEP_MES_TIMESTAMP_EPOCH_64:
-	case STEP_MES_TIMESTAMP_UPTIME_MS_64:
-	case STEP_MES_TIMESTAMP_UPTIME_US_64:
-		len = 8;
-		break;
+	sz = step_mes_sz_payload(hdr);
+	if ((sz >= 0) && (sz <= STEP_MES_SZ_CACHE_SZ_MASK)) {
+		atomic_set(entry, (atomic_val_t)((key << STEP_MES_SZ_CACHE_SZ_BITS) |
+						 (uint32_t)sz));
 	}
 
-	return len;
+	return sz;
 }
+#endif
 
-/**
- * @brief Calculates the number of bytes required to represent the specified
- *        ctype in memory if a standard, fixed-size type is provided,
- *        or 0 if the size can't be determined.
- *
- * @param ctype     The @ref step_mes_unit_ctype to get the size of.
- *
- * @return int32_t  The number of bytes required to represent @ref ctype in
- *                  memory, or 0 if the exact size can't be determined.
- */
-static uint32_t step_mes_sz_ctype(enum step_mes_unit_ctype ctype)
+uint32_t step_mes_sz_timestamp(enum step_mes_timestamp ts)
 {
-	uint32_t len;
-
-	switch (ctype) {
-	case STEP_MES_UNIT_CTYPE_S8:
-	case STEP_MES_UNIT_CTYPE_U8:
-	case STEP_MES_UNIT_CTYPE_BOOL:
-		len = 1;
-		break;
-	case STEP_MES_UNIT_CTYPE_S16:
-	case STEP_MES_UNIT_CTYPE_U16:
-		len = 2;
-		break;
-	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32:
-	case STEP_MES_UNIT_CTYPE_S32:
-	case STEP_MES_UNIT_CTYPE_U32:
-	case STEP_MES_UNIT_CTYPE_RANG_UNIT_INTERVAL_32:
-	case STEP_MES_UNIT_CTYPE_RANG_PERCENT_32:
-		len = 4;
-		break;
-	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64:
-	case STEP_MES_UNIT_CTYPE_S64:
-	case STEP_MES_UNIT_CTYPE_U64:
-	case STEP_MES_UNIT_CTYPE_COMPLEX_32:
-	case STEP_MES_UNIT_CTYPE_RANG_UNIT_INTERVAL_64:
-	case STEP_MES_UNIT_CTYPE_RANG_PERCENT_64:
-		len = 8;
-		break;
-	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT128:
-	case STEP_MES_UNIT_CTYPE_S128:
-	case STEP_MES_UNIT_CTYPE_U128:
-	case STEP_MES_UNIT_CTYPE_COMPLEX_64:
-		len = 16;
-		break;
-	default:
-		len = 0;
-		break;
-	}
-
-	return len;
+	return (uint32_t)ts < ARRAY_SIZE(step_mes_ts_sz) ? step_mes_ts_sz[ts] : 0;
 }
 
 int32_t step_mes_sz_payload(struct step_mes_header *hdr)
 {
-	int32_t len = 0;
-    uint32_t cnt = 0;
-	uint32_t tmp;
-
-	/* Sample count. */
-	if (hdr->srclen.samples < 15) {
-		cnt = step_mes_sz_pow2(hdr->srclen.samples);
-	} else {
-		/* Can't determine length for an arbitrary sample count. */
-		len = -1;
-		goto err;
-	}
+	int32_t len;
+	uint32_t ctype_sz = step_mes_ctype_sz[hdr->unit.ctype];
 
-	/* CType. */
-	tmp = step_mes_sz_ctype(hdr->unit.ctype);
-	if (tmp) {
-		len += tmp * cnt;
-	} else {
-		/* Can't determine min payload length with an ambiguous ctype. */
-		len = -1;
-		goto err;
+	/* Can't determine length for an arbitrary sample count, or the min
+	 * payload length with an ambiguous ctype. */
+	if ((hdr->srclen.samples == 15) || (ctype_sz == 0)) {
+		return -1;
 	}
 
-	/* Vector size. */
-	if (hdr->srclen.vec_sz) {
-		len *= (1 + hdr->srclen.vec_sz);
-	}
+	/* CType, sample count (2^n) and vector size. */
+	len = (int32_t)((ctype_sz << hdr->srclen.samples) *
+			(1U + hdr->srclen.vec_sz));
 
 	/* Timestamp. */
-	if (hdr->filter.flags.timestamp) {
-		len += step_mes_sz_timestamp(hdr->filter.flags.timestamp);
-	}
+	len += step_mes_ts_sz[hdr->filter.flags.timestamp];
 
 	/* Encoding. */
 	switch (hdr->filter.flags.encoding) {
 	case STEP_MES_ENCODING_BASE64:
-		/* BASE64 encodes 3 bytes in 4 characters. */
-		len = step_mes_sz_ceil((float)len / 3.0F) * 4;
+		/* BASE64 encodes 3 bytes in 4 characters, with padding. */
+		len = (len + 2) / 3 * 4;
 		break;
 	case STEP_MES_ENCODING_BASE45:
-		/* Worst-case scenario for BASE45 = 1.67, except with 1 char. */
-		if (len == 1) {
-			len = 2;
-		} else {
-			len = step_mes_sz_ceil((float)len * 1.67);
-		}
+		/* BASE45 encodes 2 bytes in 3 characters, 1 byte in 2. */
+		len = len / 2 * 3 + (len % 2) * 2;
 		break;
 	case STEP_MES_ENCODING_NONE:
 	default:
@@ -182,7 +135,6 @@ int32_t step_mes_sz_payload(struct step_mes_header *hdr)
 		break;
 	}
 
-err:
 	return len;
 }
 
@@ -196,7 +148,16 @@ int32_t step_mes_validate(struct step_measurement *mes)
 		goto err;
 	}
 
+	/* Compressed payloads can be smaller than the minimum payload. */
+	if (mes->header.filter.flags.compression != STEP_MES_COMPRESSION_NONE) {
+		goto err;
+	}
+
+#if CONFIG_STEP_MES_SZ_CACHE
+	sz = step_mes_sz_payload_cached(&(mes->header));
+#else
 	sz = step_mes_sz_payload(&(mes->header));
+#endif
 	if ((sz >= 0) && (sz > mes->header.srclen.len)) {
 		/* Payload buffer isn't large enough. */
 		rc = -ENOSPC;
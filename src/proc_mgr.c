@@ -5,9 +5,18 @@
  */
 
 #include <string.h>
+#include <zephyr/init.h>
+#include <zephyr/sys/atomic.h>
 #include <step/proc_mgr.h>
 #include <step/cache.h>
 #include <step/instrumentation.h>
+#include <step/tracing.h>
+#if CONFIG_STEP_LATENCY
+#include <step/latency.h>
+#endif
+#if CONFIG_STEP_SOURCE_STATS
+#include <step/source_stats.h>
+#endif
 
 #define LOG_LEVEL LOG_LEVEL_DBG
 LOG_MODULE_REGISTER(proc_mgr);
@@ -64,18 +73,56 @@ struct step_pm_node_record {
 	 */
 	struct {
 		uint16_t enabled : 1;
+		uint16_t compiled : 1;
+		uint16_t exclusive : 1;
 	} flags;
 
+	/**
+	 * @brief Runtime counters, see @ref step_pm_node_stats_get.
+	 */
+	struct step_pm_node_stats stats;
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+	/**
+	 * @brief Number of times this record's filters have been evaluated
+	 *        since the last reordering (decayed by half on reorder).
+	 */
+	uint32_t evals;
+
+	/**
+	 * @brief Number of matches out of 'evals'.
+	 */
+	uint32_t matches;
+#endif
+
+#if CONFIG_STEP_FILTER_BATCH
+	/**
+	 * @brief Index of the first entry of this node's filter chain in the
+	 *        batch evaluation table, if 'flags.compiled' is set.
+	 */
+	uint16_t filt_first;
+
+	/**
+	 * @brief Number of filter chain entries compiled into the table, if
+	 *        'flags.compiled' is set.
+	 */
+	uint16_t filt_count;
+#endif
+
 #if CONFIG_STEP_INSTRUMENTATION
 	/**
-	 * @brief Runtime spent inside the node or node chain.
+	 * @brief Latency in timer cycles of every matching run of the node
+	 *        or node chain, including filter evaluation.
 	 */
-	uint32_t runtime_ns;
+	struct step_hist latency;
 
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
 	/**
-	 * @brief Number of times the node or node chain has run.
+	 * @brief Latency in timer cycles of the callbacks of each of the first
+	 *        CONFIG_STEP_INSTRUMENTATION_STAGES nodes in the chain.
 	 */
-	uint32_t runs;
+	struct step_hist stage_latency[CONFIG_STEP_INSTRUMENTATION_STAGES];
+#endif
 #endif
 };
 
@@ -94,29 +141,266 @@ static uint32_t step_pm_handle_counter = 0;
  * they should be evaluated. The 'process' function traverses this list. */
 static sys_slist_t pm_node_slist = SYS_SLIST_STATIC_INIT(&pm_node_slist);
 
+#if CONFIG_STEP_FILTER_BATCH
+/* Batch filter evaluation table. Every entry in the filter chain of a
+ * registered node is compiled into a (mask, match) pair, stored as a
+ * structure of arrays so that all entries can be evaluated in one pass. */
+static uint32_t step_pm_filt_mask[CONFIG_STEP_FILTER_BATCH_SLOTS];
+static uint32_t step_pm_filt_match[CONFIG_STEP_FILTER_BATCH_SLOTS];
+static uint32_t step_pm_filt_count = 0;
+#endif
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+/* Measurements processed since equal-priority records were last reordered. */
+static uint32_t step_pm_reorder_count = 0;
+#endif
+
+/* Processor manager counters. Counters updated by 'step_pm_put' can be
+ * written from any thread, the rest are only written by the work queue. */
+static struct {
+	atomic_t queued;
+	atomic_t depth;
+	atomic_t peak;
+	atomic_t put_errors;
+	atomic_t rejected;
+	uint32_t processed;
+	uint32_t dropped;
+} step_pm_stats_inst;
+
+#if CONFIG_STEP_INSTRUMENTATION
+/* Times one in every 'rate' measurements. The rate is only changed and read
+ * with the registry locked. */
+static uint32_t step_pm_instr_rate = CONFIG_STEP_INSTRUMENTATION_SAMPLE_RATE;
+#if CONFIG_STEP_INSTRUMENTATION_SAMPLE_RANDOM
+/* xorshift32 state, which must be non-zero. */
+static uint32_t step_pm_instr_rand = 0x9e3779b9;
+#else
+/* Measurements skipped since the last timed one. */
+static uint32_t step_pm_instr_skipped = 0;
+#endif
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+/* Timed measurements to average over before adjusting the rate. */
+#define STEP_PM_INSTR_BUDGET_RUNS       16
+/* Processing cycles, and the estimated cost of timing them, of the
+ * measurements timed since the rate was last adjusted. */
+static uint64_t step_pm_instr_run_cyc = 0;
+static uint64_t step_pm_instr_cost_cyc = 0;
+static uint32_t step_pm_instr_timed = 0;
+#endif
+#endif
+
+#if !CONFIG_STEP_SOURCE_STATS
+/* Measurements lost since the last warning, and the time it was logged.
+ * Starts a full interval in the past so that the first loss is reported
+ * straight away. */
+static uint32_t step_pm_lost_count = 0;
+static uint32_t step_pm_lost_warn = -CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS;
+#endif
+
 /* Registry should be locked during processing or when modifying it. */
 K_MUTEX_DEFINE(step_pm_reg_access);
 K_HEAP_DEFINE(step_callbacks_pool, CONFIG_STEP_PROC_MGR_CALLBACKS_NUM * sizeof(struct step_node_sub_callback));
 
 static int step_pm_process(struct step_measurement *mes, bool free);
 
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+/* Worker load and queue depth history, sampled from the system work queue
+ * so that sampling carries on when the worker is saturated. 'head' is the
+ * next entry to write. */
+K_MUTEX_DEFINE(step_pm_monitor_mtx);
+static struct k_work_delayable step_pm_monitor_work;
+static struct step_pm_monitor_sample step_pm_monitor_hist[CONFIG_STEP_PROC_MGR_MONITOR_HISTORY];
+static uint32_t step_pm_monitor_head = 0;
+static uint32_t step_pm_monitor_count = 0;
+
+/* Counters at the previous sample. */
+static k_thread_runtime_stats_t step_pm_monitor_prev_worker;
+static k_thread_runtime_stats_t step_pm_monitor_prev_all;
+static uint32_t step_pm_monitor_prev_processed;
+
+static inline uint16_t step_pm_permille(uint64_t part, uint64_t total)
+{
+	return (total == 0) ? 0 : (uint16_t)((part * 1000) / total);
+}
+
+/**
+ * @brief Records the worker's share of CPU time, the CPU load and the queue
+ *        depth since the previous sample, and schedules the next one.
+ */
+static void step_pm_monitor_handler(struct k_work *item)
+{
+	struct step_pm_monitor_sample *s;
+	k_thread_runtime_stats_t worker;
+	k_thread_runtime_stats_t all;
+	uint64_t elapsed;
+
+	k_thread_runtime_stats_get(k_work_queue_thread_get(&step_pm_work_q),
+				   &worker);
+	k_thread_runtime_stats_all_get(&all);
+
+	k_mutex_lock(&step_pm_monitor_mtx, K_FOREVER);
+
+	s = &step_pm_monitor_hist[step_pm_monitor_head];
+	elapsed = all.execution_cycles - step_pm_monitor_prev_all.execution_cycles;
+	s->worker_load = step_pm_permille(worker.execution_cycles -
+					  step_pm_monitor_prev_worker.execution_cycles,
+					  elapsed);
+#if CONFIG_SCHED_THREAD_USAGE_ALL
+	s->cpu_load = 1000 - step_pm_permille(all.idle_cycles -
+					      step_pm_monitor_prev_all.idle_cycles,
+					      elapsed);
+#else
+	s->cpu_load = 0;
+#endif
+	s->queue_depth = (uint32_t)atomic_get(&step_pm_stats_inst.depth);
+	s->processed = step_pm_stats_inst.processed - step_pm_monitor_prev_processed;
+
+	step_pm_monitor_head = (step_pm_monitor_head + 1) %
+			       CONFIG_STEP_PROC_MGR_MONITOR_HISTORY;
+	if (step_pm_monitor_count < CONFIG_STEP_PROC_MGR_MONITOR_HISTORY) {
+		step_pm_monitor_count++;
+	}
+
+	step_pm_monitor_prev_worker = worker;
+	step_pm_monitor_prev_all = all;
+	step_pm_monitor_prev_processed = step_pm_stats_inst.processed;
+
+	k_mutex_unlock(&step_pm_monitor_mtx);
+
+	k_work_schedule(&step_pm_monitor_work,
+			K_MSEC(CONFIG_STEP_PROC_MGR_MONITOR_INTERVAL_MS));
+}
+#endif
+
 static void step_pm_initialize_workqueue(void)
 {
 	/* if the PM workqueue is not started yet, wait it to gets up */
 	if (!step_pm_wqueue_started) {
+		/* Named so the worker can be found in the thread analyzer's
+		 * output. */
+		struct k_work_queue_config cfg = {
+			.name = "step_pm",
+		};
 
 		step_pm_wqueue_started = true;
 		k_work_queue_init(&step_pm_work_q);
 		k_work_queue_start(&step_pm_work_q, step_pm_work_stack, K_THREAD_STACK_SIZEOF(step_pm_work_stack),
-				CONFIG_STEP_PROC_MGR_PRIORITY, NULL);
+				CONFIG_STEP_PROC_MGR_PRIORITY, &cfg);
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+		/* Start sampling from the current counters. */
+		k_thread_runtime_stats_get(k_work_queue_thread_get(&step_pm_work_q),
+					   &step_pm_monitor_prev_worker);
+		k_thread_runtime_stats_all_get(&step_pm_monitor_prev_all);
+		k_work_init_delayable(&step_pm_monitor_work, step_pm_monitor_handler);
+		k_work_schedule(&step_pm_monitor_work,
+				K_MSEC(CONFIG_STEP_PROC_MGR_MONITOR_INTERVAL_MS));
+#endif
+	}
+}
+
+#if CONFIG_STEP_FILTER_BATCH
+/**
+ * @brief Compiles the filter chain of the supplied node record into the
+ *        batch evaluation table, if there is enough room left.
+ *
+ * @param pnode The node record to compile.
+ */
+static void step_pm_filt_compile(struct step_pm_node_record *pnode)
+{
+	struct step_filter_chain *fc = &(pnode->node->filters);
+
+	/* Catch-all chains are resolved without the table. */
+	if ((fc->count == 0) || (fc->chain == NULL)) {
+		return;
+	}
+
+	if (step_pm_filt_count + fc->count > CONFIG_STEP_FILTER_BATCH_SLOTS) {
+		LOG_WRN("Filter table full: node %d uses the filter engine",
+			pnode->handle);
+		return;
+	}
+
+	pnode->filt_first = step_pm_filt_count;
+	pnode->filt_count = fc->count;
+	for (uint32_t i = 0; i < fc->count; i++) {
+		step_pm_filt_mask[step_pm_filt_count] = ~(fc->chain[i].ignore_mask);
+		step_pm_filt_match[step_pm_filt_count] = fc->chain[i].match &
+							 ~(fc->chain[i].ignore_mask);
+		step_pm_filt_count++;
+	}
+	pnode->flags.compiled = 1;
+}
+#endif
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+/**
+ * @brief Indicates whether record 'a' matched a larger share of the
+ *        measurements it evaluated than record 'b'.
+ */
+static bool step_pm_reorder_before(struct step_pm_node_record *a,
+				   struct step_pm_node_record *b)
+{
+	return (uint64_t)a->matches * b->evals > (uint64_t)b->matches * a->evals;
+}
+
+/**
+ * @brief Reorders runs of records with the same priority by descending match
+ *        rate, so that the records most likely to match (and consume the
+ *        measurement, if exclusive) are evaluated first. The registry lock
+ *        must be held when calling this function.
+ */
+static void step_pm_reorder(void)
+{
+	struct step_pm_node_record *recs[CONFIG_STEP_PROC_MGR_NODE_LIMIT];
+	struct step_pm_node_record *pnode;
+	uint32_t count = 0;
+	uint32_t j;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&pm_node_slist, pnode, snode) {
+		recs[count++] = pnode;
+	}
+
+	/* Stable insertion sort, never moving a record past one with a
+	 * different priority. */
+	for (uint32_t i = 1; i < count; i++) {
+		pnode = recs[i];
+		for (j = i; j > 0; j--) {
+			if ((recs[j - 1]->priority != pnode->priority) ||
+			    !step_pm_reorder_before(pnode, recs[j - 1])) {
+				break;
+			}
+			recs[j] = recs[j - 1];
+		}
+		recs[j] = pnode;
+	}
+
+	/* Rebuild the list, and decay the counters so that the order follows
+	 * changes in the workload. */
+	sys_slist_init(&pm_node_slist);
+	for (uint32_t i = 0; i < count; i++) {
+		sys_slist_append(&pm_node_slist, &(recs[i]->snode));
+		recs[i]->evals >>= 1;
+		recs[i]->matches >>= 1;
 	}
 }
+#endif
 
 static void step_pm_poll_handler(struct k_work *item)
 {
 	struct step_platform_queue *link = CONTAINER_OF(item, struct step_platform_queue, work);
 	struct step_measurement *mes = CONTAINER_OF(link, struct step_measurement, queue);
 
+#if CONFIG_STEP_LATENCY
+	step_lat_record_dequeue(mes);
+#endif
+	atomic_dec(&step_pm_stats_inst.depth);
+	step_pm_stats_inst.processed++;
+#if CONFIG_STEP_SOURCE_STATS
+	step_src_record_processed(mes->header.srclen.sourceid);
+#endif
+
 	/* process this sample through node chains */
 	int rc = step_pm_process(mes, link->free_after_use);
 
@@ -125,6 +409,137 @@ static void step_pm_poll_handler(struct k_work *item)
 	}
 }
 
+/**
+ * @brief Fires a single node callback, calling the node's error handler if it
+ *        failed.
+ *
+ * @param n         The node the callback belongs to.
+ * @param cb        The callback to fire, can be NULL.
+ * @param mes       The measurement being processed.
+ * @param handle    The handle of the node chain.
+ * @param inst      The node's instance in the chain.
+ * @param errors    Incremented if the callback failed. The registry lock
+ *                  isn't held here, so the caller adds this to the node
+ *                  record's stats once it has re-locked.
+ *
+ * @return int  Any STEP_NODE_RC_* control flags returned by the callback.
+ */
+static int step_pm_fire(struct step_node *n, step_node_callback_t cb,
+			struct step_measurement *mes, uint32_t handle,
+			uint32_t inst, uint32_t *errors)
+{
+	int node_rc;
+
+	if (cb == NULL) {
+		return 0;
+	}
+
+	STEP_TRACE_NODE_ENTER(handle, inst, cb);
+	node_rc = cb(mes, handle, inst);
+	STEP_TRACE_NODE_EXIT(handle, inst, node_rc);
+
+	/* Call error handler if necessary. */
+	if (node_rc < 0) {
+		(*errors)++;
+		if (n->callbacks.error_handler != NULL) {
+			n->callbacks.error_handler(mes, handle, inst, node_rc);
+		}
+		return 0;
+	}
+
+	return node_rc & (STEP_NODE_RC_CONSUMED | STEP_NODE_RC_ABORT_CHAIN);
+}
+
+/**
+ * @brief Counts a measurement that no processor node matched, and logs a
+ *        warning at most once every CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS,
+ *        so that a stream of unmatched measurements can't flood the log.
+ *
+ * @param mes   The lost measurement.
+ */
+static void step_pm_lost(struct step_measurement *mes)
+{
+	step_pm_stats_inst.dropped++;
+
+#if CONFIG_STEP_SOURCE_STATS
+	step_src_record_unmatched(mes->header.srclen.sourceid);
+#else
+	uint32_t now = k_uptime_get_32();
+
+	step_pm_lost_count++;
+	if (now - step_pm_lost_warn >= CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS) {
+		LOG_WRN("%u measurement(s) lost since the last warning: no "
+			"processor node(s) matched", step_pm_lost_count);
+		step_pm_lost_count = 0;
+		step_pm_lost_warn = now;
+	}
+#endif
+}
+
+#if CONFIG_STEP_INSTRUMENTATION
+/**
+ * @brief Decides whether to time the processing of the next measurement.
+ *        The registry must be locked.
+ *
+ * @return uint32_t The number of measurements the timings stand for, which
+ *                  they are recorded with, or 0 to skip timing.
+ */
+static uint32_t step_pm_instr_sample(void)
+{
+	uint32_t rate = step_pm_instr_rate;
+
+	if (rate == 1) {
+		return 1;
+	}
+
+#if CONFIG_STEP_INSTRUMENTATION_SAMPLE_RANDOM
+	step_pm_instr_rand ^= step_pm_instr_rand << 13;
+	step_pm_instr_rand ^= step_pm_instr_rand >> 17;
+	step_pm_instr_rand ^= step_pm_instr_rand << 5;
+	return (step_pm_instr_rand % rate == 0) ? rate : 0;
+#else
+	if (++step_pm_instr_skipped < rate) {
+		return 0;
+	}
+	step_pm_instr_skipped = 0;
+	return rate;
+#endif
+}
+
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+/**
+ * @brief Accounts for a timed measurement, and adjusts the sample rate to
+ *        the overhead budget every STEP_PM_INSTR_BUDGET_RUNS timed
+ *        measurements. The registry must be locked.
+ *
+ * @param run   The processing cycles of the measurement.
+ * @param pairs The number of START/STOP pairs it took to time it.
+ */
+static void step_pm_instr_budget(uint64_t run, uint32_t pairs)
+{
+	uint64_t div;
+	uint64_t rate;
+
+	step_pm_instr_run_cyc += run;
+	step_pm_instr_cost_cyc += (uint64_t)pairs * step_instr_overhead();
+	if (++step_pm_instr_timed < STEP_PM_INSTR_BUDGET_RUNS) {
+		return;
+	}
+
+	/* Timing one in 'rate' measurements costs cost / (run * rate) of the
+	 * processing time, so pick the smallest rate within budget. */
+	div = MAX(step_pm_instr_run_cyc, 1) *
+	      CONFIG_STEP_INSTRUMENTATION_BUDGET;
+	rate = (step_pm_instr_cost_cyc * 1000 + div - 1) / div;
+	step_pm_instr_rate = CLAMP(rate, 1, 65535);
+
+	step_pm_instr_run_cyc = 0;
+	step_pm_instr_cost_cyc = 0;
+	step_pm_instr_timed = 0;
+}
+#endif
+#endif
+
 static int step_pm_process(struct step_measurement *mes, bool free)
 {
 	int rc = 0;
@@ -132,6 +547,8 @@ static int step_pm_process(struct step_measurement *mes, bool free)
 	int match_count = 0;
 	int cached = 0;
 	int node_idx = 0;
+	int ctrl = 0;
+	uint32_t errors = 0;
 	struct step_pm_node_record *pnode;
 	struct step_pm_node_record *tmp;
 	struct step_node *n;
@@ -139,18 +556,61 @@ static int step_pm_process(struct step_measurement *mes, bool free)
 	step_pm_initialize_workqueue();
 
 #if CONFIG_STEP_INSTRUMENTATION
-	uint32_t instr = 0;
+	step_instr_cyc_t instr = 0;
+	uint32_t instr_weight = 0;
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+	step_instr_cyc_t stage_instr = 0;
+	uint32_t stage_cyc[CONFIG_STEP_INSTRUMENTATION_STAGES];
+#endif
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+	uint64_t instr_run = 0;
+	uint32_t instr_pairs = 0;
+#endif
+#endif
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+	bool use_cache;
+	uint32_t eval_start;
+#endif
+
+#if CONFIG_STEP_FILTER_BATCH
+	uint32_t filt_bitmap[(CONFIG_STEP_FILTER_BATCH_SLOTS + 31) / 32];
+	uint32_t filt_evaluated;
 #endif
 
+	STEP_TRACE_DEQUEUE_ENTER(mes);
+
 	/* Lock registry access during processing. */
 	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
 
-	/* No nodes registered ... warn that sample will be lost. */
+	/* No nodes registered ... the sample will be lost. */
 	if (sys_slist_is_empty(&pm_node_slist)) {
-		LOG_WRN("Measurement lost: no processor node(s) registered");
+		step_pm_lost(mes);
 		goto abort;
 	}
 
+#if CONFIG_STEP_INSTRUMENTATION
+	/* Only time a sample of the measurements. */
+	instr_weight = step_pm_instr_sample();
+#endif
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+	/* Periodically reorder equal-priority records by selectivity. */
+	if (++step_pm_reorder_count >= CONFIG_STEP_PROC_MGR_REORDER_INTERVAL) {
+		step_pm_reorder_count = 0;
+		step_pm_reorder();
+	}
+#endif
+
+#if CONFIG_STEP_FILTER_BATCH
+	/* Evaluate every compiled filter entry against the measurement. Nodes
+	 * can be registered while the lock is released around each chain, so
+	 * only entries below 'filt_evaluated' have results. */
+	filt_evaluated = step_pm_filt_count;
+	step_filt_batch_evaluate(mes->header.filter_bits, step_pm_filt_mask,
+				 step_pm_filt_match, filt_evaluated, filt_bitmap);
+#endif
+
 	/* Cycle through registered nodes, checking for filter matches. */
 	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&pm_node_slist, pnode, tmp, snode) {
 		/* Skip disabled nodes. */
@@ -162,20 +622,48 @@ static int step_pm_process(struct step_measurement *mes, bool free)
 
 #if CONFIG_STEP_INSTRUMENTATION
 			/* Start total runtime INSTR timer. */
-			STEP_INSTR_START(instr);
+			if (instr_weight) {
+				STEP_INSTR_START(instr);
+			}
 #endif
 
-#if CONFIG_STEP_FILTER_CACHE
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+			/* Check filter cache for cached match results, unless the
+			 * adaptive cache decided evaluation is cheaper. */
+			use_cache = step_cache_active();
+			cached = use_cache ? step_cache_check(mes->header.filter_bits,
+							      pnode->handle, &match) : 0;
+			if (use_cache) {
+				STEP_TRACE_CACHE(pnode->handle, cached);
+			}
+#elif CONFIG_STEP_FILTER_CACHE
 			/* Check filter cache for cached match results. */
 			cached = step_cache_check(mes->header.filter_bits,
 						  pnode->handle, &match);
+			STEP_TRACE_CACHE(pnode->handle, cached);
 #endif
 			/* Evaluate filter match. */
 			if (!cached) {
+				STEP_TRACE_EVAL_ENTER(pnode->handle);
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+				eval_start = k_cycle_get_32();
+#endif
 				if (n->callbacks.evaluate_handler != NULL) {
 					/* Use the node's evaluate callback to determine match. */
 					match = n->callbacks.evaluate_handler(mes,
 									      pnode->handle, node_idx);
+#if CONFIG_STEP_FILTER_BATCH
+				} else if (pnode->flags.compiled &&
+					   (pnode->filt_first + pnode->filt_count <=
+					    filt_evaluated) &&
+					   (n->filters.count == pnode->filt_count)) {
+					/* Resolve the chain from the batch results, unless
+					 * it was compiled after they were computed or has
+					 * changed since it was compiled. */
+					rc = step_filt_batch_resolve(&(n->filters), filt_bitmap,
+								     pnode->filt_first,
+								     pnode->filt_count, &match);
+#endif
 				} else {
 					/* Standard evaluation against the node's filter chain. */
 					rc = step_filt_evaluate(&(n->filters), mes, &match);
@@ -186,64 +674,88 @@ static int step_pm_process(struct step_measurement *mes, bool free)
 					match = n->callbacks.matched_handler(mes,
 									     pnode->handle, node_idx);
 				}
-
-#if CONFIG_STEP_FILTER_CACHE
+				STEP_TRACE_EVAL_EXIT(pnode->handle, match);
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+				/* Report evaluation cost, and cache results if active. */
+				step_cache_report_eval(k_cycle_get_32() - eval_start);
+				if (use_cache) {
+					step_cache_add(mes->header.filter_bits,
+						       pnode->handle, match);
+				}
+#elif CONFIG_STEP_FILTER_CACHE
 				/* Add match results to cache. */
 				step_cache_add(mes->header.filter_bits, pnode->handle, match);
 #endif
 			}
 
+			pnode->stats.evals++;
+			pnode->stats.matches += match ? 1 : 0;
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+			/* Track the record's selectivity. */
+			pnode->evals++;
+			pnode->matches += match ? 1 : 0;
+#endif
+
 			/* Release the registry lock. */
 			k_mutex_unlock(&step_pm_reg_access);
 
 			/* Execute processor node chain on match. */
 			if (match) {
-				/* Sequentially fire each node in the node chain. */
+				/* Sequentially fire each node in the node chain, until
+				 * the end of the chain or a node aborts it. */
+				ctrl = 0;
+				errors = 0;
 				do {
-					int node_rc;
-					/* Call start handler if requested. */
-					if (n->callbacks.start_handler != NULL) {
-						node_rc = n->callbacks.start_handler(mes,
-										     pnode->handle, node_idx);
-						/* Call error handler if necessary. */
-						if (node_rc) {
-							n->callbacks.error_handler(mes,
-										   pnode->handle, node_idx, node_rc);
-						}
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+					if (instr_weight &&
+					    (node_idx < CONFIG_STEP_INSTRUMENTATION_STAGES)) {
+						STEP_INSTR_START(stage_instr);
 					}
-
-					/* Execute the main node processor. */
-					if (n->callbacks.exec_handler != NULL) {
-						node_rc = n->callbacks.exec_handler(mes,
-										    pnode->handle, node_idx);
-						/* Call error handler if necessary. */
-						if (node_rc) {
-							n->callbacks.error_handler(mes,
-										   pnode->handle, node_idx, node_rc);
-						}
+#endif
+					ctrl |= step_pm_fire(n, n->callbacks.start_handler,
+							     mes, pnode->handle, node_idx,
+							     &errors);
+					ctrl |= step_pm_fire(n, n->callbacks.exec_handler,
+							     mes, pnode->handle, node_idx,
+							     &errors);
+					ctrl |= step_pm_fire(n, n->callbacks.stop_handler,
+							     mes, pnode->handle, node_idx,
+							     &errors);
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+					/* Stage latencies are recorded under the lock. */
+					if (instr_weight &&
+					    (node_idx < CONFIG_STEP_INSTRUMENTATION_STAGES)) {
+						STEP_INSTR_STOP(stage_instr);
+						stage_cyc[node_idx] =
+							step_instr_cyc_32(stage_instr);
 					}
+#endif
 
-					/* Call stop handler if requested. */
-					if (n->callbacks.stop_handler != NULL) {
-						node_rc = n->callbacks.stop_handler(mes,
-										    pnode->handle, node_idx);
-						/* Call error handler if necessary. */
-						if (node_rc) {
-							n->callbacks.error_handler(mes,
-										   pnode->handle, node_idx, node_rc);
-						}
-					}					
 					/* Move to next node in the chain, if present. */
 					node_idx++;
 					n = n->next;
-				} while (n != NULL);
-
-				/* evaluate the subscriptors at end of node processing */
-				struct step_node_sub_callback *subs;
-				struct step_node_sub_callback *subs_tmp;
-				SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&pnode->sub_callbacks,subs,subs_tmp,snode) {
-					if(subs->cb) {
-						subs->cb(mes,pnode->handle,subs->user_data);
+				} while ((n != NULL) && !(ctrl & STEP_NODE_RC_ABORT_CHAIN));
+
+				/* evaluate the subscriptors at end of node processing,
+				 * unless the chain was aborted before completing */
+				if (!(ctrl & STEP_NODE_RC_ABORT_CHAIN)) {
+					struct step_node_sub_callback *subs;
+					struct step_node_sub_callback *subs_tmp;
+#if CONFIG_STEP_LATENCY
+					/* Record the delivery once per chain run, however
+					 * many subscribers it has. */
+					if (!sys_slist_is_empty(&pnode->sub_callbacks)) {
+						step_lat_record_delivery(mes);
+					}
+#endif
+					SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&pnode->sub_callbacks,subs,subs_tmp,snode) {
+						if(subs->cb) {
+							STEP_TRACE_SUB_ENTER(pnode->handle, subs->cb);
+							subs->cb(mes,pnode->handle,subs->user_data);
+							STEP_TRACE_SUB_EXIT(pnode->handle);
+						}
 					}
 				}
 
@@ -254,24 +766,69 @@ static int step_pm_process(struct step_measurement *mes, bool free)
 		/* Lock registry access during processing. */
 		k_mutex_lock(&step_pm_reg_access, K_FOREVER);
 
+			/* Node stats are read under the lock, so update them here
+			 * rather than while the chain ran. */
+			if (match) {
+				pnode->stats.errors += errors;
+				if (ctrl & STEP_NODE_RC_ABORT_CHAIN) {
+					pnode->stats.aborts++;
+				}
+			}
+
 #if CONFIG_STEP_INSTRUMENTATION
-			/* Stop total runtime INSTR timer. */
-			STEP_INSTR_STOP(instr);
-			pnode->runtime_ns += instr;
-			pnode->runs++;
+			/* Stop total runtime INSTR timer, and record the latency of
+			 * chains that ran, in cycles. Each timed run stands for
+			 * 'instr_weight' runs. */
+			if (instr_weight) {
+				STEP_INSTR_STOP(instr);
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+				instr_run += instr;
+				instr_pairs++;
 #endif
+			}
+			if (instr_weight && match) {
+				step_hist_record_n(&pnode->latency,
+						   step_instr_cyc_32(instr),
+						   instr_weight);
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+				for (int i = 0; (i < node_idx) &&
+				     (i < CONFIG_STEP_INSTRUMENTATION_STAGES); i++) {
+					step_hist_record_n(&pnode->stage_latency[i],
+							   stage_cyc[i], instr_weight);
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+					instr_pairs++;
+#endif
+				}
+#endif
+			}
+#endif
+
+			/* Exclusive nodes consume the measurement on a match, and
+			 * any node in a chain can claim it via its return code. */
+			if (match && (pnode->flags.exclusive ||
+				      (ctrl & STEP_NODE_RC_CONSUMED))) {
+				break;
+			}
 		}
 	}
 
-	/* No matches ... warn that sample will be lost. */
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+	if (instr_weight) {
+		step_pm_instr_budget(instr_run, instr_pairs);
+	}
+#endif
+
+	/* No matches ... the sample will be lost. */
 	if (match_count == 0) {
-		LOG_WRN("Measurement lost: no processor node(s) matched");
+		step_pm_lost(mes);
 	}
 
 abort:
+	STEP_TRACE_DEQUEUE_EXIT(mes, match_count);
 
-	/* Free measurement from shared memory if requested. */
-	if (free) {
+	/* Free measurement from shared memory if requested, unless a node has
+	 * taken ownership of it. */
+	if (free && mes->queue.free_after_use) {
 		step_sp_free(mes);
 	}
 
@@ -316,8 +873,19 @@ int step_pm_register(struct step_node *node, uint16_t pri, uint32_t *handle)
 
 	sys_slist_init(&step_pm_nodes[*handle].sub_callbacks);
 
-	/* Find the correct insertion point based on priority. */
+#if CONFIG_STEP_FILTER_BATCH
+	/* Compile the filter chain for batch evaluation. */
+	step_pm_filt_compile(&step_pm_nodes[*handle]);
+#endif
+
+	/* Find the correct insertion point based on priority. Records are
+	 * sorted from highest to lowest priority, so nothing needs to be
+	 * searched if the last record doesn't have a lower priority. */
 	match = prev = NULL;
+	pnode = SYS_SLIST_CONTAINER(sys_slist_peek_tail(&pm_node_slist), pnode, snode);
+	if ((pnode != NULL) && (pnode->priority >= pri)) {
+		goto insert;
+	}
 	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&pm_node_slist, pnode, tmp, snode) {
 		if ((match == NULL) && (pri > pnode->priority)) {
 			match = pnode;
@@ -329,6 +897,7 @@ int step_pm_register(struct step_node *node, uint16_t pri, uint32_t *handle)
 		}
 	}
 
+insert:
 	/* Insert new node record in appropriate position based on priority. */
 	if ((match != NULL) && (prev == NULL)) {
 		/* Prepend before sole record. */
@@ -347,7 +916,7 @@ int step_pm_register(struct step_node *node, uint16_t pri, uint32_t *handle)
 		if (n->callbacks.init_handler != NULL) {
 			/* Use the node's evaluate callback to determine match. */
 			rc = n->callbacks.init_handler(n->config, *handle, idx);
-			if (rc) {
+			if (rc && (n->callbacks.error_handler != NULL)) {
 				n->callbacks.error_handler(NULL, *handle, idx, rc);
 			}
 		}
@@ -362,6 +931,86 @@ err:
 	return rc;
 }
 
+int step_pm_register_static(void)
+{
+	int rc = 0;
+	uint32_t handle;
+	uint32_t count;
+	uint32_t i, j;
+	uint8_t order[CONFIG_STEP_PROC_MGR_NODE_LIMIT];
+	struct step_pm_static_node *snode;
+	struct step_pm_static_node *prev;
+
+	/* Hold the registry lock throughout, so the static nodes are added as
+	 * one set. The lock can be taken again by the calls below. */
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	STRUCT_SECTION_COUNT(step_pm_static_node, &count);
+	if (count > CONFIG_STEP_PROC_MGR_NODE_LIMIT - step_pm_handle_counter) {
+		LOG_ERR("Static registration failed: node limit reached");
+		rc = -ENOMEM;
+		goto err;
+	}
+
+	/* The section is sorted by name, not priority. Sort the entries'
+	 * indices from highest to lowest priority, keeping the name order of
+	 * equal priorities, so each record is appended to the registry. */
+	for (i = 0; i < count; i++) {
+		STRUCT_SECTION_GET(step_pm_static_node, i, &snode);
+		for (j = i; j > 0; j--) {
+			STRUCT_SECTION_GET(step_pm_static_node, order[j - 1], &prev);
+			if (prev->priority >= snode->priority) {
+				break;
+			}
+			order[j] = order[j - 1];
+		}
+		order[j] = (uint8_t)i;
+	}
+
+	for (i = 0; i < count; i++) {
+		STRUCT_SECTION_GET(step_pm_static_node, order[i], &snode);
+		rc = step_pm_register(snode->node, snode->priority, &handle);
+		if (rc) {
+			/* Don't leave a partial set behind, so that this can
+			 * simply be called again. */
+			step_pm_clear();
+			goto err;
+		}
+	}
+
+err:
+	/* Release the registry lock. */
+	k_mutex_unlock(&step_pm_reg_access);
+
+	return rc;
+}
+
+static int step_pm_static_init(void)
+{
+	return step_pm_register_static();
+}
+
+SYS_INIT(step_pm_static_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+int step_pm_handle_get(struct step_node *node, uint32_t *handle)
+{
+	int rc = -ENOENT;
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	for (uint32_t i = 0; i < step_pm_handle_counter; i++) {
+		if (step_pm_nodes[i].node == node) {
+			*handle = i;
+			rc = 0;
+			break;
+		}
+	}
+
+	k_mutex_unlock(&step_pm_reg_access);
+
+	return rc;
+}
+
 struct step_node *step_pm_node_get(uint32_t handle, uint32_t inst)
 {
 	struct step_node *n;
@@ -394,19 +1043,54 @@ struct step_node *step_pm_node_get(uint32_t handle, uint32_t inst)
 
 int step_pm_put(struct step_measurement *mes)
 {
+	atomic_val_t depth;
+	atomic_val_t peak;
+
 	if(!mes) {
 		return -EINVAL;
 	}
 
+#if CONFIG_STEP_SOURCE_STATS
+	/* 'mes' can be processed and freed as soon as it's queued. */
+	uint8_t sourceid = mes->header.srclen.sourceid;
+#endif
+
 	step_pm_initialize_workqueue();
 
+#if CONFIG_STEP_LATENCY
+	step_lat_stamp_put(mes);
+#endif
+	STEP_TRACE_PUT(mes);
+
 	/* attach the handler of this sample */
 	k_work_init(&mes->queue.work, step_pm_poll_handler);
 
+	/* Count the measurement before it's queued, since it can be processed
+	 * before 'k_work_submit_to_queue' returns. */
+	depth = atomic_inc(&step_pm_stats_inst.depth) + 1;
+#if CONFIG_STEP_PROC_MGR_QUEUE_LIMIT
+	/* Shed load rather than exhausting the sample pool when the queue is
+	 * full. The caller keeps ownership of the measurement. */
+	if (depth > CONFIG_STEP_PROC_MGR_QUEUE_LIMIT) {
+		atomic_dec(&step_pm_stats_inst.depth);
+		atomic_inc(&step_pm_stats_inst.rejected);
+#if CONFIG_STEP_SOURCE_STATS
+		step_src_record_overload(sourceid);
+#endif
+		return -ENOBUFS;
+	}
+#endif
+	do {
+		peak = atomic_get(&step_pm_stats_inst.peak);
+	} while ((depth > peak) &&
+		 !atomic_cas(&step_pm_stats_inst.peak, peak, depth));
+
 	/* trigger the processor manager */
 	int rc = k_work_submit_to_queue(&step_pm_work_q, &mes->queue.work);
 
 	if (rc < 0) {
+		atomic_dec(&step_pm_stats_inst.depth);
+		atomic_inc(&step_pm_stats_inst.put_errors);
 		goto err;
 	} else {
 		/* positive values are not an error in wqueues 
@@ -415,10 +1099,123 @@ int step_pm_put(struct step_measurement *mes)
 		rc = 0;
 	}
 
+	atomic_inc(&step_pm_stats_inst.queued);
+#if CONFIG_STEP_SOURCE_STATS
+	step_src_record_put(sourceid);
+#endif
+
 err:
 	return rc;
 }
 
+void step_pm_stats_get(struct step_pm_stats *stats)
+{
+	stats->queued = (uint32_t)atomic_get(&step_pm_stats_inst.queued);
+	stats->processed = step_pm_stats_inst.processed;
+	stats->queue_depth = (uint32_t)atomic_get(&step_pm_stats_inst.depth);
+	stats->queue_peak = (uint32_t)atomic_get(&step_pm_stats_inst.peak);
+	stats->dropped = step_pm_stats_inst.dropped;
+	stats->put_errors = (uint32_t)atomic_get(&step_pm_stats_inst.put_errors);
+	stats->rejected = (uint32_t)atomic_get(&step_pm_stats_inst.rejected);
+	stats->nodes = step_pm_handle_counter;
+}
+
+void step_pm_stats_reset(void)
+{
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	atomic_clear(&step_pm_stats_inst.queued);
+	atomic_set(&step_pm_stats_inst.peak,
+		   atomic_get(&step_pm_stats_inst.depth));
+	atomic_clear(&step_pm_stats_inst.put_errors);
+	atomic_clear(&step_pm_stats_inst.rejected);
+	step_pm_stats_inst.processed = 0;
+	step_pm_stats_inst.dropped = 0;
+
+	for (uint32_t i = 0; i < step_pm_handle_counter; i++) {
+		memset(&step_pm_nodes[i].stats, 0,
+		       sizeof(struct step_pm_node_stats));
+	}
+
+	k_mutex_unlock(&step_pm_reg_access);
+}
+
+int step_pm_node_stats_get(uint32_t handle, struct step_pm_node_stats *stats)
+{
+	step_pm_initialize_workqueue();
+
+	if (handle >= step_pm_handle_counter) {
+		LOG_ERR("Invalid handle: %d", handle);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+	*stats = step_pm_nodes[handle].stats;
+	k_mutex_unlock(&step_pm_reg_access);
+
+	return 0;
+}
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+int step_pm_worker_stats_get(struct step_pm_worker_stats *stats)
+{
+	k_tid_t tid;
+	k_thread_runtime_stats_t worker;
+	size_t unused;
+	uint32_t idx;
+	int rc;
+
+	step_pm_initialize_workqueue();
+
+	tid = k_work_queue_thread_get(&step_pm_work_q);
+	rc = k_thread_stack_space_get(tid, &unused);
+	if (rc) {
+		return rc;
+	}
+	stats->stack_size = tid->stack_info.size;
+	stats->stack_used = stats->stack_size - unused;
+
+	k_thread_runtime_stats_get(tid, &worker);
+	stats->busy_cycles = worker.execution_cycles;
+
+	/* Copy the history, oldest sample first. */
+	k_mutex_lock(&step_pm_monitor_mtx, K_FOREVER);
+	idx = (step_pm_monitor_head + CONFIG_STEP_PROC_MGR_MONITOR_HISTORY -
+	       step_pm_monitor_count) % CONFIG_STEP_PROC_MGR_MONITOR_HISTORY;
+	for (uint32_t i = 0; i < step_pm_monitor_count; i++) {
+		stats->history[i] = step_pm_monitor_hist[idx];
+		idx = (idx + 1) % CONFIG_STEP_PROC_MGR_MONITOR_HISTORY;
+	}
+	stats->samples = step_pm_monitor_count;
+	k_mutex_unlock(&step_pm_monitor_mtx);
+
+	return 0;
+}
+
+void step_pm_worker_print(void)
+{
+	struct step_pm_worker_stats stats;
+	struct step_pm_monitor_sample *s;
+
+	if (step_pm_worker_stats_get(&stats)) {
+		printk("Worker stack usage unavailable\n");
+		return;
+	}
+
+	printk("Worker stack: %u of %u bytes used (high-water mark)\n",
+	       (uint32_t)stats.stack_used, (uint32_t)stats.stack_size);
+	printk("Worker history, oldest first, every %u ms:\n",
+	       CONFIG_STEP_PROC_MGR_MONITOR_INTERVAL_MS);
+	for (uint32_t i = 0; i < stats.samples; i++) {
+		s = &stats.history[i];
+		printk("  worker %u.%u%%, cpu %u.%u%%, queue depth %u, "
+		       "processed %u\n", s->worker_load / 10, s->worker_load % 10,
+		       s->cpu_load / 10, s->cpu_load % 10, s->queue_depth,
+		       s->processed);
+	}
+}
+#endif
+
 int step_pm_clear(void)
 {
 	int rc = 0;
@@ -438,6 +1235,11 @@ int step_pm_clear(void)
 	/* Reset the handle counter. */
 	step_pm_handle_counter = 0;
 
+#if CONFIG_STEP_FILTER_BATCH
+	/* Reset the batch filter evaluation table. */
+	step_pm_filt_count = 0;
+#endif
+
 	/* Free the node record placeholders. */
 	for (uint8_t i = 0; i < CONFIG_STEP_PROC_MGR_NODE_LIMIT; i++) {
 		memset(&step_pm_nodes[i], 0, sizeof(struct step_pm_node_record));
@@ -490,6 +1292,25 @@ err:
 	return rc;
 }
 
+int step_pm_set_exclusive(uint32_t handle, bool exclusive)
+{
+	int rc = 0;
+
+	step_pm_initialize_workqueue();
+
+	LOG_DBG("Setting processor node %d exclusive: %d", handle, exclusive);
+
+	if (handle >= step_pm_handle_counter) {
+		LOG_ERR("Invalid handle: %d", handle);
+		rc = -EINVAL;
+		goto err;
+	}
+	step_pm_nodes[handle].flags.exclusive = exclusive ? 1 : 0;
+
+err:
+	return rc;
+}
+
 int step_pm_subscribe_to_node(uint32_t handle, node_chain_completed_callback cb, void *user_data)
 {
 	int rc = 0;
@@ -528,15 +1349,132 @@ err:
 	return rc;
 }
 
+#if CONFIG_STEP_INSTRUMENTATION
+/**
+ * @brief Summarises a latency histogram, which holds cycles, in ns.
+ */
+static void step_pm_summarise_latency(const struct step_hist *h,
+				      struct step_hist_summary *lat)
+{
+	step_hist_summarise(h, lat);
+	lat->min = (uint32_t)STEP_INSTR_TO_NS(lat->min);
+	lat->max = (uint32_t)STEP_INSTR_TO_NS(lat->max);
+	lat->mean = (uint32_t)STEP_INSTR_TO_NS(lat->mean);
+	lat->p50 = (uint32_t)STEP_INSTR_TO_NS(lat->p50);
+	lat->p99 = (uint32_t)STEP_INSTR_TO_NS(lat->p99);
+	lat->p999 = (uint32_t)STEP_INSTR_TO_NS(lat->p999);
+}
+
+static void step_pm_print_latency(const struct step_hist_summary *lat)
+{
+	printk("    min %u, p50 %u, p99 %u, p99.9 %u, max %u ns\n", lat->min,
+	       lat->p50, lat->p99, lat->p999, lat->max);
+}
+
+int step_pm_node_latency(uint32_t handle, int32_t stage,
+			 struct step_hist_summary *lat)
+{
+	struct step_pm_node_record *r;
+	struct step_hist *h;
+
+	step_pm_initialize_workqueue();
+
+	if (handle >= step_pm_handle_counter) {
+		LOG_ERR("Invalid handle: %d", handle);
+		return -EINVAL;
+	}
+	if ((stage < -1) || (stage >= CONFIG_STEP_INSTRUMENTATION_STAGES)) {
+		return -ENOTSUP;
+	}
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	r = &step_pm_nodes[handle];
+	h = &r->latency;
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+	if (stage >= 0) {
+		h = &r->stage_latency[stage];
+	}
+#endif
+	step_pm_summarise_latency(h, lat);
+
+	k_mutex_unlock(&step_pm_reg_access);
+	return 0;
+}
+
+int step_pm_node_latency_reset(uint32_t handle)
+{
+	struct step_pm_node_record *r;
+
+	step_pm_initialize_workqueue();
+
+	if (handle >= step_pm_handle_counter) {
+		LOG_ERR("Invalid handle: %d", handle);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	r = &step_pm_nodes[handle];
+	step_hist_reset(&r->latency);
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+	for (int i = 0; i < CONFIG_STEP_INSTRUMENTATION_STAGES; i++) {
+		step_hist_reset(&r->stage_latency[i]);
+	}
+#endif
+
+	k_mutex_unlock(&step_pm_reg_access);
+	return 0;
+}
+
+int step_pm_instr_rate_set(uint32_t rate)
+{
+	if ((rate == 0) || (rate > 65535)) {
+		LOG_ERR("Invalid sample rate: %u", rate);
+		return -EINVAL;
+	}
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+
+	step_pm_instr_rate = rate;
+#if !CONFIG_STEP_INSTRUMENTATION_SAMPLE_RANDOM
+	step_pm_instr_skipped = 0;
+#endif
+
+	k_mutex_unlock(&step_pm_reg_access);
+	return 0;
+}
+
+uint32_t step_pm_instr_rate_get(void)
+{
+	uint32_t rate;
+
+	k_mutex_lock(&step_pm_reg_access, K_FOREVER);
+	rate = step_pm_instr_rate;
+	k_mutex_unlock(&step_pm_reg_access);
+
+	return rate;
+}
+#endif
+
 int step_pm_list(void)
 {
 	struct step_pm_node_record *pnode;
 	struct step_pm_node_record *tmp;
 	uint32_t inst;
+#if CONFIG_STEP_INSTRUMENTATION
+	struct step_hist_summary lat;
+#endif
 
 	step_pm_initialize_workqueue();
 
 	printk("Processor node registry:\n");
+#if CONFIG_STEP_INSTRUMENTATION
+	if (step_pm_instr_rate > 1) {
+		printk("  (latencies estimated from 1 in %u measurements)\n",
+		       step_pm_instr_rate);
+	}
+#endif
 
 	if (sys_slist_is_empty(&pm_node_slist)) {
 		printk("  empty\n");
@@ -545,20 +1483,32 @@ int step_pm_list(void)
 
 	/* Cycle through registered nodes. */
 	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&pm_node_slist, pnode, tmp, snode) {
-		printk("%d (priority %d):\n", pnode->handle, pnode->priority);
+		printk("%d (priority %d%s):\n", pnode->handle, pnode->priority,
+		       pnode->flags.exclusive ? ", exclusive" : "");
+#if CONFIG_STEP_PROC_MGR_REORDER
+		printk("  Matched: %d of %d evaluations (decayed)\n",
+		       pnode->matches, pnode->evals);
+#endif
 #if CONFIG_STEP_INSTRUMENTATION
-		/* Note: This value is strictly limited to node evaluation inside the
-		 * 'step_pm_process' function, and doesn't take into account the
-		 * additional processing overhead in the larger pipeline. */
-		printk("  Total processing time: %d ns (%d avg, %d runs)\n",
-		       pnode->runtime_ns,
-		       pnode->runtime_ns / pnode->runs, pnode->runs);
+		/* Note: These values are strictly limited to node evaluation inside
+		 * the 'step_pm_process' function. Queueing and pipeline overhead are
+		 * tracked per source ID with CONFIG_STEP_LATENCY. */
+		step_pm_summarise_latency(&pnode->latency, &lat);
+		printk("  Latency: %u runs, mean %u ns\n", lat.count, lat.mean);
+		step_pm_print_latency(&lat);
 #endif
 		/* Print individual nodes. */
 		struct step_node *n = pnode->node;
 		inst = 0;
 		do {
 			printk("  [%d] %s\n", inst, n->name);
+#if CONFIG_STEP_INSTRUMENTATION_STAGES
+			if (inst < CONFIG_STEP_INSTRUMENTATION_STAGES) {
+				step_pm_summarise_latency(&pnode->stage_latency[inst],
+							  &lat);
+				step_pm_print_latency(&lat);
+			}
+#endif
 			inst++;
 			n = n->next;
 		} while (n != NULL);
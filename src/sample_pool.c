@@ -6,6 +6,10 @@
 
 #include <step/sample_pool.h>
 #include <step/measurement/measurement.h>
+#include <step/tracing.h>
+#if CONFIG_STEP_LATENCY
+#include <step/latency.h>
+#endif
 
 #define LOG_LEVEL LOG_LEVEL_DBG
 LOG_MODULE_REGISTER(sample_pool);
@@ -13,17 +17,6 @@ LOG_MODULE_REGISTER(sample_pool);
 K_HEAP_DEFINE(step_elem_pool, CONFIG_STEP_POOL_SIZE);
 K_MUTEX_DEFINE(step_sp_alloc_mtx);
 
-/**
- * @brief Sample pool statistics
- */
-struct step_sp_stats {
-	int32_t bytes_alloc;
-	uint32_t bytes_alloc_total;
-	uint32_t pool_free_calls;
-	uint32_t bytes_freed_total;
-	uint32_t pool_alloc_calls;
-};
-
 /* Track the number of bytes currently allocated, etc. */
 static struct step_sp_stats step_sp_stats_inst = { 0 };
 
@@ -31,6 +24,7 @@ void step_sp_free(struct step_measurement *mes)
 {
 	int len;
 
+	STEP_TRACE_SP_FREE(mes);
 	step_sp_stats_inst.pool_free_calls++;
 
 	k_mutex_lock(&step_sp_alloc_mtx, K_FOREVER);
@@ -39,9 +33,8 @@ void step_sp_free(struct step_measurement *mes)
 	 * Note that Zephyr's heap stores records in blocks of 8 bytes memory, so
 	 * there is some additional overhead when a record isn't an exact multiple
 	 * of 8 bytes long. */
-	len = mes->header.srclen.len + sizeof(struct step_measurement) +
-	      (8 - ((mes->header.srclen.len +
-		     sizeof(struct step_measurement)) % 8));
+	len = mes->capacity + sizeof(struct step_measurement) +
+	      (8 - ((mes->capacity + sizeof(struct step_measurement)) % 8));
 	step_sp_stats_inst.bytes_alloc -= len;
 	step_sp_stats_inst.bytes_freed_total += len;
 
@@ -67,6 +60,8 @@ struct step_measurement *step_sp_alloc(uint16_t sz)
 	/* Make sure memory is available. */
 	if (mes == NULL) {
 		LOG_ERR("memory allocation failed!");
+		step_sp_stats_inst.alloc_failures++;
+		k_mutex_unlock(&step_sp_alloc_mtx);
 		return NULL;
 	}
 
@@ -78,20 +73,29 @@ struct step_measurement *step_sp_alloc(uint16_t sz)
 	      (8 - ((sz + sizeof(struct step_measurement)) % 8));
 	step_sp_stats_inst.bytes_alloc += len;
 	step_sp_stats_inst.bytes_alloc_total += len;
+	if (step_sp_stats_inst.bytes_alloc > step_sp_stats_inst.bytes_alloc_peak) {
+		step_sp_stats_inst.bytes_alloc_peak = step_sp_stats_inst.bytes_alloc;
+	}
 
 	/* Put the allocated struct in default state, and setup payload pointer. */
-	memset(mes, 0, sizeof(struct step_mes_header));
+	memset(mes, 0, sizeof(struct step_measurement));
 	mes->header.srclen.len = sz;
+	mes->capacity = sz;
 	mes->payload = NULL;
 	if (sz) {
 		/* Payload starts just after the sample struct. */
-		mes->payload = mes + sizeof(struct step_measurement);
+		mes->payload = (uint8_t *)mes + sizeof(struct step_measurement);
 		memset(mes->payload, 0, sz);
 	}
 
 	/* measurement allocated from sample pool should be always freed automatically*/
 	mes->queue.free_after_use = true;
 
+#if CONFIG_STEP_LATENCY
+	step_lat_stamp_alloc(mes);
+#endif
+	STEP_TRACE_SP_ALLOC(mes, sz);
+
 	k_mutex_unlock(&step_sp_alloc_mtx);
 
 	return mes;
@@ -102,11 +106,44 @@ int32_t step_sp_bytes_alloc(void)
 	return step_sp_stats_inst.bytes_alloc;
 }
 
+int32_t step_sp_bytes_alloc_peak(void)
+{
+	return step_sp_stats_inst.bytes_alloc_peak;
+}
+
+void step_sp_reset_peak(void)
+{
+	k_mutex_lock(&step_sp_alloc_mtx, K_FOREVER);
+	step_sp_stats_inst.bytes_alloc_peak = step_sp_stats_inst.bytes_alloc;
+	k_mutex_unlock(&step_sp_alloc_mtx);
+}
+
+void step_sp_stats_get(struct step_sp_stats *stats)
+{
+	k_mutex_lock(&step_sp_alloc_mtx, K_FOREVER);
+	*stats = step_sp_stats_inst;
+	k_mutex_unlock(&step_sp_alloc_mtx);
+}
+
+void step_sp_stats_reset(void)
+{
+	k_mutex_lock(&step_sp_alloc_mtx, K_FOREVER);
+	step_sp_stats_inst.bytes_alloc_peak = step_sp_stats_inst.bytes_alloc;
+	step_sp_stats_inst.bytes_alloc_total = 0;
+	step_sp_stats_inst.bytes_freed_total = 0;
+	step_sp_stats_inst.pool_alloc_calls = 0;
+	step_sp_stats_inst.pool_free_calls = 0;
+	step_sp_stats_inst.alloc_failures = 0;
+	k_mutex_unlock(&step_sp_alloc_mtx);
+}
+
 void step_sp_print_stats(void)
 {
 	printk("bytes_alloc (cur): %d\n", step_sp_stats_inst.bytes_alloc);
+	printk("bytes_alloc_peak:  %d\n", step_sp_stats_inst.bytes_alloc_peak);
 	printk("bytes_alloc_total: %d\n", step_sp_stats_inst.bytes_alloc_total);
 	printk("bytes_freed_total: %d\n", step_sp_stats_inst.bytes_freed_total);
 	printk("pool_free_calls:   %d\n", step_sp_stats_inst.pool_free_calls);
 	printk("pool_alloc_calls:  %d\n", step_sp_stats_inst.pool_alloc_calls);
+	printk("alloc_failures:    %d\n", step_sp_stats_inst.alloc_failures);
 }
@@ -0,0 +1,283 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdlib.h>
+#include <zephyr/kernel.h>
+#include <zephyr/shell/shell.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+#include <step/cache.h>
+#if CONFIG_STEP_SOURCE_STATS
+#include <step/source_stats.h>
+#endif
+
+/* Default 'top' refresh interval and number of refreshes. */
+#define STEP_SHELL_TOP_INTERVAL_MS      1000
+#define STEP_SHELL_TOP_COUNT            10
+
+/* Node match counts at the previous 'top' refresh. */
+static uint32_t step_shell_top_matches[CONFIG_STEP_PROC_MGR_NODE_LIMIT];
+
+/**
+ * @brief Returns the name of the first node in a registered node chain.
+ */
+static const char *step_shell_node_name(uint32_t handle)
+{
+	struct step_node *n = step_pm_node_get(handle, 0);
+
+	return ((n != NULL) && (n->name != NULL)) ? n->name : "";
+}
+
+/**
+ * @brief Converts the change in a counter over 'interval' ms to a rate per
+ *        second. Counters that were reset in the meantime restart from 0.
+ */
+static uint32_t step_shell_rate(uint32_t cur, uint32_t prev, uint32_t interval)
+{
+	uint32_t delta = (cur >= prev) ? (cur - prev) : cur;
+
+	return (uint32_t)(((uint64_t)delta * 1000) / interval);
+}
+
+static void step_shell_print_nodes(const struct shell *shell, uint32_t count)
+{
+	struct step_pm_node_stats ns;
+
+	shell_print(shell, "Nodes:");
+	shell_print(shell, "  %6s %10s %10s %8s %8s  %s", "handle", "evals",
+		    "matches", "aborts", "errors", "name");
+	for (uint32_t i = 0; i < count; i++) {
+		if (step_pm_node_stats_get(i, &ns)) {
+			continue;
+		}
+		shell_print(shell, "  %6u %10u %10u %8u %8u  %s", i, ns.evals,
+			    ns.matches, ns.aborts, ns.errors,
+			    step_shell_node_name(i));
+	}
+}
+
+#if CONFIG_STEP_SOURCE_STATS
+static void step_shell_print_sources(const struct shell *shell)
+{
+	struct step_src_stats ss;
+
+	shell_print(shell, "Sources:");
+	shell_print(shell, "  %6s %10s %10s %10s %8s %8s %8s %8s", "source",
+		    "published", "processed", "unmatched", "alloc", "overload",
+		    "rate/s", "drops/s");
+	for (uint32_t i = 0; i < CONFIG_STEP_SOURCE_STATS_SOURCES; i++) {
+		step_src_stats_get(i, &ss);
+		if ((ss.published == 0) && (ss.dropped_alloc == 0) &&
+		    (ss.dropped_overload == 0)) {
+			continue;
+		}
+		shell_print(shell, "  %5u%s %10u %10u %10u %8u %8u %8u %8u", i,
+			    (i == CONFIG_STEP_SOURCE_STATS_SOURCES - 1) ? "+" : " ",
+			    ss.published, ss.processed, ss.unmatched,
+			    ss.dropped_alloc, ss.dropped_overload, ss.rate,
+			    ss.drop_rate);
+	}
+}
+#endif
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+static void step_shell_print_worker(const struct shell *shell)
+{
+	struct step_pm_worker_stats ws;
+	struct step_pm_monitor_sample *s;
+
+	if (step_pm_worker_stats_get(&ws)) {
+		return;
+	}
+
+	shell_print(shell, "Worker:");
+	shell_print(shell, "  stack %u of %u bytes used", (uint32_t)ws.stack_used,
+		    (uint32_t)ws.stack_size);
+	if (ws.samples) {
+		s = &ws.history[ws.samples - 1];
+		shell_print(shell, "  load %u.%u%%, cpu %u.%u%% over the last %u ms",
+			    s->worker_load / 10, s->worker_load % 10,
+			    s->cpu_load / 10, s->cpu_load % 10,
+			    CONFIG_STEP_PROC_MGR_MONITOR_INTERVAL_MS);
+	}
+}
+#endif
+
+static int
+step_shell_cmd_stats(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	struct step_pm_stats pm;
+	struct step_sp_stats sp;
+#if CONFIG_STEP_FILTER_CACHE
+	struct step_cache_stats cs;
+#endif
+
+	step_pm_stats_get(&pm);
+	step_sp_stats_get(&sp);
+
+	shell_print(shell, "Processor manager:");
+	shell_print(shell, "  queued %u, processed %u, dropped %u, rejected %u, "
+		    "put errors %u", pm.queued, pm.processed, pm.dropped,
+		    pm.rejected, pm.put_errors);
+	shell_print(shell, "  queue depth %u (peak %u), %u node chains",
+		    pm.queue_depth, pm.queue_peak, pm.nodes);
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+	step_shell_print_worker(shell);
+#endif
+
+	shell_print(shell, "Sample pool:");
+	shell_print(shell, "  %d bytes allocated (peak %d) of %d",
+		    sp.bytes_alloc, sp.bytes_alloc_peak, CONFIG_STEP_POOL_SIZE);
+	shell_print(shell, "  %u allocs, %u frees, %u failed allocs",
+		    sp.pool_alloc_calls, sp.pool_free_calls, sp.alloc_failures);
+
+#if CONFIG_STEP_FILTER_CACHE
+	step_cache_stats_get(&cs);
+	shell_print(shell, "Filter cache:");
+	shell_print(shell, "  %u checks, %u matches, %u adds, %u removals, depth %u",
+		    cs.check_calls, cs.matches, cs.add_calls, cs.removals,
+		    step_cache_depth_get());
+#endif
+
+	step_shell_print_nodes(shell, pm.nodes);
+#if CONFIG_STEP_SOURCE_STATS
+	step_shell_print_sources(shell);
+#endif
+
+	return 0;
+}
+
+static int
+step_shell_cmd_reset(const struct shell *shell, size_t argc, char **argv)
+{
+	ARG_UNUSED(argc);
+	ARG_UNUSED(argv);
+
+	step_pm_stats_reset();
+	step_sp_stats_reset();
+#if CONFIG_STEP_FILTER_CACHE
+	step_cache_stats_reset();
+#endif
+#if CONFIG_STEP_SOURCE_STATS
+	step_src_stats_reset();
+#endif
+
+	shell_print(shell, "Statistics cleared");
+
+	return 0;
+}
+
+static int
+step_shell_cmd_top(const struct shell *shell, size_t argc, char **argv)
+{
+	uint32_t interval = STEP_SHELL_TOP_INTERVAL_MS;
+	uint32_t count = STEP_SHELL_TOP_COUNT;
+	struct step_pm_stats prev;
+	struct step_pm_stats pm;
+	struct step_pm_node_stats ns;
+	struct step_sp_stats sp;
+
+	if (argc > 1) {
+		interval = strtoul(argv[1], NULL, 10);
+	}
+	if (argc > 2) {
+		count = strtoul(argv[2], NULL, 10);
+	}
+	if (interval == 0) {
+		shell_error(shell, "Invalid interval: %s", argv[1]);
+		return -EINVAL;
+	}
+
+	step_pm_stats_get(&prev);
+	for (uint32_t i = 0; i < prev.nodes; i++) {
+		step_shell_top_matches[i] = 0;
+		if (step_pm_node_stats_get(i, &ns) == 0) {
+			step_shell_top_matches[i] = ns.matches;
+		}
+	}
+
+	for (uint32_t r = 0; r < count; r++) {
+		k_msleep(interval);
+
+		step_pm_stats_get(&pm);
+		step_sp_stats_get(&sp);
+
+		/* Rates are per second, from the deltas since the last refresh. */
+		shell_print(shell, "queued %u/s, processed %u/s, dropped %u/s, "
+			    "depth %u (peak %u), pool %d bytes (peak %d)",
+			    step_shell_rate(pm.queued, prev.queued, interval),
+			    step_shell_rate(pm.processed, prev.processed, interval),
+			    step_shell_rate(pm.dropped, prev.dropped, interval),
+			    pm.queue_depth, pm.queue_peak, sp.bytes_alloc,
+			    sp.bytes_alloc_peak);
+
+		for (uint32_t i = 0; i < pm.nodes; i++) {
+			if (step_pm_node_stats_get(i, &ns)) {
+				continue;
+			}
+			/* Chains registered since the last refresh start at 0. */
+			if (i >= prev.nodes) {
+				step_shell_top_matches[i] = 0;
+			}
+			shell_print(shell, "  %3u %10u matches/s  %s", i,
+				    step_shell_rate(ns.matches,
+						    step_shell_top_matches[i], interval),
+				    step_shell_node_name(i));
+			step_shell_top_matches[i] = ns.matches;
+		}
+
+		prev = pm;
+	}
+
+	return 0;
+}
+
+#if CONFIG_STEP_INSTRUMENTATION
+static int
+step_shell_cmd_instr(const struct shell *shell, size_t argc, char **argv)
+{
+	if (argc > 1) {
+		if (step_pm_instr_rate_set(strtoul(argv[1], NULL, 10))) {
+			shell_error(shell, "Invalid sample rate: %s", argv[1]);
+			return -EINVAL;
+		}
+	}
+
+	shell_print(shell, "Timing 1 in %u measurements",
+		    step_pm_instr_rate_get());
+
+	return 0;
+}
+#endif
+
+/* Root command "step" (level 0), which applications can extend with
+ * SHELL_SUBCMD_ADD((step), ...). */
+SHELL_SUBCMD_SET_CREATE(step_shell_cmds, (step));
+SHELL_CMD_REGISTER(step, &step_shell_cmds, "Secure telemetry pipeline commands",
+		   NULL);
+
+/* 'stats' command handler. */
+SHELL_SUBCMD_ADD((step), stats, NULL, "Display pipeline statistics",
+		 step_shell_cmd_stats, 1, 0);
+/* 'reset' command handler. */
+SHELL_SUBCMD_ADD((step), reset, NULL, "Clear pipeline statistics",
+		 step_shell_cmd_reset, 1, 0);
+/* 'top' command handler. */
+SHELL_SUBCMD_ADD((step), top, NULL,
+		 "Display rates periodically\n"
+		 "Usage: top [interval_ms] [count]",
+		 step_shell_cmd_top, 1, 2);
+#if CONFIG_STEP_INSTRUMENTATION
+/* 'instr' command handler. */
+SHELL_SUBCMD_ADD((step), instr, NULL,
+		 "Display or set the instrumentation sample rate\n"
+		 "Usage: instr [rate]",
+		 step_shell_cmd_instr, 1, 1);
+#endif
@@ -0,0 +1,239 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <step/source_stats.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(source_stats);
+
+/* Fractional bits of the fixed-point rate estimates. */
+#define STEP_SRC_RATE_FRAC_BITS         8
+
+/* Idle windows to fold into a rate estimate at most, after which it has
+ * decayed to 0 with any practical smoothing factor. */
+#define STEP_SRC_MAX_FOLDS              32
+
+/**
+ * @brief Counters and rate estimation state of a source ID slot.
+ */
+struct step_src_slot {
+	/** Counters, excluding the rate estimates. */
+	struct step_src_stats c;
+	/** Start of the current rate window, in ms. */
+	uint32_t win_start;
+	/** Measurements published in the current rate window. */
+	uint32_t win_published;
+	/** Measurements lost in the current rate window. */
+	uint32_t win_dropped;
+	/** Publish rate estimate, in fixed-point measurements per second. */
+	uint32_t rate;
+	/** Drop rate estimate, in fixed-point measurements per second. */
+	uint32_t drop_rate;
+	/** Measurements lost since the last warning. */
+	uint32_t warn_dropped;
+	/** Set once the first rate window has started. */
+	bool started;
+};
+
+/* Records can come from any thread or ISR that calls 'step_pm_put'. */
+static struct k_spinlock step_src_lock;
+
+static struct step_src_slot step_src_slots[CONFIG_STEP_SOURCE_STATS_SOURCES];
+
+/* Time of the last warning. Starts a full interval in the past so that the
+ * first lost measurement is reported straight away. */
+static uint32_t step_src_warn_last = -CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS;
+
+static inline struct step_src_slot *step_src_slot_get(uint8_t sourceid)
+{
+	if (sourceid >= CONFIG_STEP_SOURCE_STATS_SOURCES - 1) {
+		sourceid = CONFIG_STEP_SOURCE_STATS_SOURCES - 1;
+	}
+
+	return &step_src_slots[sourceid];
+}
+
+static inline uint32_t step_src_ewma(uint32_t avg, uint32_t sample)
+{
+	return avg - (avg >> CONFIG_STEP_SOURCE_STATS_EWMA_SHIFT) +
+	       (sample >> CONFIG_STEP_SOURCE_STATS_EWMA_SHIFT);
+}
+
+/**
+ * @brief Folds the counts of every rate window that ended before 'now' into
+ *        the slot's rate estimates. When several windows ended, each is
+ *        folded in at the average rate since the last fold. The lock must be
+ *        held.
+ */
+static void step_src_fold(struct step_src_slot *s, uint32_t now)
+{
+	uint32_t elapsed = now - s->win_start;
+	uint32_t windows = elapsed / CONFIG_STEP_SOURCE_STATS_WINDOW_MS;
+	uint32_t rate;
+	uint32_t drop_rate;
+
+	if (!s->started) {
+		s->started = true;
+		s->win_start = now;
+		return;
+	}
+
+	if (windows == 0) {
+		return;
+	}
+
+	rate = (uint32_t)((((uint64_t)s->win_published * 1000) <<
+			   STEP_SRC_RATE_FRAC_BITS) / elapsed);
+	drop_rate = (uint32_t)((((uint64_t)s->win_dropped * 1000) <<
+				STEP_SRC_RATE_FRAC_BITS) / elapsed);
+	if (windows > STEP_SRC_MAX_FOLDS) {
+		windows = STEP_SRC_MAX_FOLDS;
+	}
+	for (uint32_t i = 0; i < windows; i++) {
+		s->rate = step_src_ewma(s->rate, rate);
+		s->drop_rate = step_src_ewma(s->drop_rate, drop_rate);
+	}
+
+	s->win_start = now;
+	s->win_published = 0;
+	s->win_dropped = 0;
+}
+
+/**
+ * @brief Counts a lost measurement against a slot, and logs an aggregate
+ *        warning if none was logged in the last warning interval.
+ */
+static void step_src_record_drop(struct step_src_slot *s, uint32_t *counter)
+{
+	k_spinlock_key_t key = k_spin_lock(&step_src_lock);
+	uint32_t now = k_uptime_get_32();
+	uint32_t total = 0;
+	uint32_t worst = 0;
+	uint32_t worst_count = 0;
+
+	step_src_fold(s, now);
+	(*counter)++;
+	s->win_dropped++;
+	s->warn_dropped++;
+
+	if (now - step_src_warn_last < CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS) {
+		k_spin_unlock(&step_src_lock, key);
+		return;
+	}
+
+	/* Find the source that lost the most measurements since the last
+	 * warning. */
+	for (uint32_t i = 0; i < CONFIG_STEP_SOURCE_STATS_SOURCES; i++) {
+		total += step_src_slots[i].warn_dropped;
+		if (step_src_slots[i].warn_dropped > worst_count) {
+			worst = i;
+			worst_count = step_src_slots[i].warn_dropped;
+		}
+		step_src_slots[i].warn_dropped = 0;
+	}
+	step_src_warn_last = now;
+
+	k_spin_unlock(&step_src_lock, key);
+
+	LOG_WRN("%u measurement(s) lost since the last warning, %u from "
+		"source %u%s", total, worst_count, worst,
+		(worst == CONFIG_STEP_SOURCE_STATS_SOURCES - 1) ? "+" : "");
+}
+
+void step_src_record_put(uint8_t sourceid)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+	k_spinlock_key_t key = k_spin_lock(&step_src_lock);
+
+	step_src_fold(s, k_uptime_get_32());
+	s->c.published++;
+	s->win_published++;
+
+	k_spin_unlock(&step_src_lock, key);
+}
+
+void step_src_record_processed(uint8_t sourceid)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+	k_spinlock_key_t key = k_spin_lock(&step_src_lock);
+
+	s->c.processed++;
+
+	k_spin_unlock(&step_src_lock, key);
+}
+
+void step_src_record_unmatched(uint8_t sourceid)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+
+	step_src_record_drop(s, &s->c.unmatched);
+}
+
+void step_src_record_overload(uint8_t sourceid)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+
+	step_src_record_drop(s, &s->c.dropped_overload);
+}
+
+void step_src_report_alloc_drop(uint8_t sourceid)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+
+	step_src_record_drop(s, &s->c.dropped_alloc);
+}
+
+void step_src_stats_get(uint8_t sourceid, struct step_src_stats *stats)
+{
+	struct step_src_slot *s = step_src_slot_get(sourceid);
+	k_spinlock_key_t key = k_spin_lock(&step_src_lock);
+
+	/* Let the estimates of idle sources decay. */
+	if (s->started) {
+		step_src_fold(s, k_uptime_get_32());
+	}
+	*stats = s->c;
+	stats->rate = s->rate >> STEP_SRC_RATE_FRAC_BITS;
+	stats->drop_rate = s->drop_rate >> STEP_SRC_RATE_FRAC_BITS;
+
+	k_spin_unlock(&step_src_lock, key);
+}
+
+void step_src_stats_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&step_src_lock);
+
+	memset(step_src_slots, 0, sizeof(step_src_slots));
+	step_src_warn_last = k_uptime_get_32() -
+			     CONFIG_STEP_PROC_MGR_WARN_INTERVAL_MS;
+
+	k_spin_unlock(&step_src_lock, key);
+}
+
+void step_src_stats_print(void)
+{
+	struct step_src_stats s;
+
+	for (uint32_t i = 0; i < CONFIG_STEP_SOURCE_STATS_SOURCES; i++) {
+		step_src_stats_get(i, &s);
+		if ((s.published == 0) && (s.dropped_alloc == 0) &&
+		    (s.dropped_overload == 0)) {
+			continue;
+		}
+
+		if (i < CONFIG_STEP_SOURCE_STATS_SOURCES - 1) {
+			printk("Source %u:\n", i);
+		} else {
+			printk("Source %u+:\n", i);
+		}
+		printk("  published %u, processed %u, unmatched %u, "
+		       "alloc drops %u, overload drops %u\n", s.published,
+		       s.processed, s.unmatched, s.dropped_alloc,
+		       s.dropped_overload);
+		printk("  rate %u/s, drop rate %u/s\n", s.rate, s.drop_rate);
+	}
+}
@@ -0,0 +1,570 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/tsc.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+
+#define LOG_LEVEL LOG_LEVEL_DBG
+LOG_MODULE_REGISTER(tsc);
+
+/* Size of the original payload length prefix. */
+#define STEP_TSC_HDR_SZ         (2)
+/* Size of the arbitrary sample count word. */
+#define STEP_TSC_COUNT_SZ       (4)
+/* Largest number of vector components. */
+#define STEP_TSC_MAX_COMP       (4)
+
+/**
+ * @brief Per-source codec state, identical for the encoder and decoder after
+ *        processing the same measurement.
+ */
+struct step_tsc_state {
+	/** The source ID this state belongs to. */
+	uint8_t sourceid;
+	/** Set when this slot is in use. */
+	bool used;
+	/** Set once a measurement has been encoded from this state. */
+	bool primed;
+	/** Last time this slot was used, to replace the least recently used. */
+	uint32_t last_used;
+	/** Previous timestamp. */
+	uint64_t ts;
+	/** Previous delta between timestamps. */
+	uint64_t delta;
+	/** Previous value of each vector component. */
+	uint32_t prev[STEP_TSC_MAX_COMP];
+	/** Leading zeros of the current XOR window, per component. */
+	uint8_t lead[STEP_TSC_MAX_COMP];
+	/** Length of the current XOR window, per component. 0 if unset. */
+	uint8_t len[STEP_TSC_MAX_COMP];
+};
+
+/**
+ * @brief MSB-first bitstream cursor.
+ */
+struct step_tsc_bits {
+	uint8_t *buf;
+	/** Size of 'buf' in bytes. */
+	uint32_t len;
+	/** Current position in bits. */
+	uint32_t pos;
+};
+
+/* Serialises access to the node state below. */
+K_MUTEX_DEFINE(step_tsc_node_mtx);
+
+static uint8_t step_tsc_scratch[CONFIG_STEP_NODE_TSC_MAX_PAYLOAD];
+
+static struct step_tsc_state step_tsc_enc_state[CONFIG_STEP_NODE_TSC_SOURCES];
+static struct step_tsc_state step_tsc_dec_state[CONFIG_STEP_NODE_TSC_SOURCES];
+static uint32_t step_tsc_state_clock;
+
+/**
+ * @brief Writes the lower 'n' bits of 'val' to the bitstream, which must be
+ *        zeroed beforehand.
+ */
+static int step_tsc_put(struct step_tsc_bits *b, uint64_t val, uint32_t n)
+{
+	uint32_t space;
+	uint32_t take;
+
+	if (n > b->len * 8 - b->pos) {
+		return -ENOSPC;
+	}
+
+	while (n) {
+		space = 8 - (b->pos & 7);
+		take = MIN(space, n);
+		b->buf[b->pos >> 3] |= ((uint32_t)(val >> (n - take)) &
+					((1U << take) - 1)) << (space - take);
+		b->pos += take;
+		n -= take;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Reads 'n' bits from the bitstream into 'val'.
+ */
+static int step_tsc_get(struct step_tsc_bits *b, uint32_t n, uint64_t *val)
+{
+	uint32_t space;
+	uint32_t take;
+	uint64_t v = 0;
+
+	if (n > b->len * 8 - b->pos) {
+		return -EINVAL;
+	}
+
+	while (n) {
+		space = 8 - (b->pos & 7);
+		take = MIN(space, n);
+		v = (v << take) | ((b->buf[b->pos >> 3] >> (space - take)) &
+				   ((1U << take) - 1));
+		b->pos += take;
+		n -= take;
+	}
+
+	*val = v;
+
+	return 0;
+}
+
+/**
+ * @brief Reads a signed 'n'-bit value from the bitstream.
+ */
+static int step_tsc_get_signed(struct step_tsc_bits *b, uint32_t n,
+			       int64_t *val)
+{
+	int rc;
+	uint64_t v;
+
+	rc = step_tsc_get(b, n, &v);
+	if (rc == 0) {
+		*val = (int64_t)(v << (64 - n)) >> (64 - n);
+	}
+
+	return rc;
+}
+
+/**
+ * @brief Encodes a timestamp as the delta of the delta from the previous one:
+ *        '0' if unchanged, otherwise '10', '110', '1110' or '1111' followed by
+ *        a 7, 9, 12 or 64-bit signed value.
+ */
+static int step_tsc_put_ts(struct step_tsc_bits *b, struct step_tsc_state *st,
+			   uint64_t ts)
+{
+	int rc;
+	uint64_t delta = ts - st->ts;
+	int64_t dod = (int64_t)(delta - st->delta);
+
+	if (dod == 0) {
+		rc = step_tsc_put(b, 0x0, 1);
+	} else if ((dod >= -64) && (dod < 64)) {
+		rc = step_tsc_put(b, 0x2, 2) || step_tsc_put(b, dod, 7);
+	} else if ((dod >= -256) && (dod < 256)) {
+		rc = step_tsc_put(b, 0x6, 3) || step_tsc_put(b, dod, 9);
+	} else if ((dod >= -2048) && (dod < 2048)) {
+		rc = step_tsc_put(b, 0xE, 4) || step_tsc_put(b, dod, 12);
+	} else {
+		rc = step_tsc_put(b, 0xF, 4) || step_tsc_put(b, dod, 64);
+	}
+
+	st->ts = ts;
+	st->delta = delta;
+
+	return rc ? -ENOSPC : 0;
+}
+
+static int step_tsc_get_ts(struct step_tsc_bits *b, struct step_tsc_state *st,
+			   uint64_t *ts)
+{
+	static const uint8_t dod_bits[] = { 0, 7, 9, 12, 64 };
+	uint32_t ones = 0;
+	uint64_t bit;
+	int64_t dod = 0;
+
+	/* Count the prefix bits, up to 4. */
+	do {
+		if (step_tsc_get(b, 1, &bit)) {
+			return -EINVAL;
+		}
+		ones += bit;
+	} while (bit && (ones < 4));
+
+	if (ones && step_tsc_get_signed(b, dod_bits[ones], &dod)) {
+		return -EINVAL;
+	}
+
+	st->delta += (uint64_t)dod;
+	st->ts += st->delta;
+	*ts = st->ts;
+
+	return 0;
+}
+
+/**
+ * @brief Encodes a value XORed with the previous value of its component:
+ *        '0' if unchanged, '10' followed by the meaningful bits if they fit in
+ *        the previous window, or '11' followed by the 5-bit leading zero
+ *        count, 5-bit length - 1 and meaningful bits otherwise.
+ */
+static int step_tsc_put_val(struct step_tsc_bits *b, struct step_tsc_state *st,
+			    uint32_t c, uint32_t val)
+{
+	int rc;
+	uint32_t x = val ^ st->prev[c];
+	uint32_t lead;
+	uint32_t trail;
+
+	st->prev[c] = val;
+
+	if (x == 0) {
+		return step_tsc_put(b, 0x0, 1);
+	}
+
+	lead = __builtin_clz(x);
+	trail = __builtin_ctz(x);
+
+	if (st->len[c] && (lead >= st->lead[c]) &&
+	    (trail >= 32U - st->lead[c] - st->len[c])) {
+		rc = step_tsc_put(b, 0x2, 2) ||
+		     step_tsc_put(b, x >> (32 - st->lead[c] - st->len[c]),
+				  st->len[c]);
+	} else {
+		st->lead[c] = lead;
+		st->len[c] = 32 - lead - trail;
+		rc = step_tsc_put(b, 0x3, 2) ||
+		     step_tsc_put(b, lead, 5) ||
+		     step_tsc_put(b, st->len[c] - 1, 5) ||
+		     step_tsc_put(b, x >> trail, st->len[c]);
+	}
+
+	return rc ? -ENOSPC : 0;
+}
+
+static int step_tsc_get_val(struct step_tsc_bits *b, struct step_tsc_state *st,
+			    uint32_t c, uint32_t *val)
+{
+	uint64_t v;
+
+	if (step_tsc_get(b, 1, &v)) {
+		return -EINVAL;
+	}
+
+	if (v) {
+		if (step_tsc_get(b, 1, &v)) {
+			return -EINVAL;
+		}
+		if (v) {
+			/* New window. */
+			if (step_tsc_get(b, 5, &v)) {
+				return -EINVAL;
+			}
+			st->lead[c] = (uint8_t)v;
+			if (step_tsc_get(b, 5, &v)) {
+				return -EINVAL;
+			}
+			st->len[c] = (uint8_t)v + 1;
+			if (st->lead[c] + st->len[c] > 32) {
+				return -EINVAL;
+			}
+		} else if (st->len[c] == 0) {
+			return -EINVAL;
+		}
+
+		if (step_tsc_get(b, st->len[c], &v)) {
+			return -EINVAL;
+		}
+		st->prev[c] ^= (uint32_t)v << (32 - st->lead[c] - st->len[c]);
+	}
+
+	*val = st->prev[c];
+
+	return 0;
+}
+
+/**
+ * @brief Finds the state for 'sourceid', optionally replacing the least
+ *        recently used slot if it isn't present.
+ */
+static struct step_tsc_state *step_tsc_state_get(struct step_tsc_state *states,
+						 uint8_t sourceid, bool create)
+{
+	struct step_tsc_state *lru = &states[0];
+
+	for (uint32_t i = 0; i < CONFIG_STEP_NODE_TSC_SOURCES; i++) {
+		if (states[i].used && (states[i].sourceid == sourceid)) {
+			states[i].last_used = ++step_tsc_state_clock;
+			return &states[i];
+		}
+		if (!states[i].used) {
+			lru = &states[i];
+		} else if (lru->used && (states[i].last_used < lru->last_used)) {
+			lru = &states[i];
+		}
+	}
+
+	if (!create) {
+		return NULL;
+	}
+
+	memset(lru, 0, sizeof(*lru));
+	lru->used = true;
+	lru->sourceid = sourceid;
+	lru->last_used = ++step_tsc_state_clock;
+
+	return lru;
+}
+
+/**
+ * @brief Returns true if the node instance is configured for streaming.
+ */
+static bool step_tsc_node_stream(uint32_t handle, uint32_t inst)
+{
+	struct step_node *n = step_pm_node_get(handle, inst);
+	struct step_tsc_cfg *cfg = n != NULL ? n->config : NULL;
+
+	return (cfg != NULL) && cfg->stream;
+}
+
+/**
+ * @brief Returns the offset of the first sample in a payload of 'len' bytes
+ *        described by 'hdr', or a negative value if it isn't a series of
+ *        4-byte samples.
+ */
+static int32_t step_tsc_layout(const struct step_mes_header *hdr, uint32_t len)
+{
+	uint32_t off;
+	uint32_t sample_sz = 4 * (1 + hdr->srclen.vec_sz);
+
+	switch (hdr->unit.ctype) {
+	case STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32:
+	case STEP_MES_UNIT_CTYPE_S32:
+	case STEP_MES_UNIT_CTYPE_U32:
+	case STEP_MES_UNIT_CTYPE_Q31:
+	case STEP_MES_UNIT_CTYPE_RANG_UNIT_INTERVAL_32:
+	case STEP_MES_UNIT_CTYPE_RANG_PERCENT_32:
+		break;
+	default:
+		return -1;
+	}
+
+	if (hdr->filter.flags.data_format || hdr->filter.flags.encoding ||
+	    (hdr->srclen.fragment != STEP_MES_FRAGMENT_NONE)) {
+		return -1;
+	}
+
+	off = step_mes_sz_timestamp(hdr->filter.flags.timestamp);
+	if (hdr->srclen.samples == 15) {
+		off += STEP_TSC_COUNT_SZ;
+	}
+
+	if ((len < off) || ((len - off) % sample_sz)) {
+		return -1;
+	}
+
+	return off;
+}
+
+int step_tsc_compress_exec(struct step_measurement *mes, uint32_t handle,
+			   uint32_t inst)
+{
+	int rc = 0;
+	int32_t off;
+	uint8_t *payload = mes->payload;
+	uint32_t len = mes->header.srclen.len;
+	uint32_t ts_len;
+	uint32_t comps;
+	uint32_t val;
+	uint32_t ts32;
+	uint64_t ts = 0;
+	bool reset;
+	struct step_tsc_state *slot = NULL;
+	struct step_tsc_state st;
+	struct step_tsc_bits b;
+
+	if (mes->header.filter.flags.compression != STEP_MES_COMPRESSION_NONE) {
+		return 0;
+	}
+
+	off = step_tsc_layout(&mes->header, len);
+	if ((off < 0) || (len <= STEP_TSC_HDR_SZ + 1)) {
+		/* Not a time series, or too small to shrink. */
+		return 0;
+	}
+	if (len > CONFIG_STEP_NODE_TSC_MAX_PAYLOAD) {
+		return -EFBIG;
+	}
+
+	ts_len = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	comps = 1 + mes->header.srclen.vec_sz;
+
+	k_mutex_lock(&step_tsc_node_mtx, K_FOREVER);
+
+	/* Encode from a copy, so the stream state is left untouched if the
+	 * payload doesn't shrink. */
+	if (step_tsc_node_stream(handle, inst)) {
+		slot = step_tsc_state_get(step_tsc_enc_state,
+					  mes->header.srclen.sourceid, true);
+	}
+	reset = (slot == NULL) || !slot->primed;
+	if (reset) {
+		memset(&st, 0, sizeof(st));
+	} else {
+		st = *slot;
+	}
+
+	/* Only keep the bitstream if it saves space. */
+	memset(step_tsc_scratch, 0, len);
+	b.buf = step_tsc_scratch;
+	b.len = len - STEP_TSC_HDR_SZ - 1;
+	b.pos = 0;
+
+	rc = step_tsc_put(&b, reset, 1);
+	if ((rc == 0) && ts_len) {
+		if (ts_len == sizeof(ts32)) {
+			memcpy(&ts32, payload, ts_len);
+			ts = ts32;
+		} else {
+			memcpy(&ts, payload, ts_len);
+		}
+		rc = step_tsc_put_ts(&b, &st, ts);
+	}
+	if ((rc == 0) && ((uint32_t)off > ts_len)) {
+		rc = step_tsc_put(&b, sys_get_le32(payload + ts_len), 32);
+	}
+	for (uint32_t i = 0; (rc == 0) && (off + i * 4 < len); i++) {
+		/* Samples are XORed in native byte order. */
+		memcpy(&val, payload + off + i * 4, sizeof(val));
+		rc = step_tsc_put_val(&b, &st, i % comps, val);
+	}
+	if (rc) {
+		rc = 0;
+		goto out;
+	}
+
+	sys_put_le16((uint16_t)len, payload);
+	memcpy(payload + STEP_TSC_HDR_SZ, step_tsc_scratch, (b.pos + 7) / 8);
+	mes->header.srclen.len = STEP_TSC_HDR_SZ + (b.pos + 7) / 8;
+	mes->header.filter.flags.compression = STEP_MES_COMPRESSION_TSC;
+
+	if (slot != NULL) {
+		st.sourceid = slot->sourceid;
+		st.used = true;
+		st.primed = true;
+		st.last_used = slot->last_used;
+		*slot = st;
+	}
+
+out:
+	k_mutex_unlock(&step_tsc_node_mtx);
+
+	return rc;
+}
+
+int step_tsc_decompress_exec(struct step_measurement *mes, uint32_t handle,
+			     uint32_t inst)
+{
+	int rc = 0;
+	int32_t off;
+	uint8_t *payload = mes->payload;
+	uint32_t orig_len;
+	uint32_t capacity;
+	uint32_t ts_len;
+	uint32_t comps;
+	uint32_t val;
+	uint32_t ts32;
+	uint64_t ts;
+	uint64_t reset;
+	struct step_tsc_state *slot = NULL;
+	struct step_tsc_state st;
+	struct step_tsc_bits b;
+
+	if (mes->header.filter.flags.compression != STEP_MES_COMPRESSION_TSC) {
+		return 0;
+	}
+
+	if (mes->header.srclen.len < STEP_TSC_HDR_SZ + 1) {
+		return -EINVAL;
+	}
+	orig_len = sys_get_le16(payload);
+	capacity = mes->capacity ? mes->capacity : mes->header.srclen.len;
+	if (orig_len > capacity) {
+		return -ENOSPC;
+	}
+	if (orig_len > CONFIG_STEP_NODE_TSC_MAX_PAYLOAD) {
+		return -EFBIG;
+	}
+	off = step_tsc_layout(&mes->header, orig_len);
+	if (off < 0) {
+		return -EINVAL;
+	}
+
+	ts_len = step_mes_sz_timestamp(mes->header.filter.flags.timestamp);
+	comps = 1 + mes->header.srclen.vec_sz;
+
+	b.buf = payload + STEP_TSC_HDR_SZ;
+	b.len = mes->header.srclen.len - STEP_TSC_HDR_SZ;
+	b.pos = 0;
+
+	k_mutex_lock(&step_tsc_node_mtx, K_FOREVER);
+
+	step_tsc_get(&b, 1, &reset);
+	if (step_tsc_node_stream(handle, inst)) {
+		/* The reset bit restarts the source's stream. */
+		slot = step_tsc_state_get(step_tsc_dec_state,
+					  mes->header.srclen.sourceid, reset);
+		if (slot == NULL) {
+			LOG_ERR("No stream state for source %u",
+				mes->header.srclen.sourceid);
+			rc = -ENOENT;
+			goto err;
+		}
+	} else if (!reset) {
+		rc = -ENOTSUP;
+		goto err;
+	}
+	if (reset) {
+		memset(&st, 0, sizeof(st));
+	} else {
+		st = *slot;
+	}
+
+	if (ts_len) {
+		rc = step_tsc_get_ts(&b, &st, &ts);
+		if (ts_len == sizeof(ts32)) {
+			ts32 = (uint32_t)ts;
+			memcpy(step_tsc_scratch, &ts32, ts_len);
+		} else {
+			memcpy(step_tsc_scratch, &ts, ts_len);
+		}
+	}
+	if ((rc == 0) && ((uint32_t)off > ts_len)) {
+		rc = step_tsc_get(&b, 32, &ts);
+		sys_put_le32((uint32_t)ts, step_tsc_scratch + ts_len);
+	}
+	for (uint32_t i = 0; (rc == 0) && (off + i * 4 < orig_len); i++) {
+		rc = step_tsc_get_val(&b, &st, i % comps, &val);
+		memcpy(step_tsc_scratch + off + i * 4, &val, sizeof(val));
+	}
+	if (rc) {
+		if (slot != NULL) {
+			slot->used = false;
+		}
+		goto err;
+	}
+
+	memcpy(payload, step_tsc_scratch, orig_len);
+	mes->header.srclen.len = orig_len;
+	mes->header.filter.flags.compression = STEP_MES_COMPRESSION_NONE;
+
+	if (slot != NULL) {
+		st.sourceid = slot->sourceid;
+		st.used = true;
+		st.primed = true;
+		st.last_used = slot->last_used;
+		*slot = st;
+	}
+
+err:
+	k_mutex_unlock(&step_tsc_node_mtx);
+
+	return rc;
+}
+
+void step_tsc_reset(void)
+{
+	k_mutex_lock(&step_tsc_node_mtx, K_FOREVER);
+	memset(step_tsc_enc_state, 0, sizeof(step_tsc_enc_state));
+	memset(step_tsc_dec_state, 0, sizeof(step_tsc_dec_state));
+	k_mutex_unlock(&step_tsc_node_mtx);
+}
@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/bench.h>
+#include <step/cache.h>
+#include <step/filter.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+#include <step/measurement/measurement.h>
+
+/**
+ * @brief Raw timings of every repetition of a benchmark, in nanoseconds on
+ *        native_sim and in hardware cycles elsewhere.
+ */
+struct bench_result {
+	uint64_t t[CONFIG_BENCH_REPETITIONS];
+};
+
+/* Keeps the compiler from discarding the results of the benchmarked calls. */
+static volatile int32_t bench_sink;
+
+/**
+ * @brief Converts a @ref step_bench_elapsed value to hundredths of a
+ *        nanosecond per iteration.
+ */
+static uint32_t bench_ns_x100(uint64_t t)
+{
+	return (uint32_t)(step_bench_to_ns(t * 100) / CONFIG_BENCH_ITERATIONS);
+}
+
+/**
+ * @brief Runs 'body' CONFIG_BENCH_WARMUP times untimed, then times
+ *        CONFIG_BENCH_REPETITIONS batches of CONFIG_BENCH_ITERATIONS runs.
+ *        'body' can use the iteration counter 'i'.
+ */
+#define BENCH_RUN(res, body) do {						\
+	uint64_t t0;								\
+	for (uint32_t i = 0; i < CONFIG_BENCH_WARMUP; i++) {			\
+		body;								\
+	}									\
+	for (uint32_t r = 0; r < CONFIG_BENCH_REPETITIONS; r++) {		\
+		t0 = step_bench_now();						\
+		for (uint32_t i = 0; i < CONFIG_BENCH_ITERATIONS; i++) {	\
+			body;							\
+		}								\
+		(res)->t[r] = step_bench_elapsed(t0, step_bench_now());		\
+	}									\
+} while (0)
+
+/**
+ * @brief Prints the fastest and median repetitions of a benchmark.
+ *
+ * @param name      The benchmarked primitive.
+ * @param res       The benchmark's timings, sorted in place.
+ */
+static void bench_report(const char *name, struct bench_result *res)
+{
+	uint32_t min;
+	uint32_t med;
+	uint64_t tmp;
+
+	/* Insertion sort, there are only a handful of repetitions. */
+	for (uint32_t i = 1; i < CONFIG_BENCH_REPETITIONS; i++) {
+		tmp = res->t[i];
+		uint32_t j = i;
+		for (; (j > 0) && (res->t[j - 1] > tmp); j--) {
+			res->t[j] = res->t[j - 1];
+		}
+		res->t[j] = tmp;
+	}
+
+	min = bench_ns_x100(res->t[0]);
+	med = bench_ns_x100(res->t[CONFIG_BENCH_REPETITIONS / 2]);
+
+	printk("BENCH %-22s min %u.%02u ns/op, median %u.%02u ns/op", name,
+	       min / 100, min % 100, med / 100, med % 100);
+#if !STEP_BENCH_HOST_CLOCK
+	tmp = (res->t[CONFIG_BENCH_REPETITIONS / 2] * 100) / CONFIG_BENCH_ITERATIONS;
+	printk(", %u.%02u cycles/op", (uint32_t)(tmp / 100), (uint32_t)(tmp % 100));
+#endif
+	printk("\n");
+}
+
+/* A three-entry filter chain matching die temperature measurements. */
+static struct step_filter_chain bench_chain = {
+	.count = 3,
+	.chain = (struct step_filter[]){
+		{
+			.op = STEP_FILTER_OP_IS,
+			.match = STEP_MES_TYPE_TEMPERATURE,
+			.ignore_mask = ~STEP_MES_MASK_BASE_TYPE,
+		},
+		{
+			.op = STEP_FILTER_OP_AND,
+			.match = STEP_MES_EXT_TYPE_TEMP_DIE << STEP_MES_MASK_EXT_TYPE_POS,
+			.ignore_mask = ~STEP_MES_MASK_EXT_TYPE,
+		},
+		{
+			.op = STEP_FILTER_OP_AND_NOT,
+			.match = STEP_MES_TYPE_LIGHT,
+			.ignore_mask = ~STEP_MES_MASK_BASE_TYPE,
+		},
+	},
+};
+
+static float bench_temp = 32.0F;
+
+static struct step_measurement bench_mes = {
+	.header.filter.base_type = STEP_MES_TYPE_TEMPERATURE,
+	.header.filter.ext_type = STEP_MES_EXT_TYPE_TEMP_DIE,
+	.header.unit.si_unit = STEP_MES_UNIT_SI_DEGREE_CELSIUS,
+	.header.unit.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32,
+	.header.srclen.len = sizeof(float),
+	.payload = &bench_temp,
+};
+
+static struct step_node bench_nodes[] = {
+	{
+		.name = "Benchmark node 0",
+		.next = &bench_nodes[1],
+	},
+	{
+		.name = "Benchmark node 1",
+	},
+};
+
+static void *bench_setup(void)
+{
+	uint32_t handle;
+
+	zassert_equal(step_pm_clear(), 0, NULL);
+	zassert_equal(step_pm_register(bench_nodes, 0, &handle), 0, NULL);
+
+	printk("\n%u repetitions of %u iterations per primitive\n",
+	       CONFIG_BENCH_REPETITIONS, CONFIG_BENCH_ITERATIONS);
+
+	return NULL;
+}
+
+static void bench_teardown(void *fixture)
+{
+	step_pm_clear();
+}
+
+ZTEST_SUITE(step_bench, NULL, bench_setup, NULL, NULL, bench_teardown);
+
+ZTEST(step_bench, test_bench_filt_evaluate)
+{
+	struct bench_result res;
+	int match = 0;
+
+	BENCH_RUN(&res, {
+		step_filt_evaluate(&bench_chain, &bench_mes, &match);
+		bench_sink = match;
+	});
+	zassert_equal(match, 1, NULL);
+
+	bench_report("step_filt_evaluate", &res);
+}
+
+ZTEST(step_bench, test_bench_cache)
+{
+	struct bench_result res;
+	int result = 0;
+
+	/* Lookups that hit the most recently used record. */
+	step_cache_clear();
+	step_cache_add(bench_mes.header.filter_bits, 0, 1);
+	BENCH_RUN(&res, {
+		bench_sink = step_cache_check(bench_mes.header.filter_bits, 0,
+					      &result);
+	});
+	zassert_equal(bench_sink, 1, NULL);
+	bench_report("step_cache_check (hit)", &res);
+
+	/* Lookups that miss, scanning the full working set. */
+	BENCH_RUN(&res, {
+		bench_sink = step_cache_check(~bench_mes.header.filter_bits, 0,
+					      &result);
+	});
+	zassert_equal(bench_sink, 0, NULL);
+	bench_report("step_cache_check (miss)", &res);
+
+	/* Inserts of new records, evicting the least recently used one. */
+	BENCH_RUN(&res, {
+		bench_sink = step_cache_add(i, 1, 1);
+	});
+	bench_report("step_cache_add", &res);
+	step_cache_clear();
+}
+
+ZTEST(step_bench, test_bench_sample_pool)
+{
+	struct bench_result res;
+	struct step_measurement *mes;
+
+	BENCH_RUN(&res, {
+		mes = step_sp_alloc(16);
+		step_sp_free(mes);
+	});
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	bench_report("step_sp_alloc+free", &res);
+}
+
+ZTEST(step_bench, test_bench_mes_sz_payload)
+{
+	struct bench_result res;
+
+	BENCH_RUN(&res, {
+		bench_sink = step_mes_sz_payload(&bench_mes.header);
+	});
+	zassert_equal(bench_sink, sizeof(float), NULL);
+
+	bench_report("step_mes_sz_payload", &res);
+}
+
+ZTEST(step_bench, test_bench_pm_node_get)
+{
+	struct bench_result res;
+	struct step_node *node = NULL;
+
+	BENCH_RUN(&res, {
+		node = step_pm_node_get(0, 1);
+		bench_sink = (int32_t)(uintptr_t)node;
+	});
+	zassert_equal(node, &bench_nodes[1], NULL);
+
+	bench_report("step_pm_node_get", &res);
+}
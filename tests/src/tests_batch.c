@@ -0,0 +1,240 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/step.h>
+#include <step/batch.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_BATCH
+ZTEST_SUITE(tests_batch, NULL, NULL, NULL, NULL, NULL);
+
+static struct step_measurement *batch_out;
+static uint32_t batch_flushes;
+
+static int batch_flush(struct step_measurement *mes, void *user_data)
+{
+	/* Keep the last batch for inspection. */
+	if (batch_out != NULL) {
+		step_sp_free(batch_out);
+	}
+	batch_out = mes;
+	batch_flushes++;
+
+	return 0;
+}
+
+static void batch_reset(void)
+{
+	if (batch_out != NULL) {
+		step_sp_free(batch_out);
+	}
+	batch_out = NULL;
+	batch_flushes = 0;
+}
+
+static struct step_batch batch_f32 = {
+	.header = {
+		.filter = {
+			.base_type = STEP_MES_TYPE_TEMPERATURE,
+			.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32,
+		},
+		.unit = {
+			.si_unit = STEP_MES_UNIT_SI_DEGREE_CELSIUS,
+			.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32,
+		},
+		.srclen.sourceid = 3,
+	},
+	.max_samples = 4,
+	.flush = batch_flush,
+};
+
+ZTEST(tests_batch, test_batch_pow2)
+{
+	int rc;
+	float f;
+	int16_t s;
+	uint32_t ts;
+	struct step_batch_iter it;
+
+	batch_reset();
+	rc = step_batch_init(&batch_f32);
+	zassert_equal(rc, 0, NULL);
+
+	/* Full batches of 2^n samples use the header's sample count. */
+	for (uint32_t i = 0; i < 4; i++) {
+		f = 20.0F + i;
+		rc = step_batch_add(&batch_f32, &f, 1000 + i);
+		zassert_equal(rc, 0, NULL);
+	}
+	zassert_equal(batch_flushes, 1, NULL);
+	zassert_not_null(batch_out, NULL);
+	zassert_equal(batch_out->header.srclen.samples, 2, NULL);
+	zassert_equal(batch_out->header.srclen.sourceid, 3, NULL);
+	zassert_equal(batch_out->header.srclen.len, 4 + 4 * sizeof(float), NULL);
+	zassert_equal(step_mes_validate(batch_out), 0, NULL);
+
+	/* Only the first sample's timestamp is kept. */
+	memcpy(&ts, batch_out->payload, sizeof(ts));
+	zassert_equal(ts, 1000, NULL);
+
+	rc = step_batch_iter_init(&it, batch_out);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(it.remaining, 4, NULL);
+	rc = step_batch_iter_next_s16(&it, &s);
+	zassert_equal(rc, -EBADMSG, NULL);
+	for (uint32_t i = 0; i < 4; i++) {
+		rc = step_batch_iter_next_f32(&it, &f);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(f, 20.0F + i, NULL);
+	}
+	rc = step_batch_iter_next_f32(&it, &f);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	/* Partial batches carry a count word after the timestamp. */
+	for (uint32_t i = 0; i < 3; i++) {
+		f = 30.0F + i;
+		rc = step_batch_add(&batch_f32, &f, 2000 + i);
+		zassert_equal(rc, 0, NULL);
+	}
+	zassert_equal(batch_flushes, 1, NULL);
+	rc = step_batch_flush(&batch_f32);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(batch_flushes, 2, NULL);
+	zassert_equal(batch_out->header.srclen.samples, 15, NULL);
+	zassert_equal(batch_out->header.srclen.len,
+		      4 + 4 + 3 * sizeof(float), NULL);
+	zassert_equal(sys_get_le32((uint8_t *)batch_out->payload + 4), 3, NULL);
+
+	rc = step_batch_iter_init(&it, batch_out);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(it.remaining, 3, NULL);
+	for (uint32_t i = 0; i < 3; i++) {
+		rc = step_batch_iter_next_f32(&it, &f);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(f, 30.0F + i, NULL);
+	}
+
+	/* Flushing an empty batcher does nothing. */
+	rc = step_batch_flush(&batch_f32);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(batch_flushes, 2, NULL);
+
+	batch_reset();
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+}
+
+ZTEST(tests_batch, test_batch_vector)
+{
+	int rc;
+	int16_t xyz[3];
+	struct step_batch_iter it;
+	struct step_batch b = {
+		.header = {
+			.unit.ctype = STEP_MES_UNIT_CTYPE_S16,
+			.srclen.vec_sz = STEP_MES_VECTOR_SZ_3,
+		},
+		.max_samples = 3,
+		.flush = batch_flush,
+	};
+
+	batch_reset();
+	rc = step_batch_init(&b);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(b.sample_sz, sizeof(xyz), NULL);
+
+	/* Full batches that aren't 2^n samples also use the count word. */
+	for (int16_t i = 0; i < 3; i++) {
+		xyz[0] = i;
+		xyz[1] = -i;
+		xyz[2] = i * 100;
+		rc = step_batch_add(&b, xyz, 0);
+		zassert_equal(rc, 0, NULL);
+	}
+	zassert_equal(batch_flushes, 1, NULL);
+	zassert_equal(batch_out->header.srclen.samples, 15, NULL);
+	zassert_equal(batch_out->header.srclen.len, 4 + 3 * sizeof(xyz), NULL);
+
+	rc = step_batch_iter_init(&it, batch_out);
+	zassert_equal(rc, 0, NULL);
+	for (int16_t i = 0; i < 3; i++) {
+		rc = step_batch_iter_next_s16(&it, xyz);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(xyz[0], i, NULL);
+		zassert_equal(xyz[1], -i, NULL);
+		zassert_equal(xyz[2], i * 100, NULL);
+	}
+
+	/* A count larger than the payload is rejected. */
+	sys_put_le32(4, batch_out->payload);
+	rc = step_batch_iter_init(&it, batch_out);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	batch_reset();
+
+	/* Samples need a fixed size. */
+	b.header.unit.ctype = STEP_MES_UNIT_CTYPE_UNDEFINED;
+	rc = step_batch_init(&b);
+	zassert_equal(rc, -EINVAL, NULL);
+}
+
+static struct step_node batch_node = {
+	.name = "Batcher",
+	.callbacks = {
+		.exec_handler = step_batch_exec,
+	},
+	.config = &batch_f32,
+};
+
+ZTEST(tests_batch, test_batch_node)
+{
+	int rc;
+	uint32_t handle;
+	struct {
+		uint32_t timestamp;
+		float temp;
+	} payload = { 5000, 21.5F };
+	struct step_measurement mes = {
+		.header = batch_f32.header,
+		.payload = &payload,
+	};
+
+	mes.header.srclen.len = sizeof(payload);
+
+	batch_reset();
+	rc = step_batch_init(&batch_f32);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&batch_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* Single samples are absorbed into the batch. */
+	for (uint32_t i = 0; i < 4; i++) {
+		rc = step_batch_exec(&mes, handle, 0);
+		zassert_equal(rc, STEP_NODE_RC_ABORT_CHAIN, NULL);
+	}
+	zassert_equal(batch_flushes, 1, NULL);
+
+	/* Batches and other sources pass through. */
+	rc = step_batch_exec(batch_out, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	mes.header.srclen.sourceid = 4;
+	rc = step_batch_exec(&mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(batch_flushes, 1, NULL);
+
+	batch_reset();
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_BATCH */
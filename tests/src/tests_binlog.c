@@ -0,0 +1,326 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/binlog.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+#if CONFIG_STEP_BINLOG_MMAP
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#endif
+
+#if CONFIG_STEP_BINLOG
+ZTEST_SUITE(tests_binlog, NULL, NULL, NULL, NULL, NULL);
+
+/* Enough records for two full index frames and a partial one. */
+#define BINLOG_RECORDS  (2 * CONFIG_STEP_BINLOG_INDEX_INTERVAL + 2)
+
+static uint8_t binlog_data[8192];
+static struct step_binlog_buf binlog_buf;
+static struct step_binlog_writer binlog_writer = {
+	.sink = step_binlog_buf_sink,
+	.user_data = &binlog_buf,
+};
+
+/**
+ * @brief Writes a log of BINLOG_RECORDS measurements, where record 'i' has
+ *        'i % 8' payload bytes set to 'i', with a source ID of 'i'.
+ */
+static void binlog_write(bool finish)
+{
+	int rc;
+	uint8_t payload[8];
+	struct step_measurement mes = { 0 };
+
+	binlog_buf.buf = binlog_data;
+	binlog_buf.len = sizeof(binlog_data);
+	binlog_buf.pos = 0;
+	rc = step_binlog_writer_init(&binlog_writer);
+	zassert_equal(rc, 0, NULL);
+
+	mes.header.filter.base_type = STEP_MES_TYPE_TEMPERATURE;
+	mes.header.unit.si_unit = STEP_MES_UNIT_SI_DEGREE_CELSIUS;
+	mes.header.unit.ctype = STEP_MES_UNIT_CTYPE_U8;
+	mes.payload = payload;
+	for (uint32_t i = 0; i < BINLOG_RECORDS; i++) {
+		memset(payload, (uint8_t)i, sizeof(payload));
+		mes.header.srclen.len = i % 8;
+		mes.header.srclen.sourceid = i % 32;
+		rc = step_binlog_write(&binlog_writer, &mes);
+		zassert_equal(rc, 0, NULL);
+	}
+
+	if (finish) {
+		rc = step_binlog_writer_finish(&binlog_writer);
+		zassert_equal(rc, 0, NULL);
+	}
+}
+
+static void binlog_check_rec(const struct step_binlog_rec *rec, uint32_t i)
+{
+	const uint8_t *p = rec->payload;
+
+	zassert_equal(rec->index, i, NULL);
+	zassert_equal(rec->header.filter.base_type, STEP_MES_TYPE_TEMPERATURE,
+		      NULL);
+	zassert_equal(rec->header.srclen.len, i % 8, NULL);
+	zassert_equal(rec->header.srclen.sourceid, i % 32, NULL);
+	for (uint32_t j = 0; j < i % 8; j++) {
+		zassert_equal(p[j], (uint8_t)i, NULL);
+	}
+}
+
+ZTEST(tests_binlog, test_binlog_roundtrip)
+{
+	int rc;
+	struct step_binlog_reader r;
+	struct step_binlog_rec rec;
+
+	binlog_write(true);
+
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, 0, NULL);
+	zassert_true(r.finished, NULL);
+	zassert_equal(r.records, BINLOG_RECORDS, NULL);
+
+	for (uint32_t i = 0; i < BINLOG_RECORDS; i++) {
+		rc = step_binlog_next(&r, &rec);
+		zassert_equal(rc, 0, NULL);
+		binlog_check_rec(&rec, i);
+		/* Payloads point into the log. */
+		zassert_equal((const uint8_t *)rec.payload,
+			      binlog_data + rec.offset + 16, NULL);
+	}
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	/* Invalid headers. */
+	rc = step_binlog_reader_init(&r, binlog_data, 4);
+	zassert_equal(rc, -EINVAL, NULL);
+	binlog_data[4] = STEP_BINLOG_VERSION + 1;
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, -ENOTSUP, NULL);
+}
+
+ZTEST(tests_binlog, test_binlog_seek)
+{
+	int rc;
+	struct step_binlog_reader r;
+	struct step_binlog_rec rec;
+	uint32_t idx[] = { BINLOG_RECORDS - 1, 0,
+			   CONFIG_STEP_BINLOG_INDEX_INTERVAL,
+			   CONFIG_STEP_BINLOG_INDEX_INTERVAL + 1 };
+
+	/* Via the index frames, then by scanning an unfinished log. */
+	for (uint32_t pass = 0; pass < 2; pass++) {
+		binlog_write(pass == 0);
+		rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(r.finished, pass == 0, NULL);
+
+		for (uint32_t i = 0; i < ARRAY_SIZE(idx); i++) {
+			rc = step_binlog_seek(&r, idx[i]);
+			zassert_equal(rc, 0, NULL);
+			rc = step_binlog_next(&r, &rec);
+			zassert_equal(rc, 0, NULL);
+			binlog_check_rec(&rec, idx[i]);
+		}
+
+		rc = step_binlog_seek(&r, BINLOG_RECORDS);
+		zassert_equal(rc, -ENOENT, NULL);
+	}
+}
+
+ZTEST(tests_binlog, test_binlog_corrupt)
+{
+	int rc;
+	struct step_binlog_reader r;
+	struct step_binlog_rec rec;
+	uint32_t bad = CONFIG_STEP_BINLOG_INDEX_INTERVAL - 1;
+	uint32_t i = 0;
+
+	binlog_write(false);
+
+	/* Corrupt the length of the last record before the first index. */
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_seek(&r, bad);
+	zassert_equal(rc, 0, NULL);
+	binlog_data[r.pos + 4 + 8] ^= 0x05;
+
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, 0, NULL);
+	while (i < BINLOG_RECORDS) {
+		rc = step_binlog_next(&r, &rec);
+		if (i == bad) {
+			/* The record is skipped, and the index frame after it
+			 * restores the numbering. */
+			zassert_equal(rc, -EBADMSG, NULL);
+			i++;
+			continue;
+		}
+		zassert_equal(rc, 0, NULL);
+		binlog_check_rec(&rec, i);
+		i++;
+	}
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	/* A partial frame at the end of a log still being written. */
+	binlog_write(false);
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_seek(&r, BINLOG_RECORDS - 1);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_reader_init(&r, binlog_data, r.pos + 10);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_seek(&r, BINLOG_RECORDS - 1);
+	zassert_equal(rc, -ENOENT, NULL);
+	rc = step_binlog_seek(&r, BINLOG_RECORDS - 2);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, 0, NULL);
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, -ENODATA, NULL);
+	r.len = binlog_buf.pos;
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, 0, NULL);
+	binlog_check_rec(&rec, BINLOG_RECORDS - 1);
+}
+
+ZTEST(tests_binlog, test_binlog_sink_full)
+{
+	int rc;
+	uint8_t payload[4] = { 0 };
+	struct step_measurement mes = { 0 };
+
+	binlog_buf.buf = binlog_data;
+	binlog_buf.len = STEP_BINLOG_FILE_HDR_SZ + 20;
+	binlog_buf.pos = 0;
+	rc = step_binlog_writer_init(&binlog_writer);
+	zassert_equal(rc, 0, NULL);
+
+	mes.payload = payload;
+	mes.header.srclen.len = sizeof(payload);
+	rc = step_binlog_write(&binlog_writer, &mes);
+	zassert_equal(rc, -ENOSPC, NULL);
+	zassert_equal(binlog_writer.records, 0, NULL);
+}
+
+static struct step_node binlog_node = {
+	.name = "Binary log",
+	.callbacks = {
+		.exec_handler = step_binlog_exec,
+	},
+	.config = &binlog_writer,
+};
+
+ZTEST(tests_binlog, test_binlog_node)
+{
+	int rc;
+	uint32_t handle;
+	struct step_measurement *mes;
+	struct step_measurement replay;
+	struct step_binlog_reader r;
+	struct step_binlog_rec rec;
+
+	binlog_buf.buf = binlog_data;
+	binlog_buf.len = sizeof(binlog_data);
+	binlog_buf.pos = 0;
+	rc = step_binlog_writer_init(&binlog_writer);
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&binlog_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	mes = step_sp_alloc(4);
+	zassert_not_null(mes, NULL);
+	mes->header.filter.base_type = STEP_MES_TYPE_LIGHT;
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_U32;
+	mes->header.srclen.len = 4;
+	memcpy(mes->payload, "\x01\x02\x03\x04", 4);
+
+	rc = step_binlog_exec(mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	step_sp_free(mes);
+
+	rc = step_binlog_writer_finish(&binlog_writer);
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_binlog_reader_init(&r, binlog_data, binlog_buf.pos);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(r.records, 1, NULL);
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, 0, NULL);
+
+	step_binlog_rec_mes(&rec, &replay);
+	zassert_equal(replay.header.filter.base_type, STEP_MES_TYPE_LIGHT, NULL);
+	zassert_equal(step_mes_validate(&replay), 0, NULL);
+	zassert_mem_equal(replay.payload, "\x01\x02\x03\x04", 4, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+#if CONFIG_STEP_BINLOG_MMAP
+ZTEST(tests_binlog, test_binlog_map)
+{
+	int rc;
+	int fd;
+	char path[] = "/tmp/step_binlog_XXXXXX";
+	char empty[] = "/tmp/step_binlog_XXXXXX";
+	struct step_binlog_reader r;
+	struct step_binlog_rec rec;
+
+	/* Write the log to a file on the host. */
+	binlog_write(true);
+	fd = mkstemp(path);
+	zassert_true(fd >= 0, NULL);
+	zassert_equal(write(fd, binlog_data, binlog_buf.pos), binlog_buf.pos,
+		      NULL);
+	close(fd);
+
+	rc = step_binlog_map(path, &r);
+	zassert_equal(rc, 0, NULL);
+	zassert_not_null(r.map, NULL);
+	zassert_true(r.finished, NULL);
+	zassert_equal(r.records, BINLOG_RECORDS, NULL);
+
+	for (uint32_t i = 0; i < BINLOG_RECORDS; i++) {
+		rc = step_binlog_next(&r, &rec);
+		zassert_equal(rc, 0, NULL);
+		binlog_check_rec(&rec, i);
+		/* Payloads point into the mapping, not a copy. */
+		zassert_equal((const uint8_t *)rec.payload,
+			      (const uint8_t *)r.map + rec.offset + 16, NULL);
+	}
+	rc = step_binlog_next(&r, &rec);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	step_binlog_unmap(&r);
+	zassert_is_null(r.map, NULL);
+	zassert_equal(r.len, 0, NULL);
+	unlink(path);
+
+	/* Missing files and files too short to hold a header. */
+	rc = step_binlog_map(path, &r);
+	zassert_equal(rc, -ENOENT, NULL);
+	fd = mkstemp(empty);
+	zassert_true(fd >= 0, NULL);
+	close(fd);
+	rc = step_binlog_map(empty, &r);
+	zassert_equal(rc, -EINVAL, NULL);
+	unlink(empty);
+}
+#endif
+#endif /* CONFIG_STEP_BINLOG */
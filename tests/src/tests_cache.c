@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2021 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/cache.h>
+
+#if CONFIG_STEP_FILTER_CACHE
+ZTEST_SUITE(tests_cache, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(tests_cache, test_cache_check_add)
+{
+	int rc;
+	int result;
+
+	step_cache_clear();
+
+	/* Empty cache, no match. */
+	rc = step_cache_check(0x1234, 1, &result);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(result, 0, NULL);
+
+	/* Add a record and retrieve it. */
+	rc = step_cache_add(0x1234, 1, 1);
+	zassert_equal(rc, 0, NULL);
+	rc = step_cache_check(0x1234, 1, &result);
+	zassert_equal(rc, 1, NULL);
+	zassert_equal(result, 1, NULL);
+
+	/* Same filter, different handle, no match. */
+	rc = step_cache_check(0x1234, 2, &result);
+	zassert_equal(rc, 0, NULL);
+
+	step_cache_clear();
+}
+
+ZTEST(tests_cache, test_cache_depth_set)
+{
+	int rc;
+	int result;
+	uint32_t depth = step_cache_depth_get();
+
+	step_cache_clear();
+
+	/* Invalid working set sizes. */
+	zassert_equal(step_cache_depth_set(0), -EINVAL, NULL);
+	zassert_equal(step_cache_depth_set(CONFIG_STEP_FILTER_CACHE_DEPTH + 1),
+		      -EINVAL, NULL);
+
+	/* Fill a working set of two records. */
+	rc = step_cache_depth_set(2);
+	zassert_equal(rc, 0, NULL);
+	step_cache_add(0x1, 0, 1);
+	k_msleep(1);
+	step_cache_add(0x2, 0, 1);
+	k_msleep(1);
+
+	/* A third record evicts the least recently used one. */
+	step_cache_add(0x3, 0, 1);
+	zassert_equal(step_cache_check(0x1, 0, &result), 0, NULL);
+	zassert_equal(step_cache_check(0x2, 0, &result), 1, NULL);
+	zassert_equal(step_cache_check(0x3, 0, &result), 1, NULL);
+
+	/* Shrinking keeps the most recently used record. */
+	k_msleep(1);
+	step_cache_check(0x2, 0, &result);
+	rc = step_cache_depth_set(1);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(step_cache_check(0x2, 0, &result), 1, NULL);
+	zassert_equal(step_cache_check(0x3, 0, &result), 0, NULL);
+
+	/* Restore the original working set size. */
+	rc = step_cache_depth_set(depth);
+	zassert_equal(rc, 0, NULL);
+	step_cache_clear();
+}
+
+ZTEST(tests_cache, test_cache_stats)
+{
+	int result;
+	struct step_cache_stats stats;
+
+	step_cache_clear();
+	step_cache_stats_reset();
+
+	/* One miss, one insert and one hit. */
+	step_cache_check(0x1234, 1, &result);
+	step_cache_add(0x1234, 1, 1);
+	step_cache_check(0x1234, 1, &result);
+
+	step_cache_stats_get(&stats);
+	zassert_equal(stats.check_calls, 2, NULL);
+	zassert_equal(stats.add_calls, 1, NULL);
+	zassert_equal(stats.matches, 1, NULL);
+	zassert_equal(stats.clear_calls, 0, NULL);
+
+	step_cache_stats_reset();
+	step_cache_stats_get(&stats);
+	zassert_equal(stats.check_calls, 0, NULL);
+	zassert_equal(stats.matches, 0, NULL);
+
+	step_cache_clear();
+}
+
+#if CONFIG_STEP_FILTER_CACHE_ADAPTIVE
+/* Windows to allow for a decision, since a window may already be part way
+ * through when a test starts. */
+#define CACHE_MAX_WINDOWS	8
+
+/**
+ * @brief Looks up 'filter' once for every lookup in an adaptive window.
+ */
+static void cache_check_window(uint32_t filter)
+{
+	int result;
+
+	for (uint32_t i = 0; i < CONFIG_STEP_FILTER_CACHE_ADAPTIVE_WINDOW; i++) {
+		step_cache_check(filter, 0, &result);
+	}
+}
+
+ZTEST(tests_cache, test_cache_adaptive_bypass)
+{
+	uint32_t w;
+	struct step_cache_stats stats;
+
+	step_cache_clear();
+	zassert_equal(step_cache_depth_set(CONFIG_STEP_FILTER_CACHE_DEPTH), 0,
+		      NULL);
+	zassert_true(step_cache_active(), NULL);
+
+	/* Filter evaluations that cost nothing make every lookup that misses
+	 * more expensive than evaluating, so the cache is bypassed. */
+	for (w = 0; (w < CACHE_MAX_WINDOWS) && step_cache_active(); w++) {
+		step_cache_report_eval(0);
+		cache_check_window(0x1234);
+	}
+	zassert_false(step_cache_active(), NULL);
+
+	/* While bypassed, windows are counted in filter evaluations, and the
+	 * cache is probed again after CONFIG_STEP_FILTER_CACHE_ADAPTIVE_PROBE
+	 * of them. */
+	step_cache_stats_reset();
+	for (w = 0; w < CONFIG_STEP_FILTER_CACHE_ADAPTIVE_PROBE *
+			CONFIG_STEP_FILTER_CACHE_ADAPTIVE_WINDOW - 1; w++) {
+		step_cache_report_eval(0);
+	}
+	zassert_false(step_cache_active(), NULL);
+	step_cache_report_eval(0);
+	zassert_true(step_cache_active(), NULL);
+
+	step_cache_stats_get(&stats);
+	zassert_equal(stats.bypassed_windows,
+		      CONFIG_STEP_FILTER_CACHE_ADAPTIVE_PROBE, NULL);
+
+	/* Lookups that all hit keep the cache active. */
+	step_cache_add(0x1234, 0, 1);
+	for (w = 0; w < 2; w++) {
+		cache_check_window(0x1234);
+		zassert_true(step_cache_active(), NULL);
+	}
+
+	step_cache_clear();
+	step_cache_stats_reset();
+}
+
+ZTEST(tests_cache, test_cache_adaptive_resize)
+{
+	int rc;
+	uint32_t w;
+	uint32_t depth;
+
+	step_cache_clear();
+	rc = step_cache_depth_set(CONFIG_STEP_FILTER_CACHE_ADAPTIVE_MIN_DEPTH);
+	zassert_equal(rc, 0, NULL);
+
+	/* Evictions grow the working set by doubling it, up to the full
+	 * depth. Lookups only hit, so the cache is never bypassed. */
+	for (w = 0; (w < CACHE_MAX_WINDOWS * 4) &&
+	     (step_cache_depth_get() < CONFIG_STEP_FILTER_CACHE_DEPTH); w++) {
+		depth = step_cache_depth_get();
+		for (uint32_t i = 0; i <= depth; i++) {
+			step_cache_add(i + 1, 0, 1);
+		}
+		cache_check_window(depth + 1);
+		zassert_true(step_cache_active(), NULL);
+		zassert_equal(step_cache_depth_get(),
+			      MIN(depth * 2, CONFIG_STEP_FILTER_CACHE_DEPTH), NULL);
+	}
+	zassert_equal(step_cache_depth_get(), CONFIG_STEP_FILTER_CACHE_DEPTH,
+		      NULL);
+
+	/* A mostly unused working set is halved, but never below the
+	 * minimum. */
+	step_cache_clear();
+	step_cache_add(0x1, 0, 1);
+	for (w = 0; w < CACHE_MAX_WINDOWS * 4; w++) {
+		cache_check_window(0x1);
+		zassert_true(step_cache_depth_get() >=
+			     CONFIG_STEP_FILTER_CACHE_ADAPTIVE_MIN_DEPTH, NULL);
+	}
+	depth = step_cache_depth_get();
+	zassert_true(depth < CONFIG_STEP_FILTER_CACHE_DEPTH, NULL);
+	zassert_true((depth / 2 < CONFIG_STEP_FILTER_CACHE_ADAPTIVE_MIN_DEPTH) ||
+		     (depth / 2 <= 1), NULL);
+
+	zassert_equal(step_cache_depth_set(CONFIG_STEP_FILTER_CACHE_DEPTH), 0,
+		      NULL);
+	step_cache_clear();
+}
+#endif
+#endif
@@ -0,0 +1,189 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/cbor.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_CBOR
+ZTEST_SUITE(tests_cbor, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(tests_cbor, test_cbor_writer)
+{
+	int rc;
+	uint8_t buf[32];
+	struct step_cbor_writer w;
+
+	/* rfc8949 Appendix A vectors. */
+	static const uint8_t expected[] = {
+		0x87,                                   /* array(7) */
+		0x17,                                   /* 23 */
+		0x18, 0x64,                             /* 100 */
+		0x1a, 0x00, 0x0f, 0x42, 0x40,           /* 1000000 */
+		0x39, 0x03, 0xe7,                       /* -1000 */
+		0x62, 0x49, 0x45,                       /* "IE" */
+		0xfa, 0x47, 0xc3, 0x50, 0x00,           /* 100000.0 */
+		0xa1, 0x41, 0x01, 0xf5,                 /* {h'01': true} */
+	};
+
+	step_cbor_writer_init(&w, buf, sizeof(buf));
+	step_cbor_put_array(&w, 7);
+	step_cbor_put_uint(&w, 23);
+	step_cbor_put_uint(&w, 100);
+	step_cbor_put_int(&w, 1000000);
+	step_cbor_put_int(&w, -1000);
+	step_cbor_put_text(&w, "IE", 2);
+	step_cbor_put_float(&w, 100000.0F);
+	step_cbor_put_map(&w, 1);
+	step_cbor_put_bytes(&w, "\x01", 1);
+	step_cbor_put_bool(&w, true);
+	rc = step_cbor_writer_finish(&w);
+	zassert_equal(rc, sizeof(expected), NULL);
+	zassert_mem_equal(buf, expected, sizeof(expected), NULL);
+
+	/* Errors are sticky. */
+	step_cbor_writer_init(&w, buf, 4);
+	rc = step_cbor_put_text(&w, "abcd", 4);
+	zassert_equal(rc, -ENOSPC, NULL);
+	rc = step_cbor_put_uint(&w, 1);
+	zassert_equal(rc, -ENOSPC, NULL);
+	rc = step_cbor_writer_finish(&w);
+	zassert_equal(rc, -ENOSPC, NULL);
+}
+
+/**
+ * @brief Encodes a small map, used in sizing and writing passes.
+ */
+static void encode_sample(struct step_cbor_writer *w)
+{
+	step_cbor_put_map(w, 2);
+	step_cbor_put_text(w, "t", 1);
+	step_cbor_put_float(w, 21.5F);
+	step_cbor_put_text(w, "raw", 3);
+	step_cbor_put_bytes(w, "\x0a\x0b\x0c", 3);
+}
+
+ZTEST(tests_cbor, test_cbor_mes)
+{
+	int rc;
+	int sz;
+	float f;
+	uint32_t count;
+	uint32_t len;
+	const char *key;
+	const uint8_t *data;
+	struct step_cbor_writer w;
+	struct step_cbor_reader r;
+	struct step_measurement *mes;
+
+	/* Size the payload, then allocate it exactly. */
+	step_cbor_writer_init(&w, NULL, 0);
+	encode_sample(&w);
+	sz = step_cbor_writer_finish(&w);
+	zassert_equal(sz, 1 + 2 + 5 + 4 + 4, NULL);
+
+	mes = step_sp_alloc(4 + sz);
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+
+	/* Not CBOR yet. */
+	rc = step_cbor_reader_init_mes(&r, mes);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	step_cbor_writer_init_mes(&w, mes);
+	encode_sample(&w);
+	rc = step_cbor_writer_finish_mes(&w, mes);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(mes->header.srclen.len, 4 + sz, NULL);
+	zassert_equal(mes->header.filter.flags.data_format,
+		      STEP_MES_FORMAT_CBOR, NULL);
+
+	/* Read it back, strings point into the payload. */
+	rc = step_cbor_reader_init_mes(&r, mes);
+	zassert_equal(rc, 0, NULL);
+	rc = step_cbor_get_map(&r, &count);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(count, 2, NULL);
+	rc = step_cbor_get_text(&r, &key, &len);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(len, 1, NULL);
+	zassert_equal(key[0], 't', NULL);
+	zassert_true((const uint8_t *)key > (const uint8_t *)mes->payload, NULL);
+
+	/* Type mismatch doesn't advance the reader. */
+	rc = step_cbor_get_text(&r, &key, &len);
+	zassert_equal(rc, -EBADMSG, NULL);
+	rc = step_cbor_get_float(&r, &f);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(f, 21.5F, NULL);
+
+	/* Skip the key, read the value. */
+	rc = step_cbor_skip(&r);
+	zassert_equal(rc, 0, NULL);
+	rc = step_cbor_get_bytes(&r, &data, &len);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(len, 3, NULL);
+	zassert_mem_equal(data, "\x0a\x0b\x0c", 3, NULL);
+
+	rc = step_cbor_skip(&r);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	step_sp_free(mes);
+}
+
+ZTEST(tests_cbor, test_cbor_reader)
+{
+	int rc;
+	int64_t i;
+	float f;
+	struct step_cbor_reader r;
+	struct step_cbor_item item;
+
+	/* Half floats: 1.5, -4.0, 5.960464477539063e-8 (smallest subnormal). */
+	static const uint8_t halfs[] = {
+		0xf9, 0x3e, 0x00, 0xf9, 0xc4, 0x00, 0xf9, 0x00, 0x01,
+	};
+	/* [1, [2, 3], {"a": 4}] followed by -1. */
+	static const uint8_t nested[] = {
+		0x83, 0x01, 0x82, 0x02, 0x03, 0xa1, 0x61, 0x61, 0x04, 0x20,
+	};
+	/* Truncated array, and an indefinite-length array. */
+	static const uint8_t truncated[] = { 0x82, 0x01 };
+	static const uint8_t indefinite[] = { 0x9f, 0x01, 0xff };
+
+	step_cbor_reader_init(&r, halfs, sizeof(halfs));
+	rc = step_cbor_get_float(&r, &f);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(f, 1.5F, NULL);
+	rc = step_cbor_get_float(&r, &f);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(f, -4.0F, NULL);
+	rc = step_cbor_next(&r, &item);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(item.type, STEP_CBOR_TYPE_FLOAT, NULL);
+	zassert_equal(item.f, 5.960464477539063e-8, NULL);
+
+	step_cbor_reader_init(&r, nested, sizeof(nested));
+	rc = step_cbor_skip(&r);
+	zassert_equal(rc, 0, NULL);
+	rc = step_cbor_get_int(&r, &i);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(i, -1, NULL);
+	rc = step_cbor_next(&r, &item);
+	zassert_equal(rc, -ENODATA, NULL);
+
+	step_cbor_reader_init(&r, truncated, sizeof(truncated));
+	rc = step_cbor_skip(&r);
+	zassert_equal(rc, -EINVAL, NULL);
+	zassert_equal(r.pos, 0, NULL);
+
+	step_cbor_reader_init(&r, indefinite, sizeof(indefinite));
+	rc = step_cbor_next(&r, &item);
+	zassert_equal(rc, -ENOTSUP, NULL);
+}
+#endif /* CONFIG_STEP_CBOR */
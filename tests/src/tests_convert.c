@@ -0,0 +1,173 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/convert.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+#include "floatcheck.h"
+
+#if CONFIG_STEP_CONVERT
+ZTEST_SUITE(tests_convert, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(tests_convert, test_conv_coeffs)
+{
+	int rc;
+	float scale;
+	float offset;
+
+	/* Centi-degrees Celsius to Kelvin. */
+	rc = step_conv_coeffs(STEP_MES_UNIT_SI_DEGREE_CELSIUS, -2,
+			      STEP_MES_UNIT_SI_KELVIN, 0, &scale, &offset);
+	zassert_equal(rc, 0, NULL);
+	zassert_true(val_is_equal(scale, 0.01F, 0.000001F), NULL);
+	zassert_true(val_is_equal(offset, 273.15F, 0.0001F), NULL);
+
+	/* Kelvin to milli-degrees Celsius. */
+	rc = step_conv_coeffs(STEP_MES_UNIT_SI_KELVIN, 0,
+			      STEP_MES_UNIT_SI_DEGREE_CELSIUS, -3, &scale,
+			      &offset);
+	zassert_equal(rc, 0, NULL);
+	zassert_true(val_is_equal(scale, 1000.0F, 0.001F), NULL);
+	zassert_true(val_is_equal(offset, -273150.0F, 0.1F), NULL);
+
+	/* Unrelated units. */
+	rc = step_conv_coeffs(STEP_MES_UNIT_SI_DEGREE_CELSIUS, 0,
+			      STEP_MES_UNIT_SI_METER, 0, &scale, &offset);
+	zassert_equal(rc, -ENOTSUP, NULL);
+}
+
+ZTEST(tests_convert, test_conv_values)
+{
+	int rc;
+	union {
+		uint8_t u8[100];
+		float f32[100];
+	} buf;
+	int16_t s16[3];
+	float f32[3] = { 1.2345F, -0.5F, 40.0F };
+
+	/* Widen in place, across several blocks. */
+	for (uint32_t i = 0; i < 100; i++) {
+		buf.u8[i] = i * 2;
+	}
+	rc = step_conv_values(buf.u8, STEP_MES_UNIT_CTYPE_U8, buf.f32,
+			      STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32, 100, 0.5F,
+			      1.0F);
+	zassert_equal(rc, 0, NULL);
+	for (uint32_t i = 0; i < 100; i++) {
+		zassert_true(val_is_equal(buf.f32[i], i + 1.0F, 0.0001F), NULL);
+	}
+
+	/* Narrow to mV, with rounding and saturation. */
+	rc = step_conv_values(f32, STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32, s16,
+			      STEP_MES_UNIT_CTYPE_S16, 3, 1000.0F, 0.0F);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(s16[0], 1235, NULL);
+	zassert_equal(s16[1], -500, NULL);
+	zassert_equal(s16[2], INT16_MAX, NULL);
+
+	/* Q15 fractions of a 100 V full scale to V, and back to Q31. */
+	s16[0] = 0x4000;
+	s16[1] = -0x8000;
+	s16[2] = 0x7FFF;
+	rc = step_conv_values(s16, STEP_MES_UNIT_CTYPE_Q15, buf.f32,
+			      STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32, 3, 100.0F,
+			      0.0F);
+	zassert_equal(rc, 0, NULL);
+	zassert_true(val_is_equal(buf.f32[0], 50.0F, 0.0001F), NULL);
+	zassert_true(val_is_equal(buf.f32[1], -100.0F, 0.0001F), NULL);
+	zassert_true(val_is_equal(buf.f32[2], 99.997F, 0.001F), NULL);
+	rc = step_conv_values(buf.f32, STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32,
+			      buf.f32, STEP_MES_UNIT_CTYPE_Q31, 3, 0.01F, 0.0F);
+	zassert_equal(rc, 0, NULL);
+	zassert_within(((int32_t *)buf.f32)[0], 0x40000000, 128, NULL);
+	zassert_equal(((int32_t *)buf.f32)[1], INT32_MIN, NULL);
+
+	rc = step_conv_values(f32, STEP_MES_UNIT_CTYPE_COMPLEX_32, s16,
+			      STEP_MES_UNIT_CTYPE_S16, 1, 1.0F, 0.0F);
+	zassert_equal(rc, -ENOTSUP, NULL);
+}
+
+static struct step_conv_target conv_kelvin = {
+	.si_unit = STEP_MES_UNIT_SI_KELVIN,
+	.scale_factor = 0,
+	.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32,
+};
+
+static struct step_node conv_node = {
+	.name = "Kelvin",
+	.callbacks = {
+		.exec_handler = step_conv_exec,
+	},
+	.config = &conv_kelvin,
+};
+
+ZTEST(tests_convert, test_conv_node)
+{
+	int rc;
+	uint32_t handle;
+	uint32_t ts;
+	int16_t temps[4] = { 2150, -300, 0, 10000 };
+	float kelvin[4] = { 294.65F, 270.15F, 273.15F, 373.15F };
+	float out[4];
+	struct step_measurement *mes;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&conv_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* 4 int16 samples in centi-degrees Celsius, in a buffer large enough
+	 * for the float32 result. */
+	mes = step_sp_alloc(4 + sizeof(out));
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+	mes->header.unit.si_unit = STEP_MES_UNIT_SI_DEGREE_CELSIUS;
+	mes->header.unit.scale_factor = -2;
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_S16;
+	mes->header.srclen.samples = 2;
+	mes->header.srclen.len = 4 + sizeof(temps);
+	ts = 1234;
+	memcpy(mes->payload, &ts, sizeof(ts));
+	memcpy((uint8_t *)mes->payload + 4, temps, sizeof(temps));
+
+	rc = step_conv_exec(mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(mes->header.unit.si_unit, STEP_MES_UNIT_SI_KELVIN, NULL);
+	zassert_equal(mes->header.unit.scale_factor, 0, NULL);
+	zassert_equal(mes->header.unit.ctype,
+		      STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32, NULL);
+	zassert_equal(mes->header.srclen.len, 4 + sizeof(out), NULL);
+	zassert_equal(step_mes_validate(mes), 0, NULL);
+
+	memcpy(&ts, mes->payload, sizeof(ts));
+	zassert_equal(ts, 1234, NULL);
+	memcpy(out, (uint8_t *)mes->payload + 4, sizeof(out));
+	for (uint32_t i = 0; i < 4; i++) {
+		zassert_true(val_is_equal(out[i], kelvin[i], 0.001F), NULL);
+	}
+
+	/* Already in the target representation. */
+	rc = step_conv_exec(mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(mes->header.srclen.len, 4 + sizeof(out), NULL);
+
+	/* No room to widen to float64. */
+	conv_kelvin.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT64;
+	rc = step_conv_exec(mes, handle, 0);
+	zassert_equal(rc, -ENOSPC, NULL);
+	conv_kelvin.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32;
+
+	step_sp_free(mes);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_CONVERT */
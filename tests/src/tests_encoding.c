@@ -0,0 +1,125 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/encoding.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_NODE_ENCODING
+ZTEST_SUITE(tests_encoding, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(tests_encoding, test_enc_base64)
+{
+	int rc;
+	uint8_t buf[16];
+
+	/* rfc4648 test vectors. */
+	rc = step_enc_base64_encode((const uint8_t *)"foob", 4, buf, sizeof(buf));
+	zassert_equal(rc, 8, NULL);
+	zassert_mem_equal(buf, "Zm9vYg==", 8, NULL);
+	rc = step_enc_base64_encode((const uint8_t *)"fooba", 5, buf, sizeof(buf));
+	zassert_equal(rc, 8, NULL);
+	zassert_mem_equal(buf, "Zm9vYmE=", 8, NULL);
+
+	/* In place. */
+	memcpy(buf, "foobar", 6);
+	rc = step_enc_base64_encode(buf, 6, buf, sizeof(buf));
+	zassert_equal(rc, 8, NULL);
+	zassert_mem_equal(buf, "Zm9vYmFy", 8, NULL);
+	rc = step_enc_base64_decode(buf, 8, buf, sizeof(buf));
+	zassert_equal(rc, 6, NULL);
+	zassert_mem_equal(buf, "foobar", 6, NULL);
+
+	/* Output buffer too small. */
+	rc = step_enc_base64_encode((const uint8_t *)"foobar", 6, buf, 7);
+	zassert_equal(rc, -ENOSPC, NULL);
+
+	/* Invalid input. */
+	rc = step_enc_base64_decode((const uint8_t *)"Zm9=YmFy", 8, buf, sizeof(buf));
+	zassert_equal(rc, -EINVAL, NULL);
+	rc = step_enc_base64_decode((const uint8_t *)"Zm9vY", 5, buf, sizeof(buf));
+	zassert_equal(rc, -EINVAL, NULL);
+}
+
+ZTEST(tests_encoding, test_enc_base45)
+{
+	int rc;
+	uint8_t buf[16];
+
+	/* rfc9285 test vectors. */
+	rc = step_enc_base45_encode((const uint8_t *)"AB", 2, buf, sizeof(buf));
+	zassert_equal(rc, 3, NULL);
+	zassert_mem_equal(buf, "BB8", 3, NULL);
+	rc = step_enc_base45_encode((const uint8_t *)"Hello!!", 7, buf, sizeof(buf));
+	zassert_equal(rc, 11, NULL);
+	zassert_mem_equal(buf, "%69 VD92EX0", 11, NULL);
+
+	/* In place. */
+	memcpy(buf, "ietf!", 5);
+	rc = step_enc_base45_encode(buf, 5, buf, sizeof(buf));
+	zassert_equal(rc, 8, NULL);
+	zassert_mem_equal(buf, "QED8WEX0", 8, NULL);
+	rc = step_enc_base45_decode(buf, 8, buf, sizeof(buf));
+	zassert_equal(rc, 5, NULL);
+	zassert_mem_equal(buf, "ietf!", 5, NULL);
+
+	/* Invalid input: value out of range, bad length, bad character. */
+	rc = step_enc_base45_decode((const uint8_t *)"GGW", 3, buf, sizeof(buf));
+	zassert_equal(rc, -EINVAL, NULL);
+	rc = step_enc_base45_decode((const uint8_t *)"BB8B", 4, buf, sizeof(buf));
+	zassert_equal(rc, -EINVAL, NULL);
+	rc = step_enc_base45_decode((const uint8_t *)"bb8", 3, buf, sizeof(buf));
+	zassert_equal(rc, -EINVAL, NULL);
+}
+
+ZTEST(tests_encoding, test_enc_nodes)
+{
+	int rc;
+	struct step_measurement *mes;
+	static const uint8_t data[5] = { 0x01, 0x02, 0x03, 0x04, 0x05 };
+
+	mes = step_sp_alloc(STEP_ENC_BASE45_LEN(sizeof(data)));
+	zassert_not_null(mes, NULL);
+
+	for (uint32_t i = 0; i < 2; i++) {
+		memcpy(mes->payload, data, sizeof(data));
+		mes->header.srclen.len = sizeof(data);
+
+		if (i) {
+			rc = step_enc_base45_exec(mes, 0, 0);
+			zassert_equal(mes->header.filter.flags.encoding,
+				      STEP_MES_ENCODING_BASE45, NULL);
+			zassert_equal(mes->header.srclen.len,
+				      STEP_ENC_BASE45_LEN(sizeof(data)), NULL);
+		} else {
+			rc = step_enc_base64_exec(mes, 0, 0);
+			zassert_equal(mes->header.filter.flags.encoding,
+				      STEP_MES_ENCODING_BASE64, NULL);
+			zassert_equal(mes->header.srclen.len,
+				      STEP_ENC_BASE64_LEN(sizeof(data)), NULL);
+		}
+		zassert_equal(rc, 0, NULL);
+
+		rc = step_enc_decode_exec(mes, 0, 0);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(mes->header.filter.flags.encoding,
+			      STEP_MES_ENCODING_NONE, NULL);
+		zassert_equal(mes->header.srclen.len, sizeof(data), NULL);
+		zassert_mem_equal(mes->payload, data, sizeof(data), NULL);
+	}
+
+	/* Encoded payload doesn't fit in the buffer. */
+	mes->header.srclen.len = mes->capacity;
+	rc = step_enc_base64_exec(mes, 0, 0);
+	zassert_equal(rc, -ENOSPC, NULL);
+	zassert_equal(mes->header.filter.flags.encoding,
+		      STEP_MES_ENCODING_NONE, NULL);
+
+	step_sp_free(mes);
+}
+#endif /* CONFIG_STEP_NODE_ENCODING */
@@ -134,4 +134,100 @@ ZTEST(tests_filter, test_filter_evaluate_match_bad)
 	/* TODO */
 
 	zassert_equal(1, 1, NULL);
-}
\ No newline at end of file
+}
+
+ZTEST(tests_filter, test_filter_batch_evaluate)
+{
+	int rc = 0;
+	int match;
+	int batch_match;
+	uint32_t mask[3];
+	uint32_t value[3];
+	uint32_t bitmap[1];
+	struct step_filter_chain *fc = &(step_test_data_procnode.filters);
+	struct step_measurement mes = step_test_mes_dietemp;
+
+	/* Compile the test node's filter chain into (mask, match) pairs. */
+	zassert_equal(fc->count, 3, NULL);
+	for (uint32_t i = 0; i < fc->count; i++) {
+		mask[i] = ~(fc->chain[i].ignore_mask);
+		value[i] = fc->chain[i].match & mask[i];
+	}
+
+	/* Batch results must agree with the filter engine on a match. */
+	step_filt_batch_evaluate(mes.header.filter_bits, mask, value,
+				 fc->count, bitmap);
+	rc = step_filt_batch_resolve(fc, bitmap, 0, fc->count, &batch_match);
+	zassert_equal(rc, 0, NULL);
+	rc = step_filt_evaluate(fc, &mes, &match);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(batch_match, 1, NULL);
+	zassert_equal(batch_match, match, NULL);
+
+	/* ... and on a failed match (wrong timestamp format). */
+	mes.header.filter.flags.timestamp = STEP_MES_TIMESTAMP_EPOCH_64;
+	step_filt_batch_evaluate(mes.header.filter_bits, mask, value,
+				 fc->count, bitmap);
+	rc = step_filt_batch_resolve(fc, bitmap, 0, fc->count, &batch_match);
+	zassert_equal(rc, 0, NULL);
+	rc = step_filt_evaluate(fc, &mes, &match);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(batch_match, 0, NULL);
+	zassert_equal(batch_match, match, NULL);
+
+	/* A chain that changed since it was compiled is rejected. */
+	rc = step_filt_batch_resolve(fc, bitmap, 0, fc->count - 1, &batch_match);
+	zassert_equal(rc, -EINVAL, NULL);
+}
+
+/* Enough pairs to fill 4 and 8-wide SIMD blocks, leave a scalar tail for
+ * either width, and spill into a second bitmap word. */
+#define TEST_BATCH_PAIRS        (45)
+
+/**
+ * @brief xorshift32, a repeatable pseudo-random sequence for the tests.
+ */
+static uint32_t test_filter_rand(uint32_t *state)
+{
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+
+	return *state;
+}
+
+ZTEST(tests_filter, test_filter_batch_evaluate_lanes)
+{
+	uint32_t mask[TEST_BATCH_PAIRS];
+	uint32_t value[TEST_BATCH_PAIRS];
+	uint32_t bitmap[(TEST_BATCH_PAIRS + 31) / 32];
+	uint32_t state = 0x2545F491;
+	uint32_t filter;
+	uint32_t ref;
+	uint32_t bit;
+
+	for (uint32_t run = 0; run < 16; run++) {
+		filter = test_filter_rand(&state);
+
+		/* Random masks, with about half of the pairs made to match. */
+		for (uint32_t i = 0; i < TEST_BATCH_PAIRS; i++) {
+			mask[i] = test_filter_rand(&state);
+			value[i] = test_filter_rand(&state) & 1 ?
+				   filter & mask[i] :
+				   test_filter_rand(&state) & mask[i];
+		}
+
+		/* Unused bits of the last word must be cleared too. */
+		memset(bitmap, 0xA5, sizeof(bitmap));
+		step_filt_batch_evaluate(filter, mask, value, TEST_BATCH_PAIRS,
+					 bitmap);
+
+		for (uint32_t i = 0; i < TEST_BATCH_PAIRS; i++) {
+			ref = (filter & mask[i]) == value[i] ? 1 : 0;
+			bit = (bitmap[i >> 5] >> (i & 31)) & 1;
+			zassert_equal(bit, ref, "run %u, pair %u", run, i);
+		}
+		zassert_equal(bitmap[TEST_BATCH_PAIRS >> 5] >>
+			      (TEST_BATCH_PAIRS & 31), 0, "run %u", run);
+	}
+}
@@ -0,0 +1,209 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/fixed.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_FIXED
+ZTEST_SUITE(tests_fixed, NULL, NULL, NULL, NULL, NULL);
+
+ZTEST(tests_fixed, test_fixed_q15_q31)
+{
+	int16_t q15[4] = { 0, 0x4000, -0x8000, 0x7FFF };
+	int32_t q31[4];
+	int16_t back[4];
+
+	step_q15_to_q31(q15, q31, 4);
+	zassert_equal(q31[0], 0, NULL);
+	zassert_equal(q31[1], 0x40000000, NULL);
+	zassert_equal(q31[2], INT32_MIN, NULL);
+	zassert_equal(q31[3], 0x7FFF0000, NULL);
+
+	/* The lower 16 bits are truncated. */
+	q31[0] = 0x0000FFFF;
+	step_q31_to_q15(q31, back, 4);
+	zassert_equal(back[0], 0, NULL);
+	zassert_equal(back[1], 0x4000, NULL);
+	zassert_equal(back[2], -0x8000, NULL);
+	zassert_equal(back[3], 0x7FFF, NULL);
+}
+
+ZTEST(tests_fixed, test_fixed_q15_q31_negative)
+{
+	/* Results of CMSIS-DSP's arm_q15_to_q31 for the same inputs. */
+	static const int16_t q15[6] = { -1, -2, -0x4000, -12345, -0x7FFF,
+					-0x8000 };
+	static const int32_t ref[6] = { -0x10000, -0x20000, -0x40000000,
+					-809041920, -0x7FFF0000, INT32_MIN };
+	int32_t buf[6];
+
+	step_q15_to_q31(q15, buf, 6);
+	for (int i = 0; i < 6; i++) {
+		zassert_equal(buf[i], ref[i], "q15 %d", q15[i]);
+	}
+
+	/* Converting in place gives the same results. */
+	memcpy(buf, q15, sizeof(q15));
+	step_q15_to_q31((int16_t *)buf, buf, 6);
+	zassert_mem_equal(buf, ref, sizeof(ref), NULL);
+}
+
+ZTEST(tests_fixed, test_fixed_scale)
+{
+	int32_t v[4] = { 0x40000000, -0x40000000, 0x10000000, INT32_MAX };
+
+	/* x0.5 */
+	step_q31_scale(v, 0x40000000, 0, v, 4);
+	zassert_equal(v[0], 0x20000000, NULL);
+	zassert_equal(v[1], -0x20000000, NULL);
+	zassert_equal(v[2], 0x08000000, NULL);
+	zassert_equal(v[3], 0x3FFFFFFE, NULL);
+
+	/* x0.5 * 2^3 = x4, saturating. */
+	step_q31_scale(v, 0x40000000, 3, v, 4);
+	zassert_equal(v[0], INT32_MAX, NULL);
+	zassert_equal(v[1], INT32_MIN, NULL);
+	zassert_equal(v[2], 0x20000000, NULL);
+	zassert_equal(v[3], INT32_MAX, NULL);
+
+	/* x0.5 * 2^-2 = x0.125 */
+	step_q31_scale(v, 0x40000000, -2, v, 4);
+	zassert_equal(v[2], 0x04000000, NULL);
+}
+
+ZTEST(tests_fixed, test_fixed_from_micro)
+{
+	int rc;
+	int32_t q;
+
+	/* 0.5 with a full scale of 1. */
+	rc = step_q31_from_micro(500000, 0, &q);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(q, 0x40000000, NULL);
+
+	/* -9.80665 m/s^2 with a full scale of 100. */
+	rc = step_q31_from_micro(-9806650, 2, &q);
+	zassert_equal(rc, 0, NULL);
+	zassert_within(q, -210596205, 1, NULL);
+
+	/* 0.25 mT with a full scale of 1 mT. */
+	rc = step_q31_from_micro(250, -3, &q);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(q, 0x20000000, NULL);
+
+	/* Out of range values saturate. */
+	rc = step_q31_from_micro(1000000, 0, &q);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(q, INT32_MAX, NULL);
+	rc = step_q31_from_micro(-5000000000LL, 3, &q);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(q, INT32_MIN, NULL);
+
+	/* Every supported scale stays within 2 LSB of the exact value. */
+	for (int8_t s = -6; s <= 3; s++) {
+		int64_t fs = 1;
+
+		for (int8_t i = 0; i < s + 6; i++) {
+			fs *= 10;
+		}
+		rc = step_q31_from_micro(fs - 1, s, &q);
+		zassert_equal(rc, 0, NULL);
+		zassert_within(q, (int64_t)(fs - 1) * 2147483648LL / fs, 2,
+			       NULL);
+		rc = step_q31_from_micro(-fs / 3, s, &q);
+		zassert_equal(rc, 0, NULL);
+		zassert_within(q, -(fs / 3) * 2147483648LL / fs, 2, NULL);
+	}
+
+	rc = step_q31_from_micro(0, 4, &q);
+	zassert_equal(rc, -ERANGE, NULL);
+	rc = step_q31_from_micro(0, -7, &q);
+	zassert_equal(rc, -ERANGE, NULL);
+}
+
+static void fixed_negate_q31(const int32_t *src, int32_t *dst,
+			     uint32_t block_size)
+{
+	for (uint32_t i = 0; i < block_size; i++) {
+		dst[i] = src[i] == INT32_MIN ? INT32_MAX : -src[i];
+	}
+}
+
+static struct step_fixed_cfg fixed_cfg = {
+	.q31 = fixed_negate_q31,
+};
+
+static struct step_node fixed_node = {
+	.name = "Negate",
+	.callbacks = {
+		.exec_handler = step_fixed_block_exec,
+	},
+	.config = &fixed_cfg,
+};
+
+ZTEST(tests_fixed, test_fixed_block_node)
+{
+	int rc;
+	uint32_t handle;
+	uint32_t ts = 1234;
+	int32_t q31[6] = { 1, -2, 0x40000000, INT32_MIN, 0, 7 };
+	int32_t out[6];
+	struct step_measurement *mes;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&fixed_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* 2 samples of 3-vectors, Q31 with a full scale of 10. */
+	mes = step_sp_alloc(4 + sizeof(q31));
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+	mes->header.unit.si_unit = STEP_MES_UNIT_SI_METER_PER_SECOND_2;
+	mes->header.unit.scale_factor = 1;
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_Q31;
+	mes->header.srclen.samples = 1;
+	mes->header.srclen.vec_sz = 2;
+	mes->header.srclen.len = 4 + sizeof(q31);
+	memcpy(mes->payload, &ts, sizeof(ts));
+	memcpy((uint8_t *)mes->payload + 4, q31, sizeof(q31));
+	zassert_equal(step_mes_validate(mes), 0, NULL);
+
+	rc = step_fixed_block_exec(mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	memcpy(&ts, mes->payload, sizeof(ts));
+	zassert_equal(ts, 1234, NULL);
+	memcpy(out, (uint8_t *)mes->payload + 4, sizeof(out));
+	zassert_equal(out[0], -1, NULL);
+	zassert_equal(out[1], 2, NULL);
+	zassert_equal(out[2], -0x40000000, NULL);
+	zassert_equal(out[3], INT32_MAX, NULL);
+	zassert_equal(out[4], 0, NULL);
+	zassert_equal(out[5], -7, NULL);
+
+	/* Q15 payloads pass through when no Q15 function is set. */
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_Q15;
+	rc = step_fixed_block_exec(mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_mem_equal((uint8_t *)mes->payload + 4, out, sizeof(out), NULL);
+
+	/* Truncated payloads are rejected. */
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_Q31;
+	mes->header.srclen.len = 4 + sizeof(q31) - 2;
+	rc = step_fixed_block_exec(mes, handle, 0);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	step_sp_free(mes);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_FIXED */
@@ -0,0 +1,158 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/step.h>
+#include <step/frag.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_NODE_FRAG
+ZTEST_SUITE(tests_frag, NULL, NULL, NULL, NULL, NULL);
+
+static uint8_t frag_out[128];
+static uint32_t frag_out_len;
+static uint32_t frag_out_count;
+static uint32_t frag_out_ts;
+static uint32_t frag_reassembled;
+static uint32_t frag_partials;
+
+static void frag_done(const struct step_frag_view *view, void *user_data)
+{
+	frag_reassembled++;
+	frag_out_len = view->len;
+	frag_out_count = view->count;
+	frag_out_ts = view->timestamp ? sys_get_le32(view->timestamp) : 0;
+	step_frag_view_copy(view, 0, frag_out, MIN(view->len, sizeof(frag_out)));
+}
+
+static struct step_frag_cfg frag_cfg = {
+	.cb = frag_done,
+};
+
+static struct step_node frag_node = {
+	.name = "Reassembly",
+	.callbacks = {
+		.exec_handler = step_frag_reassemble_exec,
+	},
+	.config = &frag_cfg,
+};
+
+static uint32_t frag_handle;
+
+/**
+ * @brief Simulates a transport, copying each fragment into its own pool
+ *        block and handing it to the reassembly node.
+ */
+static int frag_emit(struct step_measurement *frag, void *user_data)
+{
+	int rc;
+	struct step_measurement *copy;
+
+	copy = step_sp_alloc(frag->header.srclen.len);
+	zassert_not_null(copy, NULL);
+	copy->header = frag->header;
+	memcpy(copy->payload, frag->payload, frag->header.srclen.len);
+
+	rc = step_frag_reassemble_exec(copy, frag_handle, 0);
+	if (frag->header.srclen.fragment == STEP_MES_FRAGMENT_PARTIAL) {
+		/* Partials never continue down the chain. */
+		zassert_equal(rc, STEP_NODE_RC_ABORT_CHAIN, NULL);
+		if (!copy->queue.free_after_use) {
+			frag_partials++;
+		}
+	} else {
+		zassert_true(copy->queue.free_after_use, NULL);
+	}
+
+	/* Free what the processor manager would have freed. */
+	if (copy->queue.free_after_use) {
+		step_sp_free(copy);
+	}
+
+	return 0;
+}
+
+ZTEST(tests_frag, test_frag_split_reassemble)
+{
+	int rc;
+	uint8_t *payload;
+	struct step_measurement *mes;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&frag_node, 0, &frag_handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* 32-bit timestamp followed by 100 bytes of data. */
+	mes = step_sp_alloc(4 + 100);
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+	mes->header.srclen.sourceid = 7;
+	payload = mes->payload;
+	sys_put_le32(0xCAFE, payload);
+	for (uint32_t i = 0; i < 100; i++) {
+		payload[4 + i] = i;
+	}
+
+	/* The first fragment must have room for data after the timestamp. */
+	rc = step_frag_split(mes, 4, frag_emit, NULL);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	/* 40 + 40 + 24 bytes. */
+	frag_reassembled = 0;
+	frag_partials = 0;
+	rc = step_frag_split(mes, 40, frag_emit, NULL);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(frag_partials, 2, NULL);
+	zassert_equal(frag_reassembled, 1, NULL);
+	zassert_equal(frag_out_count, 3, NULL);
+	zassert_equal(frag_out_len, 100, NULL);
+	zassert_equal(frag_out_ts, 0xCAFE, NULL);
+	zassert_mem_equal(frag_out, payload + 4, 100, NULL);
+
+	/* Only the original measurement is left in the pool. */
+	step_sp_free(mes);
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+ZTEST(tests_frag, test_frag_overflow)
+{
+	int rc;
+	uint8_t data[CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS + 1];
+	struct step_measurement mes = {
+		.header.srclen.len = sizeof(data),
+		.header.srclen.sourceid = 8,
+		.payload = data,
+	};
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&frag_node, 0, &frag_handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* One byte per fragment is one fragment too many, so the set is
+	 * dropped and never reaches the callback. */
+	frag_reassembled = 0;
+	frag_partials = 0;
+	rc = step_frag_split(&mes, 1, frag_emit, NULL);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(frag_partials, CONFIG_STEP_NODE_FRAG_MAX_FRAGMENTS - 1, NULL);
+	zassert_equal(frag_reassembled, 0, NULL);
+
+	step_frag_flush();
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_NODE_FRAG */
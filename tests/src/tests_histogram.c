@@ -0,0 +1,311 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/histogram.h>
+#include <step/instrumentation.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include "data.h"
+
+#if CONFIG_STEP_HIST
+ZTEST_SUITE(tests_histogram, NULL, NULL, NULL, NULL, NULL);
+
+static struct step_hist hist;
+
+ZTEST(tests_histogram, test_hist_buckets)
+{
+	uint32_t prev = 0;
+	uint32_t vals[] = { 0, 1, STEP_HIST_SUB_COUNT - 1, STEP_HIST_SUB_COUNT,
+			    1000, 65535, 65536, 1000000, UINT32_MAX };
+
+	/* Small values are exact. */
+	for (uint32_t i = 0; i < STEP_HIST_SUB_COUNT; i++) {
+		zassert_equal(step_hist_bucket(i), i, NULL);
+		zassert_equal(step_hist_bucket_max(i), i, NULL);
+	}
+
+	/* Every value falls in a bucket whose range includes it, within the
+	 * advertised relative error. */
+	for (uint32_t i = 0; i < ARRAY_SIZE(vals); i++) {
+		uint32_t b = step_hist_bucket(vals[i]);
+		uint32_t max = step_hist_bucket_max(b);
+
+		zassert_true(b < STEP_HIST_BUCKETS, NULL);
+		zassert_true(max >= vals[i], NULL);
+		zassert_true(max - vals[i] <= vals[i] / STEP_HIST_SUB_COUNT,
+			     NULL);
+		zassert_true((b == 0) || (step_hist_bucket_max(b - 1) < vals[i]),
+			     NULL);
+	}
+	zassert_equal(step_hist_bucket(UINT32_MAX), STEP_HIST_BUCKETS - 1, NULL);
+
+	/* Bucket ranges are contiguous. */
+	for (uint32_t b = 0; b < STEP_HIST_BUCKETS; b++) {
+		zassert_equal(step_hist_bucket(step_hist_bucket_max(b)), b, NULL);
+		if (b > 0) {
+			zassert_equal(step_hist_bucket(prev + 1), b, NULL);
+		}
+		prev = step_hist_bucket_max(b);
+	}
+}
+
+ZTEST(tests_histogram, test_hist_percentiles)
+{
+	struct step_hist_summary s;
+	struct step_hist other;
+
+	step_hist_reset(&hist);
+	step_hist_summarise(&hist, &s);
+	zassert_equal(s.count, 0, NULL);
+	zassert_equal(s.p99, 0, NULL);
+
+	/* 1000 fast runs with a slow tail of 10, and one outlier. */
+	for (uint32_t i = 0; i < 989; i++) {
+		step_hist_record(&hist, 1000 + i % 10);
+	}
+	for (uint32_t i = 0; i < 10; i++) {
+		step_hist_record(&hist, 50000);
+	}
+	step_hist_record(&hist, 2000000);
+
+	step_hist_summarise(&hist, &s);
+	zassert_equal(s.count, 1000, NULL);
+	zassert_equal(s.min, 1000, NULL);
+	zassert_equal(s.max, 2000000, NULL);
+	zassert_equal(s.mean, 3493, NULL);
+	zassert_true((s.p50 >= 1000) &&
+		     (s.p50 <= 1009 + 1009 / STEP_HIST_SUB_COUNT), NULL);
+	zassert_true((s.p99 >= 50000) &&
+		     (s.p99 <= 50000 + 50000 / STEP_HIST_SUB_COUNT), NULL);
+	zassert_true((s.p999 >= 50000) &&
+		     (s.p999 <= 50000 + 50000 / STEP_HIST_SUB_COUNT), NULL);
+	zassert_equal(step_hist_percentile(&hist, 100000), 2000000, NULL);
+	zassert_equal(step_hist_percentile(&hist, 0),
+		      step_hist_bucket_max(step_hist_bucket(1000)), NULL);
+
+	/* Merging doubles the counts without changing the percentiles. */
+	other = hist;
+	step_hist_merge(&hist, &other);
+	zassert_equal(hist.count, 2000, NULL);
+	zassert_equal(step_hist_percentile(&hist, 99000), s.p99, NULL);
+}
+
+ZTEST(tests_histogram, test_hist_weighted)
+{
+	struct step_hist_summary s;
+	struct step_hist other;
+
+	/* A value recorded with a weight of n counts as n identical values. */
+	step_hist_reset(&hist);
+	step_hist_reset(&other);
+	step_hist_record_n(&hist, 1000, 90);
+	step_hist_record_n(&hist, 50000, 10);
+	for (uint32_t i = 0; i < 90; i++) {
+		step_hist_record(&other, 1000);
+	}
+	for (uint32_t i = 0; i < 10; i++) {
+		step_hist_record(&other, 50000);
+	}
+
+	zassert_equal(hist.count, other.count, NULL);
+	zassert_equal(hist.sum, other.sum, NULL);
+	zassert_mem_equal(hist.buckets, other.buckets, sizeof(hist.buckets),
+			  NULL);
+
+	step_hist_summarise(&hist, &s);
+	zassert_equal(s.count, 100, NULL);
+	zassert_equal(s.mean, 5900, NULL);
+	zassert_equal(s.min, 1000, NULL);
+	zassert_equal(s.max, 50000, NULL);
+}
+
+#if CONFIG_STEP_INSTRUMENTATION
+static int slow_exec(struct step_measurement *mes, uint32_t handle,
+		     uint32_t inst)
+{
+	k_busy_wait(200);
+
+	return 0;
+}
+
+static int fast_exec(struct step_measurement *mes, uint32_t handle,
+		     uint32_t inst)
+{
+	return 0;
+}
+
+static struct step_node hist_chain[] = {
+	{
+		.name = "Slow node",
+		.callbacks = {
+			.exec_handler = slow_exec,
+		},
+		.next = &hist_chain[1],
+	},
+	{
+		.name = "Fast node",
+		.callbacks = {
+			.exec_handler = fast_exec,
+		},
+	},
+};
+
+ZTEST(tests_histogram, test_hist_node_latency)
+{
+	int rc;
+	uint32_t handle;
+	struct step_hist_summary lat = { 0 };
+	struct step_hist_summary stage;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(hist_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	for (uint32_t i = 0; i < 10; i++) {
+		rc = step_pm_put(&step_test_mes_dietemp);
+		zassert_equal(rc, 0, NULL);
+	}
+
+	/* Wait for the processing thread to record every run. */
+	for (uint32_t i = 0; (i < 100) && (lat.count < 10); i++) {
+		k_msleep(10);
+		rc = step_pm_node_latency(handle, -1, &lat);
+		zassert_equal(rc, 0, NULL);
+	}
+	zassert_equal(lat.count, 10, NULL);
+	zassert_true(lat.min >= 200000 - 200000 / STEP_HIST_SUB_COUNT, NULL);
+	zassert_true(lat.p50 <= lat.p99, NULL);
+	zassert_true(lat.p99 <= lat.max, NULL);
+
+#if CONFIG_STEP_INSTRUMENTATION_STAGES >= 2
+	rc = step_pm_node_latency(handle, 0, &stage);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(stage.count, 10, NULL);
+	zassert_true(stage.min >= 200000 - 200000 / STEP_HIST_SUB_COUNT, NULL);
+	zassert_true(stage.max <= lat.max, NULL);
+
+	rc = step_pm_node_latency(handle, 1, &stage);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(stage.count, 10, NULL);
+	zassert_true(stage.p50 < lat.p50, NULL);
+#endif
+
+	rc = step_pm_node_latency(handle, CONFIG_STEP_INSTRUMENTATION_STAGES,
+				  &stage);
+	zassert_equal(rc, -ENOTSUP, NULL);
+	rc = step_pm_node_latency(handle + 1, -1, &stage);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	rc = step_pm_node_latency_reset(handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_node_latency(handle, -1, &lat);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(lat.count, 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+/**
+ * @brief Queues 'count' measurements for 'handle', and waits until its chain
+ *        latency histogram holds 'expected' runs.
+ */
+static void hist_put_and_wait(uint32_t handle, uint32_t count,
+			      uint32_t expected, struct step_hist_summary *lat)
+{
+	int rc;
+
+	for (uint32_t i = 0; i < count; i++) {
+		rc = step_pm_put(&step_test_mes_dietemp);
+		zassert_equal(rc, 0, NULL);
+	}
+
+	for (uint32_t i = 0; i < 100; i++) {
+		k_msleep(10);
+		rc = step_pm_node_latency(handle, -1, lat);
+		zassert_equal(rc, 0, NULL);
+		if (lat->count >= expected) {
+			break;
+		}
+	}
+}
+
+ZTEST(tests_histogram, test_instr_sampling)
+{
+	int rc;
+	uint32_t handle;
+	struct step_hist_summary lat;
+
+	zassert_equal(step_pm_instr_rate_set(0), -EINVAL, NULL);
+	zassert_equal(step_pm_instr_rate_set(65536), -EINVAL, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(hist_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+#if !CONFIG_STEP_INSTRUMENTATION_SAMPLE_RANDOM
+	/* Two in ten measurements are timed, and each stands for five. */
+	zassert_equal(step_pm_instr_rate_set(5), 0, NULL);
+	zassert_equal(step_pm_instr_rate_get(), 5, NULL);
+	hist_put_and_wait(handle, 10, 10, &lat);
+	zassert_equal(lat.count, 10, NULL);
+	zassert_true(lat.min >= 200000 - 200000 / STEP_HIST_SUB_COUNT, NULL);
+	zassert_true(lat.mean >= lat.min, NULL);
+	rc = step_pm_node_latency_reset(handle);
+	zassert_equal(rc, 0, NULL);
+#endif
+
+#if CONFIG_STEP_INSTRUMENTATION_BUDGET
+	/* The slow chain costs far more than timing it, so the rate drops to
+	 * 1 once enough measurements have been timed. */
+	zassert_equal(step_pm_instr_rate_set(2), 0, NULL);
+	hist_put_and_wait(handle, 80, 80, &lat);
+	zassert_equal(step_pm_instr_rate_get(), 1, NULL);
+#endif
+
+	zassert_equal(step_pm_instr_rate_set(1), 0, NULL);
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+ZTEST(tests_histogram, test_instr_calibration)
+{
+	step_instr_cyc_t t;
+	step_instr_cyc_t min = UINT32_MAX;
+	uint32_t overhead;
+
+	step_instr_calibrate();
+	overhead = step_instr_overhead();
+
+	/* The overhead is subtracted, so empty pairs measure close to 0. */
+	for (uint32_t i = 0; i < 32; i++) {
+		STEP_INSTR_START(t);
+		STEP_INSTR_STOP(t);
+		if (t < min) {
+			min = t;
+		}
+	}
+	zassert_true(min <= overhead, NULL);
+
+	/* Intervals are raw cycles until reported. */
+	STEP_INSTR_START(t);
+	k_busy_wait(100);
+	STEP_INSTR_STOP(t);
+	zassert_true(STEP_INSTR_TO_NS(t + overhead) >= 100000, NULL);
+
+	/* Intervals too long for a histogram are clamped. */
+	zassert_equal(step_instr_cyc_32(100), 100, NULL);
+#if CONFIG_TIMER_HAS_64BIT_CYCLE_COUNTER
+	zassert_equal(step_instr_cyc_32((uint64_t)UINT32_MAX + 1), UINT32_MAX,
+		      NULL);
+#endif
+}
+#endif /* CONFIG_STEP_INSTRUMENTATION */
+#endif /* CONFIG_STEP_HIST */
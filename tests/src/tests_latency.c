@@ -0,0 +1,123 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_LATENCY
+#include <step/latency.h>
+
+ZTEST_SUITE(tests_latency, NULL, NULL, NULL, NULL, NULL);
+
+K_SEM_DEFINE(lat_sync, 0, 1);
+
+static void lat_on_completed(struct step_measurement *mes, uint32_t handle,
+			     void *user)
+{
+	k_sem_give(&lat_sync);
+}
+
+/* A second subscriber, which mustn't add another delivery sample. */
+static void lat_on_completed_2(struct step_measurement *mes, uint32_t handle,
+			       void *user)
+{
+}
+
+static int lat_exec(struct step_measurement *mes, uint32_t handle,
+		    uint32_t inst)
+{
+	k_busy_wait(100);
+
+	return 0;
+}
+
+static struct step_node lat_node = {
+	.name = "Latency node",
+	.callbacks = {
+		.exec_handler = lat_exec,
+	},
+};
+
+/* Not allocated from the sample pool, with a source ID that shares a slot. */
+static struct step_measurement lat_static_mes = {
+	.header.filter.base_type = STEP_MES_TYPE_TEMPERATURE,
+	.header.srclen.sourceid = CONFIG_STEP_LATENCY_SOURCES + 1,
+};
+
+ZTEST(tests_latency, test_lat_phases)
+{
+	int rc;
+	uint32_t handle;
+	struct step_measurement *mes;
+	struct step_hist_summary lat[STEP_LAT_PHASES];
+	struct step_hist_summary shared;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&lat_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, lat_on_completed_2, NULL);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, lat_on_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+	step_lat_reset();
+
+	/* A pooled measurement that takes 200 us to fill. */
+	mes = step_sp_alloc(0);
+	zassert_not_null(mes, NULL);
+	mes->header.filter.base_type = STEP_MES_TYPE_TEMPERATURE;
+	mes->header.srclen.sourceid = 0;
+	k_busy_wait(200);
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(k_sem_take(&lat_sync, K_MSEC(3000)), 0, NULL);
+
+	/* One sample per phase, however many subscribers the chain has. */
+	for (int p = 0; p < STEP_LAT_PHASES; p++) {
+		rc = step_lat_get(0, p, &lat[p]);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(lat[p].count, 1, NULL);
+	}
+	zassert_true(lat[STEP_LAT_FILL].min >= 200000 - 200000 / STEP_HIST_SUB_COUNT,
+		     NULL);
+	zassert_true(lat[STEP_LAT_SERVICE].min >= 100000 - 100000 / STEP_HIST_SUB_COUNT,
+		     NULL);
+	zassert_true(lat[STEP_LAT_TOTAL].min >= lat[STEP_LAT_FILL].min, NULL);
+	zassert_true(lat[STEP_LAT_TOTAL].min >= lat[STEP_LAT_SERVICE].min, NULL);
+
+	/* Other sources are untouched. */
+	rc = step_lat_get(1, STEP_LAT_TOTAL, &shared);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(shared.count, 0, NULL);
+
+	/* Measurements outside the pool have no fill time, and high source IDs
+	 * share the last slot. */
+	rc = step_pm_put(&lat_static_mes);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(k_sem_take(&lat_sync, K_MSEC(3000)), 0, NULL);
+	rc = step_lat_get(CONFIG_STEP_LATENCY_SOURCES - 1, STEP_LAT_FILL, &shared);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(shared.count, 1, NULL);
+	zassert_equal(shared.max, 0, NULL);
+	rc = step_lat_get(255, STEP_LAT_TOTAL, &shared);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(shared.count, 1, NULL);
+
+	rc = step_lat_get(0, STEP_LAT_PHASES, &shared);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	step_lat_reset();
+	rc = step_lat_get(0, STEP_LAT_TOTAL, &shared);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(shared.count, 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_LATENCY */
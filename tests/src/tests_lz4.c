@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <zephyr/sys/byteorder.h>
+#include <step/step.h>
+#include <step/lz4.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_NODE_LZ4
+ZTEST_SUITE(tests_lz4, NULL, NULL, NULL, NULL, NULL);
+
+static struct step_lz4_ctx lz4_ctx;
+static uint8_t lz4_src[256];
+static uint8_t lz4_block[300];
+static uint8_t lz4_dst[256];
+
+ZTEST(tests_lz4, test_lz4_roundtrip)
+{
+	int rc;
+
+	/* Repetitive data with some noise. */
+	for (uint32_t i = 0; i < sizeof(lz4_src); i++) {
+		lz4_src[i] = (i % 16) + ((i % 37) == 0 ? 0x80 : 0);
+	}
+
+	/* Independent block. */
+	rc = step_lz4_compress(&lz4_ctx, lz4_src, 128, 0, lz4_block,
+			       sizeof(lz4_block));
+	zassert_true(rc > 0, NULL);
+	zassert_true(rc < 128, NULL);
+	rc = step_lz4_decompress(lz4_block, rc, lz4_dst, 0, sizeof(lz4_dst));
+	zassert_equal(rc, 128, NULL);
+	zassert_mem_equal(lz4_dst, lz4_src, 128, NULL);
+
+	/* Second half, using the first half as a dictionary. */
+	rc = step_lz4_compress(&lz4_ctx, lz4_src, 256, 128, lz4_block,
+			       sizeof(lz4_block));
+	zassert_true(rc > 0, NULL);
+	memcpy(lz4_dst, lz4_src, 128);
+	rc = step_lz4_decompress(lz4_block, rc, lz4_dst, 128, sizeof(lz4_dst));
+	zassert_equal(rc, 128, NULL);
+	zassert_mem_equal(lz4_dst + 128, lz4_src + 128, 128, NULL);
+
+	/* Output buffer too small. */
+	rc = step_lz4_compress(&lz4_ctx, lz4_src, 128, 0, lz4_block, 4);
+	zassert_equal(rc, -ENOSPC, NULL);
+
+	/* Match offset pointing before the start of the output. */
+	lz4_block[0] = 0x00;
+	lz4_block[1] = 0x10;
+	lz4_block[2] = 0x00;
+	rc = step_lz4_decompress(lz4_block, 3, lz4_dst, 0, sizeof(lz4_dst));
+	zassert_equal(rc, -EINVAL, NULL);
+}
+
+static struct step_lz4_cfg lz4_stream_cfg = {
+	.stream = true,
+};
+
+static struct step_node lz4_chain[] = {
+	{
+		.name = "LZ4 compress",
+		.callbacks = {
+			.exec_handler = step_lz4_compress_exec,
+		},
+		.config = &lz4_stream_cfg,
+		.next = &lz4_chain[1],
+	},
+	{
+		.name = "LZ4 decompress",
+		.callbacks = {
+			.exec_handler = step_lz4_decompress_exec,
+		},
+		.config = &lz4_stream_cfg,
+	},
+};
+
+ZTEST(tests_lz4, test_lz4_nodes_stream)
+{
+	int rc;
+	uint32_t handle;
+	uint8_t *payload;
+	struct step_measurement *mes;
+
+	step_lz4_reset();
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(lz4_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* 32-bit timestamp followed by 64 u16 samples. */
+	mes = step_sp_alloc(4 + 128);
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_U16;
+	mes->header.srclen.samples = 6;
+	mes->header.srclen.sourceid = 3;
+	payload = mes->payload;
+
+	for (uint32_t n = 0; n < 3; n++) {
+		sys_put_le32(0x12345678 + n, payload);
+		for (uint32_t i = 0; i < 64; i++) {
+			sys_put_le16(1000 + (i % 8) + n, payload + 4 + (i * 2));
+		}
+		memcpy(lz4_src, payload, 4 + 128);
+
+		rc = step_lz4_compress_exec(mes, handle, 0);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(mes->header.filter.flags.compression,
+			      n ? STEP_MES_COMPRESSION_LZ4_STREAM :
+			      STEP_MES_COMPRESSION_LZ4, NULL);
+		zassert_true(mes->header.srclen.len < 4 + 128, NULL);
+		zassert_equal(step_mes_validate(mes), 0, NULL);
+
+		/* The timestamp is left uncompressed. */
+		zassert_equal(sys_get_le32(payload), 0x12345678 + n, NULL);
+
+		rc = step_lz4_decompress_exec(mes, handle, 1);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(mes->header.filter.flags.compression,
+			      STEP_MES_COMPRESSION_NONE, NULL);
+		zassert_equal(mes->header.srclen.len, 4 + 128, NULL);
+		zassert_mem_equal(payload, lz4_src, 4 + 128, NULL);
+	}
+
+	step_sp_free(mes);
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_NODE_LZ4 */
@@ -107,3 +107,70 @@ ZTEST(tests_measurement, test_mes_check_payload_sz)
 	sz = step_mes_sz_payload(&(step_test_mes_dietemp.header));
 	zassert_equal(sz, 20, NULL);
 }
+
+ZTEST(tests_measurement, test_mes_sz_encoding)
+{
+	struct step_mes_header hdr = {
+		.unit.ctype = STEP_MES_UNIT_CTYPE_U8,
+	};
+
+	/* 1..6 bytes of BASE64: 4, 4, 4, 8, 8, 8. */
+	hdr.filter.flags.encoding = STEP_MES_ENCODING_BASE64;
+	zassert_equal(step_mes_sz_payload(&hdr), 4, NULL);
+	hdr.srclen.samples = 1;
+	zassert_equal(step_mes_sz_payload(&hdr), 4, NULL);
+	hdr.srclen.samples = 2;
+	zassert_equal(step_mes_sz_payload(&hdr), 8, NULL);
+
+	/* BASE45: 2 bytes in 3 chars, a trailing byte in 2. */
+	hdr.filter.flags.encoding = STEP_MES_ENCODING_BASE45;
+	hdr.srclen.samples = 0;
+	zassert_equal(step_mes_sz_payload(&hdr), 2, NULL);
+	hdr.srclen.samples = 1;
+	zassert_equal(step_mes_sz_payload(&hdr), 3, NULL);
+	hdr.srclen.vec_sz = STEP_MES_VECTOR_SZ_3;
+	zassert_equal(step_mes_sz_payload(&hdr), 9, NULL);
+	hdr.filter.flags.timestamp = STEP_MES_TIMESTAMP_EPOCH_32;
+	zassert_equal(step_mes_sz_payload(&hdr), 15, NULL);
+
+	/* Ambiguous sizes. */
+	hdr.srclen.samples = 15;
+	zassert_equal(step_mes_sz_payload(&hdr), -1, NULL);
+	hdr.srclen.samples = 0;
+	hdr.unit.ctype = STEP_MES_UNIT_CTYPE_USER_1;
+	zassert_equal(step_mes_sz_payload(&hdr), -1, NULL);
+}
+
+ZTEST(tests_measurement, test_mes_validate_repeat)
+{
+	int rc;
+	uint8_t payload[8] = { 0 };
+	struct step_measurement mes = {
+		.header = {
+			.unit.ctype = STEP_MES_UNIT_CTYPE_U16,
+			.srclen.len = 4,
+			.srclen.samples = 1,
+		},
+		.payload = payload,
+	};
+
+	/* Repeated validation of the same template gives the same result. */
+	for (uint32_t i = 0; i < 2; i++) {
+		rc = step_mes_validate(&mes);
+		zassert_equal(rc, 0, NULL);
+	}
+
+	/* Same template, shorter payload. */
+	mes.header.srclen.len = 3;
+	rc = step_mes_validate(&mes);
+	zassert_equal(rc, -ENOSPC, NULL);
+
+	/* Different template, same length. */
+	mes.header.srclen.len = 4;
+	mes.header.unit.ctype = STEP_MES_UNIT_CTYPE_U32;
+	rc = step_mes_validate(&mes);
+	zassert_equal(rc, -ENOSPC, NULL);
+	mes.header.srclen.samples = 0;
+	rc = step_mes_validate(&mes);
+	zassert_equal(rc, 0, NULL);
+}
@@ -270,3 +270,516 @@ ZTEST(tests_proc_manager, test_proc_subscribe_node_chain)
 	zassert_equal(received_user_data, 0x12345678, NULL);
 	zassert_equal(callback_counts, 1, NULL);
 }
+
+#if CONFIG_TEST_STEP_STATIC_NODES
+/**
+ * @brief Statically registered nodes, declared in reverse priority order.
+ */
+static struct step_node test_static_node_lo = {
+	.name = "Static low priority node",
+};
+
+static struct step_node test_static_node_mid = {
+	.name = "Static medium priority node",
+};
+
+static struct step_node test_static_node_hi = {
+	.name = "Static high priority node",
+};
+
+/* Priorities can be any constant expression. */
+#define TEST_STATIC_PRI_MID	(TEST_STATIC_PRI_LO + 3U)
+#define TEST_STATIC_PRI_LO	2
+
+STEP_NODE_DEFINE(test_static_lo, &test_static_node_lo, TEST_STATIC_PRI_LO);
+STEP_NODE_DEFINE(test_static_mid, &test_static_node_mid, TEST_STATIC_PRI_MID);
+STEP_NODE_DEFINE(test_static_hi, &test_static_node_hi, 10);
+
+ZTEST(tests_proc_manager, test_proc_register_static)
+{
+	int rc;
+	uint32_t handle;
+
+	/* Clear the processor node manager. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	/* Static nodes are no longer present after a clear. */
+	rc = step_pm_handle_get(&test_static_node_hi, &handle);
+	zassert_equal(rc, -ENOENT, NULL);
+
+	/* Restore the statically defined nodes. */
+	rc = step_pm_register_static();
+	zassert_equal(rc, 0, NULL);
+
+	/* The highest priority node must be registered first. */
+	rc = step_pm_handle_get(&test_static_node_hi, &handle);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(handle, 0, NULL);
+	rc = step_pm_handle_get(&test_static_node_mid, &handle);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(handle, 1, NULL);
+	rc = step_pm_handle_get(&test_static_node_lo, &handle);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(handle, 2, NULL);
+
+	/* The three static nodes don't fit alongside two fewer runtime nodes
+	 * than the limit, which must be left registered. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	for (int i = 0; i < CONFIG_STEP_PROC_MGR_NODE_LIMIT - 2; i++) {
+		rc = step_pm_register(&test_static_node_mid, 0, &handle);
+		zassert_equal(rc, 0, NULL);
+	}
+	rc = step_pm_register_static();
+	zassert_equal(rc, -ENOMEM, NULL);
+	rc = step_pm_handle_get(&test_static_node_mid, &handle);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(handle, 0, NULL);
+	rc = step_pm_handle_get(&test_static_node_hi, &handle);
+	zassert_equal(rc, -ENOENT, NULL);
+
+	/* Clear the node registry. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif
+
+K_SEM_DEFINE(sync_second, 0, 1);
+
+void on_second_proc_completed(struct step_measurement *mes, uint32_t handle,
+			      void *user)
+{
+	k_sem_give(&sync_second);
+}
+
+/**
+ * @brief Makes sure exclusive nodes stop evaluation of the registry.
+ */
+ZTEST(tests_proc_manager, test_proc_exclusive)
+{
+	int rc;
+	uint32_t handle;
+
+	/* Point to a statically defined measurement. */
+	struct step_measurement *mes = &step_test_mes_dietemp;
+
+	/* Clear processor node stats. */
+	memset(&step_test_data_cb_stats, 0,
+	       sizeof(struct step_test_data_procnode_cb_stats));
+
+	/* Clear the processor node manager. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	/* Register the same chain twice, with the first one exclusive. */
+	rc = step_pm_register(step_test_data_procnode_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_set_exclusive(handle, true);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(step_test_data_procnode_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_second_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	/* Invalid handle. */
+	rc = step_pm_set_exclusive(handle + 1, true);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+
+	/* The first chain runs, the second one must never be evaluated. */
+	rc = k_sem_take(&sync, K_MSEC(3000));
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync_second, K_MSEC(100));
+	zassert_equal(rc, -EAGAIN, NULL);
+	zassert_equal(step_test_data_cb_stats.run, 2, NULL);
+
+	/* Clear the node registry. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+#if CONFIG_STEP_FILTER_BATCH
+/* Light OR temperature, matching any temperature measurement once both
+ * entries are enabled. */
+static struct step_filter test_batch_filters[] = {
+	{
+		.op = STEP_FILTER_OP_IS,
+		.match = STEP_MES_TYPE_LIGHT,
+		.ignore_mask = ~STEP_MES_MASK_BASE_TYPE,
+	},
+	{
+		.op = STEP_FILTER_OP_OR,
+		.match = STEP_MES_TYPE_TEMPERATURE,
+		.ignore_mask = ~STEP_MES_MASK_BASE_TYPE,
+	},
+};
+
+static struct step_node test_batch_node = {
+	.name = "Batch filter node",
+	.filters = {
+		.count = 1,
+		.chain = test_batch_filters,
+	},
+};
+
+/**
+ * @brief Makes sure chains that changed since they were compiled into the
+ *        batch filter table are evaluated by the filter engine.
+ */
+ZTEST(tests_proc_manager, test_proc_batch_filter_changed)
+{
+	int rc;
+	uint32_t handle;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	/* Only the light entry is compiled. */
+	test_batch_node.filters.count = 1;
+	rc = step_pm_register(&test_batch_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_put(&step_test_mes_dietemp);
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync, K_MSEC(100));
+	zassert_equal(rc, -EAGAIN, NULL);
+
+	/* Enabling the temperature entry must take effect. */
+	test_batch_node.filters.count = 2;
+	rc = step_pm_put(&step_test_mes_dietemp);
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync, K_MSEC(3000));
+	zassert_equal(rc, 0, NULL);
+
+	test_batch_node.filters.count = 1;
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif
+
+#if CONFIG_STEP_PROC_MGR_REORDER
+/* Handles in the order they were evaluated for the last measurement. */
+static uint32_t reorder_seen[CONFIG_STEP_PROC_MGR_NODE_LIMIT];
+static uint32_t reorder_seen_count;
+
+static bool reorder_never(struct step_measurement *mes, uint32_t handle,
+			  uint32_t inst)
+{
+	reorder_seen[reorder_seen_count++] = handle;
+	return false;
+}
+
+static bool reorder_always(struct step_measurement *mes, uint32_t handle,
+			   uint32_t inst)
+{
+	reorder_seen[reorder_seen_count++] = handle;
+	return true;
+}
+
+static struct step_node reorder_hi_never = {
+	.name = "High priority, never matches",
+	.callbacks = { .evaluate_handler = reorder_never },
+};
+
+static struct step_node reorder_mid_never = {
+	.name = "Medium priority, never matches",
+	.callbacks = { .evaluate_handler = reorder_never },
+};
+
+static struct step_node reorder_mid_always = {
+	.name = "Medium priority, always matches",
+	.callbacks = { .evaluate_handler = reorder_always },
+};
+
+static struct step_node reorder_lo_always = {
+	.name = "Low priority, always matches",
+	.callbacks = { .evaluate_handler = reorder_always },
+};
+
+/**
+ * @brief Makes sure equal-priority records are reordered by match rate,
+ *        without any record moving past one of a different priority.
+ */
+ZTEST(tests_proc_manager, test_proc_reorder)
+{
+	int rc;
+	uint32_t hi;
+	uint32_t mid_never;
+	uint32_t mid_always;
+	uint32_t lo;
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	/* The never matching record comes first in its priority level. */
+	zassert_equal(step_pm_register(&reorder_hi_never, 5, &hi), 0, NULL);
+	zassert_equal(step_pm_register(&reorder_mid_never, 3, &mid_never), 0,
+		      NULL);
+	zassert_equal(step_pm_register(&reorder_mid_always, 3, &mid_always), 0,
+		      NULL);
+	zassert_equal(step_pm_register(&reorder_lo_always, 1, &lo), 0, NULL);
+	/* The lowest priority record is evaluated last. */
+	rc = step_pm_subscribe_to_node(lo, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	/* Let the manager reorder the registry at least twice. */
+	for (uint32_t i = 0; i < 2 * CONFIG_STEP_PROC_MGR_REORDER_INTERVAL + 1;
+	     i++) {
+		reorder_seen_count = 0;
+		rc = step_pm_put(&step_test_mes_dietemp);
+		zassert_equal(rc, 0, NULL);
+		rc = k_sem_take(&sync, K_MSEC(3000));
+		zassert_equal(rc, 0, NULL);
+	}
+
+	/* Only the two medium priority records have swapped. */
+	zassert_equal(reorder_seen_count, 4, NULL);
+	zassert_equal(reorder_seen[0], hi, NULL);
+	zassert_equal(reorder_seen[1], mid_always, NULL);
+	zassert_equal(reorder_seen[2], mid_never, NULL);
+	zassert_equal(reorder_seen[3], lo, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif
+
+static uint32_t abort_exec_counts;
+static uint32_t skipped_exec_counts;
+
+static int abort_exec(struct step_measurement *mes, uint32_t handle,
+		      uint32_t inst)
+{
+	abort_exec_counts++;
+	k_sem_give(&sync);
+
+	return STEP_NODE_RC_ABORT_CHAIN | STEP_NODE_RC_CONSUMED;
+}
+
+static int skipped_exec(struct step_measurement *mes, uint32_t handle,
+			uint32_t inst)
+{
+	skipped_exec_counts++;
+
+	return 0;
+}
+
+/**
+ * @brief Two-node chain where the first node aborts and consumes.
+ */
+static struct step_node test_abort_chain[] = {
+	{
+		.name = "Aborting node",
+		.callbacks = {
+			.exec_handler = abort_exec,
+		},
+		.next = &test_abort_chain[1],
+	},
+	{
+		.name = "Skipped node",
+		.callbacks = {
+			.exec_handler = skipped_exec,
+		},
+	},
+};
+
+/**
+ * @brief Makes sure node return codes can abort a chain and consume a
+ *        measurement.
+ */
+ZTEST(tests_proc_manager, test_proc_abort_consume)
+{
+	int rc;
+	uint32_t handle;
+
+	/* Point to a statically defined measurement. */
+	struct step_measurement *mes = &step_test_mes_dietemp;
+
+	abort_exec_counts = 0;
+	skipped_exec_counts = 0;
+	memset(&step_test_data_cb_stats, 0,
+	       sizeof(struct step_test_data_procnode_cb_stats));
+
+	/* Clear the processor node manager. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_register(test_abort_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(step_test_data_procnode_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_second_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+
+	/* Only the first node in the first chain runs. */
+	rc = k_sem_take(&sync, K_MSEC(3000));
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync_second, K_MSEC(100));
+	zassert_equal(rc, -EAGAIN, NULL);
+	zassert_equal(abort_exec_counts, 1, NULL);
+	zassert_equal(skipped_exec_counts, 0, NULL);
+	zassert_equal(step_test_data_cb_stats.run, 0, NULL);
+
+	/* Aborted chains don't notify subscribers. */
+	rc = k_sem_take(&sync, K_MSEC(100));
+	zassert_equal(rc, -EAGAIN, NULL);
+
+	/* Clear the node registry. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+static int error_exec(struct step_measurement *mes, uint32_t handle,
+		      uint32_t inst)
+{
+	return -EIO;
+}
+
+/**
+ * @brief Single node whose exec callback always fails.
+ */
+static struct step_node test_error_node = {
+	.name = "Failing node",
+	.callbacks = {
+		.exec_handler = error_exec,
+	},
+};
+
+/**
+ * @brief Makes sure the processor manager and node statistics track
+ *        processed, dropped and failed measurements.
+ */
+ZTEST(tests_proc_manager, test_proc_stats)
+{
+	int rc;
+	uint32_t handle;
+	struct step_pm_stats stats;
+	struct step_pm_node_stats ns;
+
+	/* Point to a statically defined measurement. */
+	struct step_measurement *mes = &step_test_mes_dietemp;
+
+	/* Clear the processor node manager. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	step_pm_stats_reset();
+
+	rc = step_pm_register(&test_error_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync, K_MSEC(3000));
+	zassert_equal(rc, 0, NULL);
+
+	/* The failing callback is counted against its node. */
+	rc = step_pm_node_stats_get(handle, &ns);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(ns.evals, 1, NULL);
+	zassert_equal(ns.matches, 1, NULL);
+	zassert_equal(ns.aborts, 0, NULL);
+	zassert_equal(ns.errors, 1, NULL);
+	rc = step_pm_node_stats_get(handle + 1, &ns);
+	zassert_equal(rc, -EINVAL, NULL);
+
+	step_pm_stats_get(&stats);
+	zassert_equal(stats.queued, 1, NULL);
+	zassert_equal(stats.processed, 1, NULL);
+	zassert_equal(stats.queue_depth, 0, NULL);
+	zassert_equal(stats.queue_peak, 1, NULL);
+	zassert_equal(stats.dropped, 0, NULL);
+	zassert_equal(stats.put_errors, 0, NULL);
+	zassert_equal(stats.nodes, 1, NULL);
+
+	/* Measurements that no enabled node matches are dropped. */
+	rc = step_pm_disable_node(handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync, K_MSEC(100));
+	zassert_equal(rc, -EAGAIN, NULL);
+
+	step_pm_stats_get(&stats);
+	zassert_equal(stats.queued, 2, NULL);
+	zassert_equal(stats.processed, 2, NULL);
+	zassert_equal(stats.dropped, 1, NULL);
+
+	/* Resetting clears the manager and node counters. */
+	step_pm_stats_reset();
+	step_pm_stats_get(&stats);
+	zassert_equal(stats.queued, 0, NULL);
+	zassert_equal(stats.processed, 0, NULL);
+	zassert_equal(stats.queue_peak, 0, NULL);
+	zassert_equal(stats.dropped, 0, NULL);
+	zassert_equal(stats.nodes, 1, NULL);
+	rc = step_pm_node_stats_get(handle, &ns);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(ns.evals, 0, NULL);
+	zassert_equal(ns.errors, 0, NULL);
+
+	/* Clear the node registry. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+#if CONFIG_STEP_PROC_MGR_MONITOR
+/**
+ * @brief Makes sure the worker's stack usage and activity are reported.
+ */
+ZTEST(tests_proc_manager, test_proc_worker_monitor)
+{
+	int rc;
+	uint32_t handle;
+	struct step_pm_worker_stats ws;
+
+	/* Point to a statically defined measurement. */
+	struct step_measurement *mes = &step_test_mes_dietemp;
+
+	/* Clear the processor node manager. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+
+	rc = step_pm_register(step_test_data_procnode_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_subscribe_to_node(handle, on_proc_completed, NULL);
+	zassert_equal(rc, 0, NULL);
+
+	/* Give the worker something to do, and let a few intervals pass. */
+	rc = step_pm_put(mes);
+	zassert_equal(rc, 0, NULL);
+	rc = k_sem_take(&sync, K_MSEC(3000));
+	zassert_equal(rc, 0, NULL);
+	k_msleep(CONFIG_STEP_PROC_MGR_MONITOR_INTERVAL_MS * 2);
+
+	rc = step_pm_worker_stats_get(&ws);
+	zassert_equal(rc, 0, NULL);
+	zassert_true(ws.stack_size > 0, NULL);
+	zassert_true(ws.stack_used > 0, NULL);
+	zassert_true(ws.stack_used <= ws.stack_size, NULL);
+	zassert_true(ws.busy_cycles > 0, NULL);
+	zassert_true(ws.samples >= 1, NULL);
+	zassert_true(ws.samples <= CONFIG_STEP_PROC_MGR_MONITOR_HISTORY, NULL);
+	for (uint32_t i = 0; i < ws.samples; i++) {
+		zassert_true(ws.history[i].worker_load <= 1000, NULL);
+		zassert_true(ws.history[i].cpu_load <= 1000, NULL);
+	}
+
+	/* Clear the node registry. */
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif
@@ -86,6 +86,8 @@ ZTEST(tests_sample_pool, test_sp_alloc_limit)
 	struct step_measurement *mes[max_samples];
 
 	zassert_true(step_sp_bytes_alloc() == 0, NULL);
+	step_sp_reset_peak();
+	zassert_true(step_sp_bytes_alloc_peak() == 0, NULL);
 
 	/* Fill the buffer to the limit. */
 	for (int i = 0; i < max_samples - 1; i++) {
@@ -104,4 +106,49 @@ ZTEST(tests_sample_pool, test_sp_alloc_limit)
 		step_sp_free(mes[i]);
 	}
 	zassert_true(step_sp_bytes_alloc() == 0, NULL);
+
+	/* The high-water mark survives until it's reset. */
+	zassert_true(step_sp_bytes_alloc_peak() == rec_size * (max_samples - 1),
+		     NULL);
+	step_sp_reset_peak();
+	zassert_true(step_sp_bytes_alloc_peak() == 0, NULL);
+}
+
+ZTEST(tests_sample_pool, test_sp_stats)
+{
+	int rec_size = sizeof(struct step_measurement) + 16 +
+		       (8 - ((sizeof(struct step_measurement) + 16) % 8));
+	struct step_sp_stats stats;
+	struct step_measurement *mes;
+
+	zassert_true(step_sp_bytes_alloc() == 0, NULL);
+	step_sp_stats_reset();
+	step_sp_stats_get(&stats);
+	zassert_equal(stats.pool_alloc_calls, 0, NULL);
+	zassert_equal(stats.alloc_failures, 0, NULL);
+
+	mes = step_sp_alloc(16);
+	zassert_not_null(mes, NULL);
+	step_sp_stats_get(&stats);
+	zassert_equal(stats.bytes_alloc, rec_size, NULL);
+	zassert_equal(stats.bytes_alloc_peak, rec_size, NULL);
+	step_sp_free(mes);
+
+	/* Requests larger than the pool fail and are counted. */
+	mes = step_sp_alloc(CONFIG_STEP_POOL_SIZE);
+	zassert_is_null(mes, NULL);
+
+	step_sp_stats_get(&stats);
+	zassert_equal(stats.bytes_alloc, 0, NULL);
+	zassert_equal(stats.bytes_alloc_total, rec_size, NULL);
+	zassert_equal(stats.bytes_freed_total, rec_size, NULL);
+	zassert_equal(stats.pool_alloc_calls, 2, NULL);
+	zassert_equal(stats.pool_free_calls, 1, NULL);
+	zassert_equal(stats.alloc_failures, 1, NULL);
+
+	step_sp_stats_reset();
+	step_sp_stats_get(&stats);
+	zassert_equal(stats.bytes_alloc_peak, 0, NULL);
+	zassert_equal(stats.bytes_alloc_total, 0, NULL);
+	zassert_equal(stats.alloc_failures, 0, NULL);
 }
@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_SOURCE_STATS
+#include <step/source_stats.h>
+
+ZTEST_SUITE(tests_source_stats, NULL, NULL, NULL, NULL, NULL);
+
+K_SEM_DEFINE(src_sync, 0, 16);
+
+static void src_on_completed(struct step_measurement *mes, uint32_t handle,
+			     void *user)
+{
+	k_sem_give(&src_sync);
+}
+
+/* Only matches temperature measurements. */
+static bool src_evaluate(struct step_measurement *mes, uint32_t handle,
+			 uint32_t inst)
+{
+	return mes->header.filter.base_type == STEP_MES_TYPE_TEMPERATURE;
+}
+
+static struct step_node src_node = {
+	.name = "Source stats node",
+	.callbacks = {
+		.evaluate_handler = src_evaluate,
+	},
+};
+
+static int src_put(uint8_t sourceid, uint8_t base_type)
+{
+	struct step_measurement *mes = step_sp_alloc(0);
+	int rc;
+
+	zassert_not_null(mes, NULL);
+	mes->header.filter.base_type = base_type;
+	mes->header.srclen.sourceid = sourceid;
+
+	rc = step_pm_put(mes);
+	if (rc) {
+		step_sp_free(mes);
+	}
+
+	return rc;
+}
+
+static void src_setup_node(void)
+{
+	uint32_t handle;
+
+	zassert_equal(step_pm_clear(), 0, NULL);
+	zassert_equal(step_pm_register(&src_node, 0, &handle), 0, NULL);
+	zassert_equal(step_pm_subscribe_to_node(handle, src_on_completed, NULL),
+		      0, NULL);
+	step_pm_stats_reset();
+	step_src_stats_reset();
+	k_sem_reset(&src_sync);
+}
+
+ZTEST(tests_source_stats, test_src_counters)
+{
+	struct step_src_stats s;
+
+	src_setup_node();
+
+	/* One matched and one unmatched measurement from source 1. */
+	zassert_equal(src_put(1, STEP_MES_TYPE_TEMPERATURE), 0, NULL);
+	zassert_equal(k_sem_take(&src_sync, K_MSEC(3000)), 0, NULL);
+	zassert_equal(src_put(1, STEP_MES_TYPE_LIGHT), 0, NULL);
+	zassert_equal(k_sem_take(&src_sync, K_MSEC(100)), -EAGAIN, NULL);
+
+	/* A measurement the producer couldn't allocate. */
+	step_src_report_alloc_drop(1);
+
+	step_src_stats_get(1, &s);
+	zassert_equal(s.published, 2, NULL);
+	zassert_equal(s.processed, 2, NULL);
+	zassert_equal(s.unmatched, 1, NULL);
+	zassert_equal(s.dropped_alloc, 1, NULL);
+	zassert_equal(s.dropped_overload, 0, NULL);
+
+	/* Other sources are untouched. */
+	step_src_stats_get(0, &s);
+	zassert_equal(s.published, 0, NULL);
+	zassert_equal(s.unmatched, 0, NULL);
+
+	/* High source IDs share the last slot. */
+	step_src_report_alloc_drop(200);
+	step_src_stats_get(CONFIG_STEP_SOURCE_STATS_SOURCES - 1, &s);
+	zassert_equal(s.dropped_alloc, 1, NULL);
+	step_src_stats_get(255, &s);
+	zassert_equal(s.dropped_alloc, 1, NULL);
+
+	step_src_stats_reset();
+	step_src_stats_get(1, &s);
+	zassert_equal(s.published, 0, NULL);
+	zassert_equal(s.unmatched, 0, NULL);
+	zassert_equal(s.dropped_alloc, 0, NULL);
+
+	zassert_equal(step_pm_clear(), 0, NULL);
+}
+
+ZTEST(tests_source_stats, test_src_rate)
+{
+	struct step_src_stats s;
+	uint32_t rate;
+
+	step_src_stats_reset();
+
+	/* 20 measurements and 10 drops in the first window. */
+	for (int i = 0; i < 20; i++) {
+		step_src_record_put(2);
+	}
+	for (int i = 0; i < 10; i++) {
+		step_src_report_alloc_drop(2);
+	}
+	k_msleep(CONFIG_STEP_SOURCE_STATS_WINDOW_MS);
+
+	step_src_stats_get(2, &s);
+	zassert_true(s.rate > 0, NULL);
+	zassert_true(s.rate <= 20 * 1000 / CONFIG_STEP_SOURCE_STATS_WINDOW_MS,
+		     NULL);
+	zassert_true(s.drop_rate > 0, NULL);
+	zassert_true(s.drop_rate < s.rate, NULL);
+	rate = s.rate;
+
+	/* The estimate decays while the source is idle. */
+	k_msleep(CONFIG_STEP_SOURCE_STATS_WINDOW_MS * 4);
+	step_src_stats_get(2, &s);
+	zassert_true(s.rate < rate, NULL);
+	zassert_equal(s.published, 20, NULL);
+
+	step_src_stats_reset();
+}
+
+#if CONFIG_STEP_PROC_MGR_QUEUE_LIMIT
+ZTEST(tests_source_stats, test_src_overload)
+{
+	struct step_src_stats s;
+	struct step_pm_stats pm;
+
+	src_setup_node();
+
+	/* Keep the processor manager from draining the queue. */
+	k_sched_lock();
+	for (int i = 0; i < CONFIG_STEP_PROC_MGR_QUEUE_LIMIT; i++) {
+		zassert_equal(src_put(3, STEP_MES_TYPE_TEMPERATURE), 0, NULL);
+	}
+	zassert_equal(src_put(3, STEP_MES_TYPE_TEMPERATURE), -ENOBUFS, NULL);
+	k_sched_unlock();
+
+	for (int i = 0; i < CONFIG_STEP_PROC_MGR_QUEUE_LIMIT; i++) {
+		zassert_equal(k_sem_take(&src_sync, K_MSEC(3000)), 0, NULL);
+	}
+
+	step_src_stats_get(3, &s);
+	zassert_equal(s.published, CONFIG_STEP_PROC_MGR_QUEUE_LIMIT, NULL);
+	zassert_equal(s.dropped_overload, 1, NULL);
+
+	step_pm_stats_get(&pm);
+	zassert_equal(pm.rejected, 1, NULL);
+	zassert_equal(pm.queue_peak, CONFIG_STEP_PROC_MGR_QUEUE_LIMIT, NULL);
+
+	zassert_equal(step_pm_clear(), 0, NULL);
+}
+#endif
+#endif /* CONFIG_STEP_SOURCE_STATS */
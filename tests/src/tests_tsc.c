@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2022 Linaro
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <zephyr/ztest.h>
+#include <step/step.h>
+#include <step/tsc.h>
+#include <step/node.h>
+#include <step/proc_mgr.h>
+#include <step/sample_pool.h>
+
+#if CONFIG_STEP_NODE_TSC
+ZTEST_SUITE(tests_tsc, NULL, NULL, NULL, NULL, NULL);
+
+/* Timestamp followed by 16 XYZ float samples. */
+struct tsc_accel_payload {
+	uint32_t timestamp;
+	float xyz[16][3];
+};
+
+static struct tsc_accel_payload tsc_src[2];
+
+static struct step_tsc_cfg tsc_stream_cfg = {
+	.stream = true,
+};
+
+static struct step_node tsc_chain[] = {
+	{
+		.name = "TSC compress",
+		.callbacks = {
+			.exec_handler = step_tsc_compress_exec,
+		},
+		.config = &tsc_stream_cfg,
+		.next = &tsc_chain[1],
+	},
+	{
+		.name = "TSC decompress",
+		.callbacks = {
+			.exec_handler = step_tsc_decompress_exec,
+		},
+		.config = &tsc_stream_cfg,
+	},
+};
+
+/**
+ * @brief Allocates a slowly varying accelerometer measurement.
+ */
+static struct step_measurement *tsc_accel_mes(uint32_t n)
+{
+	struct step_measurement *mes;
+	struct tsc_accel_payload *p;
+
+	mes = step_sp_alloc(sizeof(struct tsc_accel_payload));
+	zassert_not_null(mes, NULL);
+	mes->header.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32;
+	mes->header.unit.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32;
+	mes->header.srclen.vec_sz = STEP_MES_VECTOR_SZ_3;
+	mes->header.srclen.samples = 4;
+	mes->header.srclen.sourceid = 5;
+
+	/* 100 Hz, with a constant sample rate between measurements. */
+	p = mes->payload;
+	p->timestamp = 1000 + n * 160;
+	for (uint32_t i = 0; i < 16; i++) {
+		p->xyz[i][0] = 0.25F * ((n * 16 + i) % 4);
+		p->xyz[i][1] = -1.5F;
+		p->xyz[i][2] = 9.75F + 0.5F * (i & 1);
+	}
+
+	return mes;
+}
+
+ZTEST(tests_tsc, test_tsc_nodes_stream)
+{
+	int rc;
+	uint32_t handle;
+	uint32_t clen[2];
+	struct step_measurement *mes[2];
+
+	step_tsc_reset();
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(tsc_chain, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	for (uint32_t n = 0; n < 2; n++) {
+		mes[n] = tsc_accel_mes(n);
+		memcpy(&tsc_src[n], mes[n]->payload, sizeof(tsc_src[n]));
+
+		rc = step_tsc_compress_exec(mes[n], handle, 0);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(mes[n]->header.filter.flags.compression,
+			      STEP_MES_COMPRESSION_TSC, NULL);
+		zassert_equal(step_mes_validate(mes[n]), 0, NULL);
+		clen[n] = mes[n]->header.srclen.len;
+	}
+
+	/* At least 3x smaller, and the second measurement benefits from the
+	 * values and timestamp delta carried over from the first. */
+	zassert_true(clen[0] * 3 < sizeof(struct tsc_accel_payload), NULL);
+	zassert_true(clen[1] < clen[0], NULL);
+
+	/* The second measurement can't be decoded without the first. */
+	rc = step_tsc_decompress_exec(mes[1], handle, 1);
+	zassert_equal(rc, -ENOENT, NULL);
+
+	for (uint32_t n = 0; n < 2; n++) {
+		rc = step_tsc_decompress_exec(mes[n], handle, 1);
+		zassert_equal(rc, 0, NULL);
+		zassert_equal(mes[n]->header.filter.flags.compression,
+			      STEP_MES_COMPRESSION_NONE, NULL);
+		zassert_equal(mes[n]->header.srclen.len,
+			      sizeof(struct tsc_accel_payload), NULL);
+		zassert_mem_equal(mes[n]->payload, &tsc_src[n],
+				  sizeof(tsc_src[n]), NULL);
+		step_sp_free(mes[n]);
+	}
+
+	zassert_equal(step_sp_bytes_alloc(), 0, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+
+static struct step_tsc_cfg tsc_cfg = {
+	.stream = false,
+};
+
+static struct step_node tsc_node = {
+	.name = "TSC",
+	.callbacks = {
+		.exec_handler = step_tsc_compress_exec,
+	},
+	.config = &tsc_cfg,
+};
+
+ZTEST(tests_tsc, test_tsc_passthrough)
+{
+	int rc;
+	uint32_t handle;
+	struct {
+		uint32_t timestamp;
+		float temp;
+	} single = { 123456, 21.5F };
+	uint16_t u16[4] = { 1, 2, 3, 4 };
+	struct step_measurement mes = {
+		.header = {
+			.filter.flags.timestamp = STEP_MES_TIMESTAMP_UPTIME_MS_32,
+			.unit.ctype = STEP_MES_UNIT_CTYPE_IEEE754_FLOAT32,
+			.srclen.len = sizeof(single),
+		},
+		.payload = &single,
+	};
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+	rc = step_pm_register(&tsc_node, 0, &handle);
+	zassert_equal(rc, 0, NULL);
+
+	/* A single independent sample doesn't shrink, so is left as-is. */
+	rc = step_tsc_compress_exec(&mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(mes.header.filter.flags.compression,
+		      STEP_MES_COMPRESSION_NONE, NULL);
+	zassert_equal(mes.header.srclen.len, sizeof(single), NULL);
+	zassert_equal(single.timestamp, 123456, NULL);
+
+	/* Only 4-byte samples are supported. */
+	mes.header.filter.flags.timestamp = STEP_MES_TIMESTAMP_NONE;
+	mes.header.unit.ctype = STEP_MES_UNIT_CTYPE_U16;
+	mes.header.srclen.samples = 2;
+	mes.header.srclen.len = sizeof(u16);
+	mes.payload = u16;
+	rc = step_tsc_compress_exec(&mes, handle, 0);
+	zassert_equal(rc, 0, NULL);
+	zassert_equal(mes.header.filter.flags.compression,
+		      STEP_MES_COMPRESSION_NONE, NULL);
+
+	rc = step_pm_clear();
+	zassert_equal(rc, 0, NULL);
+}
+#endif /* CONFIG_STEP_NODE_TSC */